@@ -0,0 +1,171 @@
+// SPDX license identifier: MIT.
+// Copyright (C) 2023-present Liam Hauw.
+
+// clang-format off
+#include "platform/pch.h"
+// clang-format on
+
+#include "base/gpu/bindless_table.h"
+
+#include "core/log.h"
+
+namespace luka::gpu {
+
+BindlessTable::BindlessTable(const vk::raii::Device& device,
+                             Buffer&& material_buffer, u32 sampler_count,
+                             u32 image_count, u32 material_count,
+                             bool update_after_bind)
+    : device_{&device},
+      material_buffer_{std::move(material_buffer)},
+      material_data_{static_cast<u8*>(material_buffer_.Map())} {
+  sampler_slots_.count = sampler_count;
+  image_slots_.count = image_count;
+  material_slots_.count = material_count;
+
+  // Descriptor set layout.
+  std::vector<vk::DescriptorSetLayoutBinding> bindings{
+      {0, vk::DescriptorType::eSampler, sampler_count,
+       vk::ShaderStageFlagBits::eAll},
+      {1, vk::DescriptorType::eSampledImage, image_count,
+       vk::ShaderStageFlagBits::eAll},
+      {2, vk::DescriptorType::eStorageBuffer, 1,
+       vk::ShaderStageFlagBits::eAll}};
+
+  vk::DescriptorBindingFlags binding_flag{
+      vk::DescriptorBindingFlagBits::ePartiallyBound};
+  vk::DescriptorSetLayoutCreateFlags descriptor_set_layout_flags{};
+  vk::DescriptorPoolCreateFlags descriptor_pool_flags{
+      vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet};
+  if (update_after_bind) {
+    binding_flag |= vk::DescriptorBindingFlagBits::eUpdateAfterBind |
+                    vk::DescriptorBindingFlagBits::eUpdateUnusedWhilePending;
+    descriptor_set_layout_flags |=
+        vk::DescriptorSetLayoutCreateFlagBits::eUpdateAfterBindPool;
+    descriptor_pool_flags |= vk::DescriptorPoolCreateFlagBits::eUpdateAfterBind;
+  }
+
+  // The material buffer is written once, before the set is ever bound.
+  std::vector<vk::DescriptorBindingFlags> binding_flags{binding_flag,
+                                                        binding_flag, {}};
+  vk::DescriptorSetLayoutBindingFlagsCreateInfo binding_flags_ci{
+      binding_flags};
+
+  vk::DescriptorSetLayoutCreateInfo descriptor_set_layout_ci{
+      descriptor_set_layout_flags, bindings, &binding_flags_ci};
+  descriptor_set_layout_ =
+      vk::raii::DescriptorSetLayout{device, descriptor_set_layout_ci};
+
+  // Descriptor pool.
+  std::vector<vk::DescriptorPoolSize> pool_sizes{
+      {vk::DescriptorType::eSampler, sampler_count},
+      {vk::DescriptorType::eSampledImage, image_count},
+      {vk::DescriptorType::eStorageBuffer, 1}};
+  vk::DescriptorPoolCreateInfo descriptor_pool_ci{descriptor_pool_flags, 1,
+                                                  pool_sizes};
+  descriptor_pool_ = vk::raii::DescriptorPool{device, descriptor_pool_ci};
+
+  // Descriptor set.
+  vk::DescriptorSetAllocateInfo descriptor_set_ai{*descriptor_pool_,
+                                                  *descriptor_set_layout_};
+  vk::raii::DescriptorSets descriptor_sets{device, descriptor_set_ai};
+  descriptor_set_ = std::move(descriptor_sets[0]);
+
+  vk::DescriptorBufferInfo descriptor_buffer_info{
+      *material_buffer_, 0,
+      static_cast<u64>(material_count) * kBindlessMaterialStride};
+  vk::WriteDescriptorSet write_descriptor_set{
+      *descriptor_set_, 2, 0, vk::DescriptorType::eStorageBuffer, nullptr,
+      descriptor_buffer_info};
+  device.updateDescriptorSets(write_descriptor_set, nullptr);
+}
+
+const vk::raii::DescriptorSetLayout& BindlessTable::GetDescriptorSetLayout()
+    const {
+  return descriptor_set_layout_;
+}
+
+const vk::raii::DescriptorSet& BindlessTable::GetDescriptorSet() const {
+  return descriptor_set_;
+}
+
+u32 BindlessTable::AddSampler(const vk::raii::Sampler& sampler) {
+  std::lock_guard<std::mutex> lock{mutex_};
+  u32 index{Acquire(sampler_slots_, "sampler")};
+
+  vk::DescriptorImageInfo descriptor_image_info{*sampler};
+  vk::WriteDescriptorSet write_descriptor_set{
+      *descriptor_set_, 0, index, vk::DescriptorType::eSampler,
+      descriptor_image_info};
+  device_->updateDescriptorSets(write_descriptor_set, nullptr);
+
+  return index;
+}
+
+u32 BindlessTable::AddImage(const vk::raii::ImageView& image_view) {
+  std::lock_guard<std::mutex> lock{mutex_};
+  u32 index{Acquire(image_slots_, "image")};
+
+  vk::DescriptorImageInfo descriptor_image_info{
+      nullptr, *image_view, vk::ImageLayout::eShaderReadOnlyOptimal};
+  vk::WriteDescriptorSet write_descriptor_set{
+      *descriptor_set_, 1, index, vk::DescriptorType::eSampledImage,
+      descriptor_image_info};
+  device_->updateDescriptorSets(write_descriptor_set, nullptr);
+
+  return index;
+}
+
+// The record is only written by the material taking the slot, so the copy
+// needs no lock.
+u32 BindlessTable::AddMaterial(const void* data, u64 size) {
+  if (size > kBindlessMaterialStride) {
+    THROW("Material size ({}) exceeds kBindlessMaterialStride ({})", size,
+          kBindlessMaterialStride);
+  }
+
+  u32 index{};
+  {
+    std::lock_guard<std::mutex> lock{mutex_};
+    index = Acquire(material_slots_, "material");
+  }
+  memcpy(material_data_ + static_cast<u64>(index) * kBindlessMaterialStride,
+         data, size);
+  return index;
+}
+
+void BindlessTable::RemoveSampler(u32 index) {
+  std::lock_guard<std::mutex> lock{mutex_};
+  Release(sampler_slots_, index);
+}
+
+void BindlessTable::RemoveImage(u32 index) {
+  std::lock_guard<std::mutex> lock{mutex_};
+  Release(image_slots_, index);
+}
+
+void BindlessTable::RemoveMaterial(u32 index) {
+  std::lock_guard<std::mutex> lock{mutex_};
+  Release(material_slots_, index);
+}
+
+u32 BindlessTable::Acquire(Slots& slots, const std::string& name) {
+  if (!slots.free.empty()) {
+    u32 index{slots.free.back()};
+    slots.free.pop_back();
+    return index;
+  }
+  if (slots.next >= slots.count) {
+    THROW("Bindless {} slots ({}) are exhausted", name, slots.count);
+  }
+  return slots.next++;
+}
+
+// A released slot keeps its stale descriptor, it is partially bound and no
+// longer indexed by any draw once its resource is gone.
+void BindlessTable::Release(Slots& slots, u32 index) {
+  if (index < slots.next) {
+    slots.free.push_back(index);
+  }
+}
+
+}  // namespace luka::gpu
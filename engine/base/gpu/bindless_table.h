@@ -0,0 +1,76 @@
+// SPDX license identifier: MIT.
+// Copyright (C) 2023-present Liam Hauw.
+
+#pragma once
+
+// clang-format off
+#include "platform/pch.h"
+// clang-format on
+
+#include <mutex>
+
+#include "base/gpu/buffer.h"
+#include "core/util.h"
+
+namespace luka::gpu {
+
+constexpr u32 kBindlessSamplerMaxCount{256};
+constexpr u32 kBindlessImageMaxCount{4096};
+constexpr u32 kBindlessMaterialMaxCount{4096};
+constexpr u32 kBindlessMaterialStride{128};
+
+/**
+ * One device-wide set holding every sampler (binding 0) and sampled image
+ * (binding 1) of the scenes, and a storage buffer of material records
+ * (binding 2). A slot is taken when the resource is created and keeps its
+ * index until the resource is destroyed, freed slots are reused. Image
+ * bindings are partially bound, and updated after bind when the device
+ * supports it, so slots can be written while frames are in flight. Material
+ * records live in mapped memory and are written once, when their slot is
+ * taken.
+ */
+class BindlessTable {
+ public:
+  DELETE_SPECIAL_MEMBER_FUNCTIONS(BindlessTable)
+
+  BindlessTable(const vk::raii::Device& device, Buffer&& material_buffer,
+                u32 sampler_count, u32 image_count, u32 material_count,
+                bool update_after_bind);
+
+  ~BindlessTable() = default;
+
+  const vk::raii::DescriptorSetLayout& GetDescriptorSetLayout() const;
+  const vk::raii::DescriptorSet& GetDescriptorSet() const;
+
+  u32 AddSampler(const vk::raii::Sampler& sampler);
+  u32 AddImage(const vk::raii::ImageView& image_view);
+  u32 AddMaterial(const void* data, u64 size);
+  void RemoveSampler(u32 index);
+  void RemoveImage(u32 index);
+  void RemoveMaterial(u32 index);
+
+ private:
+  struct Slots {
+    u32 count{};
+    u32 next{};
+    std::vector<u32> free;
+  };
+
+  static u32 Acquire(Slots& slots, const std::string& name);
+  static void Release(Slots& slots, u32 index);
+
+  const vk::raii::Device* device_{};
+
+  vk::raii::DescriptorSetLayout descriptor_set_layout_{nullptr};
+  vk::raii::DescriptorPool descriptor_pool_{nullptr};
+  vk::raii::DescriptorSet descriptor_set_{nullptr};
+  Buffer material_buffer_;
+  u8* material_data_{};
+
+  std::mutex mutex_;
+  Slots sampler_slots_;
+  Slots image_slots_;
+  Slots material_slots_;
+};
+
+}  // namespace luka::gpu
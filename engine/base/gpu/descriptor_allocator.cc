@@ -0,0 +1,102 @@
+// SPDX license identifier: MIT.
+// Copyright (C) 2023-present Liam Hauw.
+
+// clang-format off
+#include "platform/pch.h"
+// clang-format on
+
+#include "base/gpu/descriptor_allocator.h"
+
+#include "core/log.h"
+
+namespace luka::gpu {
+
+namespace {
+
+constexpr u32 kDescriptorPoolMinSetCount{64};
+constexpr u32 kDescriptorPoolMaxSetCount{4096};
+
+// Descriptors of each type per set, scaled by the set count of a pool.
+constexpr std::array<std::pair<vk::DescriptorType, u32>, 7>
+    kDescriptorPoolRatios{{{vk::DescriptorType::eUniformBuffer, 2},
+                           {vk::DescriptorType::eStorageBuffer, 2},
+                           {vk::DescriptorType::eCombinedImageSampler, 2},
+                           {vk::DescriptorType::eSampledImage, 1},
+                           {vk::DescriptorType::eSampler, 1},
+                           {vk::DescriptorType::eStorageImage, 2},
+                           {vk::DescriptorType::eInputAttachment, 4}}};
+
+}  // namespace
+
+DescriptorAllocator::DescriptorAllocator(DescriptorAllocator&& rhs) noexcept
+    : device_{std::exchange(rhs.device_, nullptr)},
+      pools_{std::move(rhs.pools_)},
+      pool_index_{std::exchange(rhs.pool_index_, 0)},
+      max_sets_{std::exchange(rhs.max_sets_, 0)} {}
+
+DescriptorAllocator::DescriptorAllocator(const vk::raii::Device& device)
+    : device_{&device}, max_sets_{kDescriptorPoolMinSetCount} {}
+
+DescriptorAllocator& DescriptorAllocator::operator=(
+    DescriptorAllocator&& rhs) noexcept {
+  if (this != &rhs) {
+    std::swap(device_, rhs.device_);
+    std::swap(pools_, rhs.pools_);
+    std::swap(pool_index_, rhs.pool_index_);
+    std::swap(max_sets_, rhs.max_sets_);
+  }
+  return *this;
+}
+
+std::vector<vk::DescriptorSet> DescriptorAllocator::Allocate(
+    vk::DescriptorSetAllocateInfo descriptor_set_ai) {
+  if (!device_) {
+    THROW("Descriptor allocator has no device");
+  }
+
+  while (true) {
+    bool new_pool{pool_index_ == pools_.size()};
+    bool largest_pool{max_sets_ == kDescriptorPoolMaxSetCount};
+    if (new_pool) {
+      AddPool();
+    }
+
+    descriptor_set_ai.descriptorPool = *pools_[pool_index_];
+    try {
+      return (**device_).allocateDescriptorSets(descriptor_set_ai,
+                                                *device_->getDispatcher());
+    } catch (const vk::OutOfPoolMemoryError&) {
+    } catch (const vk::FragmentedPoolError&) {
+    }
+
+    // Sets a new pool cannot hold will not fit into a larger one either.
+    if (new_pool && largest_pool) {
+      THROW("Fail to allocate {} descriptor sets",
+            descriptor_set_ai.descriptorSetCount);
+    }
+    ++pool_index_;
+  }
+}
+
+void DescriptorAllocator::Reset() {
+  for (auto& pool : pools_) {
+    pool.reset();
+  }
+  pool_index_ = 0;
+}
+
+void DescriptorAllocator::AddPool() {
+  std::vector<vk::DescriptorPoolSize> pool_sizes;
+  pool_sizes.reserve(kDescriptorPoolRatios.size());
+  for (const auto& [descriptor_type, ratio] : kDescriptorPoolRatios) {
+    pool_sizes.emplace_back(descriptor_type, ratio * max_sets_);
+  }
+
+  vk::DescriptorPoolCreateInfo descriptor_pool_ci{{}, max_sets_, pool_sizes};
+  pools_.emplace_back(*device_, descriptor_pool_ci);
+
+  // Every pool is twice as large as the previous one, up to the cap.
+  max_sets_ = std::min(max_sets_ * 2, kDescriptorPoolMaxSetCount);
+}
+
+}  // namespace luka::gpu
@@ -0,0 +1,43 @@
+// SPDX license identifier: MIT.
+// Copyright (C) 2023-present Liam Hauw.
+
+#pragma once
+
+// clang-format off
+#include "platform/pch.h"
+// clang-format on
+
+namespace luka::gpu {
+
+/**
+ * Descriptor sets are taken linearly from a chain of pools, a full pool is
+ * followed by a larger one. Sets are never freed one by one, the owner resets
+ * all pools at once when it rebuilds its sets and the pools are reused.
+ */
+class DescriptorAllocator {
+ public:
+  DescriptorAllocator() = default;
+  DescriptorAllocator(const DescriptorAllocator&) = delete;
+  DescriptorAllocator(DescriptorAllocator&& rhs) noexcept;
+  explicit DescriptorAllocator(const vk::raii::Device& device);
+
+  ~DescriptorAllocator() = default;
+
+  DescriptorAllocator& operator=(const DescriptorAllocator&) = delete;
+  DescriptorAllocator& operator=(DescriptorAllocator&& rhs) noexcept;
+
+  std::vector<vk::DescriptorSet> Allocate(
+      vk::DescriptorSetAllocateInfo descriptor_set_ai);
+
+  void Reset();
+
+ private:
+  void AddPool();
+
+  const vk::raii::Device* device_{};
+  std::vector<vk::raii::DescriptorPool> pools_;
+  u32 pool_index_{};
+  u32 max_sets_{};
+};
+
+}  // namespace luka::gpu
@@ -9,6 +9,7 @@
 
 #include "core/log.h"
 #include "core/util.h"
+#include "resource/config/generated/root_path.h"
 
 namespace luka {
 
@@ -19,10 +20,17 @@ Gpu::Gpu(std::shared_ptr<Window> window) : window_{std::move(window)} {
   CreateDevice();
   CreateVmaAllocator();
   CreateDescriptorPool();
+  CreateBindlessTable();
   CreateDefaultResource();
+  LoadPipelineCache();
 }
 
-Gpu::~Gpu() { DestroyAllocator(); }
+Gpu::~Gpu() {
+  SavePipelineCache();
+  // The material buffer of the bindless table is allocated by vma.
+  bindless_table_.reset();
+  DestroyAllocator();
+}
 
 void Gpu::Tick() {}
 
@@ -44,6 +52,12 @@ std::vector<vk::PresentModeKHR> Gpu::GetSurfacePresentModes() const {
 
 bool Gpu::HasIndexTypeUint8() const { return has_index_type_uint8_; }
 
+bool Gpu::HasBufferDeviceAddress() const {
+  return has_buffer_device_address_;
+}
+
+bool Gpu::HasMultiDrawIndirect() const { return has_multi_draw_indirect_; }
+
 u32 Gpu::GetGraphicsQueueIndex() const { return graphics_queue_index_.value(); }
 
 u32 Gpu::GetComputeQueueIndex() const { return compute_queue_index_.value(); }
@@ -52,6 +66,14 @@ u32 Gpu::GetTransferQueueIndex() const { return transfer_queue_index_.value(); }
 
 u32 Gpu::GetPresentQueueIndex() const { return present_queue_index_.value(); }
 
+bool Gpu::HasAsyncCompute() const {
+  return compute_queue_index_.value() != graphics_queue_index_.value();
+}
+
+const std::vector<u32>& Gpu::GetConcurrentQueueIndices() const {
+  return concurrent_queue_indices_;
+}
+
 ImGui_ImplVulkan_InitInfo Gpu::GetImguiVulkanInitInfo() const {
   ImGui_ImplVulkan_InitInfo init_info{
       .Instance = static_cast<VkInstance>(*instance_),
@@ -64,7 +86,7 @@ ImGui_ImplVulkan_InitInfo Gpu::GetImguiVulkanInitInfo() const {
       .MinImageCount = 3,
       .ImageCount = 3,
       .MSAASamples = VK_SAMPLE_COUNT_1_BIT,
-      .PipelineCache = nullptr,
+      .PipelineCache = static_cast<VkPipelineCache>(*pipeline_cache_),
       .Subpass = 0,
   };
 
@@ -73,6 +95,67 @@ ImGui_ImplVulkan_InitInfo Gpu::GetImguiVulkanInitInfo() const {
 
 const vk::raii::Sampler& Gpu::GetSampler() const { return sampler_; }
 
+const vk::raii::DescriptorSetLayout& Gpu::GetBindlessDescriptorSetLayout()
+    const {
+  return bindless_table_->GetDescriptorSetLayout();
+}
+
+const vk::raii::DescriptorSet& Gpu::GetBindlessDescriptorSet() const {
+  return bindless_table_->GetDescriptorSet();
+}
+
+u32 Gpu::AddBindlessSampler(const vk::raii::Sampler& sampler) {
+  return bindless_table_->AddSampler(sampler);
+}
+
+u32 Gpu::AddBindlessImage(const vk::raii::ImageView& image_view) {
+  return bindless_table_->AddImage(image_view);
+}
+
+u32 Gpu::AddBindlessMaterial(const void* data, u64 size) {
+  return bindless_table_->AddMaterial(data, size);
+}
+
+void Gpu::RemoveBindlessSampler(u32 index) {
+  bindless_table_->RemoveSampler(index);
+}
+
+void Gpu::RemoveBindlessImage(u32 index) {
+  bindless_table_->RemoveImage(index);
+}
+
+void Gpu::RemoveBindlessMaterial(u32 index) {
+  bindless_table_->RemoveMaterial(index);
+}
+
+const vk::raii::PipelineCache& Gpu::GetPipelineCache() const {
+  return pipeline_cache_;
+}
+
+std::vector<u8> Gpu::GetPipelineCacheData() const {
+  std::lock_guard<std::mutex> lock{pipeline_cache_mutex_};
+  return pipeline_cache_.getData();
+}
+
+void Gpu::MergePipelineCaches(
+    const std::vector<vk::raii::PipelineCache>& pipeline_caches) {
+  std::vector<vk::PipelineCache> src_caches;
+  src_caches.reserve(pipeline_caches.size());
+  for (const auto& pipeline_cache : pipeline_caches) {
+    src_caches.push_back(*pipeline_cache);
+  }
+
+  if (!src_caches.empty()) {
+    std::lock_guard<std::mutex> lock{pipeline_cache_mutex_};
+    pipeline_cache_.merge(src_caches);
+  }
+}
+
+vk::DeviceAddress Gpu::GetBufferDeviceAddress(vk::Buffer buffer) const {
+  vk::BufferDeviceAddressInfo buffer_device_address_info{buffer};
+  return device_.getBufferAddress(buffer_device_address_info);
+}
+
 gpu::Buffer Gpu::CreateBuffer(const vk::BufferCreateInfo& buffer_ci,
                               const void* data, bool map,
                               const std::string& name, i32 index) {
@@ -112,6 +195,20 @@ gpu::Buffer Gpu::CreateBuffer(const vk::BufferCreateInfo& buffer_ci,
   return buffer;
 }
 
+// Only written and read by shaders, so it is neither initialized nor mapped.
+gpu::Buffer Gpu::CreateDeviceBuffer(const vk::BufferCreateInfo& buffer_ci,
+                                    const std::string& name, i32 index) {
+  gpu::Buffer buffer{allocator_, buffer_ci};
+
+#ifndef NDEBUG
+  SetObjectName(vk::ObjectType::eBuffer,
+                reinterpret_cast<uint64_t>(static_cast<VkBuffer>(*buffer)),
+                name, "Buffer", index == -1 ? "" : std::to_string(index));
+#endif
+
+  return buffer;
+}
+
 gpu::Image Gpu::CreateImage(const vk::ImageCreateInfo& image_ci,
                             const vk::ImageLayout& new_layout,
                             const vk::raii::CommandBuffer& command_buffer,
@@ -377,6 +474,27 @@ vk::raii::DescriptorPool Gpu::CreateDescriptorPool(
   return descriptor_pool;
 }
 
+gpu::DescriptorAllocator Gpu::CreateDescriptorAllocator() {
+  return gpu::DescriptorAllocator{device_};
+}
+
+vk::raii::DescriptorUpdateTemplate Gpu::CreateDescriptorUpdateTemplate(
+    const vk::DescriptorUpdateTemplateCreateInfo&
+        descriptor_update_template_ci,
+    const std::string& name, i32 index) {
+  vk::raii::DescriptorUpdateTemplate descriptor_update_template{
+      device_, descriptor_update_template_ci};
+#ifndef NDEBUG
+  SetObjectName(vk::ObjectType::eDescriptorUpdateTemplate,
+                reinterpret_cast<uint64_t>(
+                    static_cast<VkDescriptorUpdateTemplate>(
+                        *descriptor_update_template)),
+                name, "Descriptor Update Template",
+                index == -1 ? "" : std::to_string(index));
+#endif
+  return descriptor_update_template;
+}
+
 vk::raii::DescriptorSetLayout Gpu::CreateDescriptorSetLayout(
     const vk::DescriptorSetLayoutCreateInfo& descriptor_set_layout_ci,
     const std::string& name, i32 index) {
@@ -440,6 +558,10 @@ vk::raii::Pipeline Gpu::CreatePipeline(
     const vk::GraphicsPipelineCreateInfo& graphics_pipeline_ci,
     const vk::raii::PipelineCache& pipeline_cache, const std::string& name,
     i32 index) {
+  std::unique_lock<std::mutex> lock{pipeline_cache_mutex_, std::defer_lock};
+  if (&pipeline_cache == &pipeline_cache_) {
+    lock.lock();
+  }
   vk::raii::Pipeline pipeline{device_, pipeline_cache, graphics_pipeline_ci};
 
 #ifndef NDEBUG
@@ -456,6 +578,10 @@ vk::raii::Pipeline Gpu::CreatePipeline(
     const vk::ComputePipelineCreateInfo& compute_pipeline_ci,
     const vk::raii::PipelineCache& pipeline_cache, const std::string& name,
     i32 index) {
+  std::unique_lock<std::mutex> lock{pipeline_cache_mutex_, std::defer_lock};
+  if (&pipeline_cache == &pipeline_cache_) {
+    lock.lock();
+  }
   vk::raii::Pipeline pipeline{device_, pipeline_cache, compute_pipeline_ci};
 
 #ifndef NDEBUG
@@ -486,17 +612,18 @@ vk::raii::CommandBuffers Gpu::AllocateCommandBuffers(
   return command_buffers;
 }
 
-vk::raii::DescriptorSets Gpu::AllocateNormalDescriptorSets(
-    vk::DescriptorSetAllocateInfo descriptor_set_ai, const std::string& name,
-    i32 index) {
-  descriptor_set_ai.descriptorPool = *normal_descriptor_pool_;
-  vk::raii::DescriptorSets descriptor_sets{device_, descriptor_set_ai};
+std::vector<vk::DescriptorSet> Gpu::AllocateDescriptorSets(
+    gpu::DescriptorAllocator& descriptor_allocator,
+    const vk::DescriptorSetAllocateInfo& descriptor_set_ai,
+    const std::string& name, i32 index) {
+  std::vector<vk::DescriptorSet> descriptor_sets{
+      descriptor_allocator.Allocate(descriptor_set_ai)};
 
 #ifndef NDEBUG
   for (u32 i{}; i < descriptor_sets.size(); ++i) {
     SetObjectName(vk::ObjectType::eDescriptorSet,
                   reinterpret_cast<uint64_t>(
-                      static_cast<VkDescriptorSet>(*(descriptor_sets[i]))),
+                      static_cast<VkDescriptorSet>(descriptor_sets[i])),
                   name, "Descriptor Set",
                   index == -1 ? "" : std::to_string(index));
   }
@@ -506,31 +633,22 @@ vk::raii::DescriptorSets Gpu::AllocateNormalDescriptorSets(
   return descriptor_sets;
 }
 
-vk::raii::DescriptorSet Gpu::AllocateBindlessDescriptorSet(
-    vk::DescriptorSetAllocateInfo descriptor_set_ai, const std::string& name,
-    i32 index) {
-  if (descriptor_set_ai.descriptorSetCount != 1) {
-    LOGW("Descriptor set count is not 1");
-  }
-  descriptor_set_ai.descriptorPool = *bindless_descriptor_pool_;
-  vk::raii::DescriptorSets descriptor_sets{device_, descriptor_set_ai};
-
-#ifndef NDEBUG
-  SetObjectName(vk::ObjectType::eDescriptorSet,
-                reinterpret_cast<uint64_t>(
-                    static_cast<VkDescriptorSet>(*(descriptor_sets[0]))),
-                name, "Descriptor Set",
-                index == -1 ? "" : std::to_string(index));
-#endif
-
-  return std::move(descriptor_sets[0]);
-}
-
 void Gpu::UpdateDescriptorSets(
     const std::vector<vk::WriteDescriptorSet>& writes) {
   device_.updateDescriptorSets(writes, nullptr);
 }
 
+void Gpu::UpdateDescriptorSet(
+    vk::DescriptorSet descriptor_set,
+    const vk::raii::DescriptorUpdateTemplate& descriptor_update_template,
+    const void* data) {
+  device_.getDispatcher()->vkUpdateDescriptorSetWithTemplate(
+      static_cast<VkDevice>(*device_),
+      static_cast<VkDescriptorSet>(descriptor_set),
+      static_cast<VkDescriptorUpdateTemplate>(*descriptor_update_template),
+      data);
+}
+
 vk::Result Gpu::WaitSemaphores(const vk::SemaphoreWaitInfo& semaphore_wi) {
   return device_.waitSemaphores(semaphore_wi, UINT64_MAX);
 }
@@ -586,11 +704,14 @@ void Gpu::CreateInstance() {
   std::unordered_map<std::string, bool> requested_instance_layers;
   std::unordered_map<std::string, bool> requested_instance_extensions;
 
-  std::vector<const char*> window_required_instance_extensions{
-      window_->GetRequiredInstanceExtensions()};
+  // Surface extensions are only needed to present.
+  if (!window_->IsHeadless()) {
+    std::vector<const char*> window_required_instance_extensions{
+        window_->GetRequiredInstanceExtensions()};
 
-  for (const char* wrie : window_required_instance_extensions) {
-    requested_instance_extensions.emplace(wrie, true);
+    for (const char* wrie : window_required_instance_extensions) {
+      requested_instance_extensions.emplace(wrie, true);
+    }
   }
 
 #ifdef __APPLE__
@@ -690,11 +811,24 @@ void Gpu::CreateInstance() {
 }
 
 void Gpu::CreateSurface() {
+  if (window_->IsHeadless()) {
+    return;
+  }
+
   VkSurfaceKHR surface{};
   window_->CreateWindowSurface(instance_, &surface);
   surface_ = vk::raii::SurfaceKHR{instance_, surface};
 }
 
+// Without a surface nothing is presented, every queue family qualifies.
+bool Gpu::CanPresent(u32 queue_family_index) const {
+  if (!*surface_) {
+    return true;
+  }
+  return static_cast<bool>(
+      physical_device_.getSurfaceSupportKHR(queue_family_index, *surface_));
+}
+
 void Gpu::CreatePhysicalDevice() {
   vk::raii::PhysicalDevices physical_devices{instance_};
 
@@ -741,7 +875,7 @@ void Gpu::CreateDevice() {
     if ((queue_famliy_propertie.queueFlags & vk::QueueFlagBits::eGraphics) &&
         (queue_famliy_propertie.queueFlags & vk::QueueFlagBits::eCompute) &&
         (queue_famliy_propertie.queueFlags & vk::QueueFlagBits::eTransfer) &&
-        physical_device_.getSurfaceSupportKHR(i, *surface_)) {
+        CanPresent(i)) {
       graphics_queue_index_ = i;
       compute_queue_index_ = i;
       transfer_queue_index_ = i;
@@ -763,7 +897,7 @@ void Gpu::CreateDevice() {
       if (queue_famliy_propertie.queueFlags & vk::QueueFlagBits::eTransfer) {
         transfer_queue_index_ = i;
       }
-      if (physical_device_.getSurfaceSupportKHR(i, *surface_)) {
+      if (CanPresent(i)) {
         present_queue_index_ = i;
       }
       if (graphics_queue_index_.has_value() &&
@@ -782,6 +916,30 @@ void Gpu::CreateDevice() {
     THROW("Fail to find queue family.");
   }
 
+  // A compute family without graphics lets compute passes run asynchronously
+  // next to the graphics queue.
+  i = 0;
+  for (const auto& queue_famliy_propertie : queue_family_properties) {
+    if ((queue_famliy_propertie.queueFlags & vk::QueueFlagBits::eCompute) &&
+        !(queue_famliy_propertie.queueFlags & vk::QueueFlagBits::eGraphics)) {
+      compute_queue_index_ = i;
+      LOGI("Use async compute queue family: {}", i);
+      break;
+    }
+    ++i;
+  }
+
+  concurrent_queue_indices_.clear();
+  for (u32 queue_family_index :
+       std::set<u32>{graphics_queue_index_.value(),
+                     compute_queue_index_.value(),
+                     transfer_queue_index_.value()}) {
+    concurrent_queue_indices_.push_back(queue_family_index);
+  }
+  if (concurrent_queue_indices_.size() == 1) {
+    concurrent_queue_indices_.clear();
+  }
+
   std::vector<vk::DeviceQueueCreateInfo> device_queue_cis;
   std::set<u32> queue_family_indexes{
       graphics_queue_index_.value(), compute_queue_index_.value(),
@@ -799,7 +957,7 @@ void Gpu::CreateDevice() {
       physical_device_.enumerateDeviceExtensionProperties()};
 
   std::unordered_map<std::string, bool> requested_device_extensions{
-      {VK_KHR_SWAPCHAIN_EXTENSION_NAME, true},
+      {VK_KHR_SWAPCHAIN_EXTENSION_NAME, !window_->IsHeadless()},
       {VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME, true},
       {VK_EXT_INDEX_TYPE_UINT8_EXTENSION_NAME, false}};
 
@@ -857,6 +1015,26 @@ void Gpu::CreateDevice() {
     THROW("Fail to enable required vulkan12 features");
   }
 
+  if (vulkan12_features.descriptorBindingSampledImageUpdateAfterBind &&
+      vulkan12_features.descriptorBindingUpdateUnusedWhilePending) {
+    enabled_vulkan12_features.descriptorBindingSampledImageUpdateAfterBind =
+        VK_TRUE;
+    enabled_vulkan12_features.descriptorBindingUpdateUnusedWhilePending =
+        VK_TRUE;
+    has_descriptor_update_after_bind_ = true;
+  } else {
+    has_descriptor_update_after_bind_ = false;
+    LOGI("Not support optional descriptor update after bind features");
+  }
+
+  if (vulkan12_features.bufferDeviceAddress) {
+    enabled_vulkan12_features.bufferDeviceAddress = VK_TRUE;
+    has_buffer_device_address_ = true;
+  } else {
+    has_buffer_device_address_ = false;
+    LOGI("Not support optional buffer device address features");
+  }
+
   vk::PhysicalDeviceSynchronization2FeaturesKHR
       enabled_synchronization2_features;
   const auto& synchronization2_features{
@@ -891,6 +1069,14 @@ void Gpu::CreateDevice() {
   vk::PhysicalDeviceFeatures enabled_features;
   const auto& features{
       features_chain.get<vk::PhysicalDeviceFeatures2>().features};
+  if (features.multiDrawIndirect && features.drawIndirectFirstInstance) {
+    enabled_features.multiDrawIndirect = VK_TRUE;
+    enabled_features.drawIndirectFirstInstance = VK_TRUE;
+    has_multi_draw_indirect_ = true;
+  } else {
+    has_multi_draw_indirect_ = false;
+    LOGI("Not support optional multi draw indirect features");
+  }
 
   vk::PhysicalDeviceFeatures2 enabled_features2{enabled_features, next_feature};
 
@@ -934,8 +1120,13 @@ void Gpu::CreateDevice() {
 }
 
 void Gpu::CreateVmaAllocator() {
+  VmaAllocatorCreateFlags allocator_flags{};
+  if (has_buffer_device_address_) {
+    allocator_flags |= VMA_ALLOCATOR_CREATE_BUFFER_DEVICE_ADDRESS_BIT;
+  }
+
   VmaAllocatorCreateInfo allocator_ci{
-      .flags = 0,
+      .flags = allocator_flags,
       .physicalDevice = static_cast<VkPhysicalDevice>(*physical_device_),
       .device = static_cast<VkDevice>(*device_),
       .instance = static_cast<VkInstance>(*instance_),
@@ -945,25 +1136,8 @@ void Gpu::CreateVmaAllocator() {
 }
 
 void Gpu::CreateDescriptorPool() {
-  // Bindless.
-  std::vector<vk::DescriptorPoolSize> bindlessl_pool_sizes{
-      {vk::DescriptorType::eSampler, 128},
-      {vk::DescriptorType::eSampledImage, 1024}};
-
-  u32 bindless_max_sets{std::accumulate(
-      bindlessl_pool_sizes.begin(), bindlessl_pool_sizes.end(),
-      static_cast<u32>(0), [](u32 sum, const vk::DescriptorPoolSize& dps) {
-        return sum + dps.descriptorCount;
-      })};
-
-  vk::DescriptorPoolCreateInfo bindless_descriptor_pool_ci{
-      vk::DescriptorPoolCreateFlagBits::eUpdateAfterBind |
-          vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet,
-      bindless_max_sets, bindlessl_pool_sizes};
-  bindless_descriptor_pool_ =
-      CreateDescriptorPool(bindless_descriptor_pool_ci, "bindless");
-
-  // Normal.
+  // Normal, left to imgui. Sets of the engine come from descriptor
+  // allocators of their owners.
   std::vector<vk::DescriptorPoolSize> normal_pool_sizes{
       {vk::DescriptorType::eSampler, 1024},
       {vk::DescriptorType::eCombinedImageSampler, 1024},
@@ -990,6 +1164,55 @@ void Gpu::CreateDescriptorPool() {
       CreateDescriptorPool(normal_descriptor_pool_ci, "normal");
 }
 
+void Gpu::CreateBindlessTable() {
+  auto properties_chain{physical_device_.getProperties2<
+      vk::PhysicalDeviceProperties2, vk::PhysicalDeviceVulkan12Properties>()};
+  const vk::PhysicalDeviceLimits& limits{
+      properties_chain.get<vk::PhysicalDeviceProperties2>().properties.limits};
+  const auto& vulkan12_properties{
+      properties_chain.get<vk::PhysicalDeviceVulkan12Properties>()};
+
+  u32 sampler_count{};
+  u32 image_count{};
+  if (has_descriptor_update_after_bind_) {
+    sampler_count = std::min(
+        {gpu::kBindlessSamplerMaxCount,
+         vulkan12_properties.maxPerStageDescriptorUpdateAfterBindSamplers,
+         vulkan12_properties.maxDescriptorSetUpdateAfterBindSamplers});
+    image_count = std::min(
+        {gpu::kBindlessImageMaxCount,
+         vulkan12_properties.maxPerStageDescriptorUpdateAfterBindSampledImages,
+         vulkan12_properties.maxDescriptorSetUpdateAfterBindSampledImages});
+  } else {
+    sampler_count = std::min({gpu::kBindlessSamplerMaxCount,
+                              limits.maxPerStageDescriptorSamplers,
+                              limits.maxDescriptorSetSamplers});
+    image_count = std::min({gpu::kBindlessImageMaxCount,
+                            limits.maxPerStageDescriptorSampledImages,
+                            limits.maxDescriptorSetSampledImages});
+  }
+
+  u32 material_count{gpu::kBindlessMaterialMaxCount};
+  std::vector<u8> material_data(
+      static_cast<u64>(material_count) * gpu::kBindlessMaterialStride);
+  vk::BufferCreateInfo material_buffer_ci{
+      {}, material_data.size(), vk::BufferUsageFlagBits::eStorageBuffer};
+  gpu::Buffer material_buffer{CreateBuffer(
+      material_buffer_ci, material_data.data(), true, "bindless_material")};
+
+  bindless_table_ = std::make_unique<gpu::BindlessTable>(
+      device_, std::move(material_buffer), sampler_count, image_count,
+      material_count, has_descriptor_update_after_bind_);
+
+#ifndef NDEBUG
+  SetObjectName(
+      vk::ObjectType::eDescriptorSet,
+      reinterpret_cast<uint64_t>(static_cast<VkDescriptorSet>(
+          *(bindless_table_->GetDescriptorSet()))),
+      "bindless", "Descriptor Set");
+#endif
+}
+
 void Gpu::CreateDefaultResource() {
   vk::SamplerCreateInfo sampler_ci{vk::SamplerCreateFlags(),
                                    vk::Filter::eLinear,
@@ -1011,6 +1234,92 @@ void Gpu::CreateDefaultResource() {
   sampler_ = CreateSampler(sampler_ci, "default");
 }
 
+void Gpu::LoadPipelineCache() {
+  std::filesystem::path root_path{GetPath(LUKA_ROOT_PATH)};
+  pipeline_cache_file_ = root_path / ".cache" / "engine" / "pipeline.cache";
+
+  // Data written by another driver or device is dropped, the header is all
+  // the driver promises to check itself.
+  std::vector<u8> pipeline_cache_data;
+  if (std::filesystem::exists(pipeline_cache_file_)) {
+    pipeline_cache_data = LoadBinaryU8(pipeline_cache_file_);
+
+    bool valid{pipeline_cache_data.size() >=
+               sizeof(vk::PipelineCacheHeaderVersionOne)};
+    if (valid) {
+      vk::PipelineCacheHeaderVersionOne header_version_one;
+      memcpy(&header_version_one, pipeline_cache_data.data(),
+             sizeof(vk::PipelineCacheHeaderVersionOne));
+      vk::PhysicalDeviceProperties physical_device_properties{
+          physical_device_.getProperties()};
+
+      valid = header_version_one.headerSize >=
+                  sizeof(vk::PipelineCacheHeaderVersionOne) &&
+              header_version_one.headerVersion ==
+                  vk::PipelineCacheHeaderVersion::eOne &&
+              header_version_one.vendorID ==
+                  physical_device_properties.vendorID &&
+              header_version_one.deviceID ==
+                  physical_device_properties.deviceID &&
+              header_version_one.pipelineCacheUUID ==
+                  physical_device_properties.pipelineCacheUUID;
+    }
+
+    if (!valid) {
+      LOGW("Discard pipeline cache {}", pipeline_cache_file_.string());
+      pipeline_cache_data.clear();
+    }
+  }
+
+  vk::PipelineCacheCreateInfo pipeline_cache_ci{
+      {}, pipeline_cache_data.size(), pipeline_cache_data.data()};
+  pipeline_cache_ = CreatePipelineCache(pipeline_cache_ci, "device");
+}
+
+// Runs from the destructor, so failures are logged and never thrown.
+void Gpu::SavePipelineCache() const {
+  std::vector<u8> pipeline_cache_data;
+  try {
+    pipeline_cache_data = GetPipelineCacheData();
+  } catch (const vk::SystemError&) {
+    LOGW("Fail to get pipeline cache data");
+    return;
+  }
+  if (pipeline_cache_data.empty()) {
+    return;
+  }
+
+  std::error_code error_code;
+  std::filesystem::create_directories(pipeline_cache_file_.parent_path(),
+                                      error_code);
+  if (error_code) {
+    LOGW("Fail to create {}", pipeline_cache_file_.parent_path().string());
+    return;
+  }
+
+  // Written next to the cache and renamed over it, an interrupted save never
+  // leaves a truncated cache behind.
+  std::filesystem::path temporary_file{pipeline_cache_file_};
+  temporary_file += ".tmp";
+  {
+    std::ofstream cache_file{temporary_file.string(), std::ios::binary};
+    cache_file.write(reinterpret_cast<const char*>(pipeline_cache_data.data()),
+                     static_cast<i64>(pipeline_cache_data.size()));
+    cache_file.close();
+    if (!cache_file) {
+      LOGW("Fail to write {}", temporary_file.string());
+      std::filesystem::remove(temporary_file, error_code);
+      return;
+    }
+  }
+
+  std::filesystem::rename(temporary_file, pipeline_cache_file_, error_code);
+  if (error_code) {
+    LOGW("Fail to rename {}", temporary_file.string());
+    std::filesystem::remove(temporary_file, error_code);
+  }
+}
+
 void Gpu::DestroyAllocator() { vmaDestroyAllocator(allocator_); }
 
 void Gpu::SetObjectName(vk::ObjectType object_type, u64 handle,
@@ -12,7 +12,11 @@
 #include <backends/imgui_impl_vulkan.h>
 #include <tiny_gltf.h>
 
+#include <mutex>
+
+#include "base/gpu/bindless_table.h"
 #include "base/gpu/buffer.h"
+#include "base/gpu/descriptor_allocator.h"
 #include "base/gpu/image.h"
 #include "base/window/window.h"
 #include "core/util.h"
@@ -35,16 +39,37 @@ class Gpu {
   vk::PhysicalDeviceProperties GetPhysicalDeviceProperties() const;
 
   bool HasIndexTypeUint8() const;
+  bool HasBufferDeviceAddress() const;
+  bool HasMultiDrawIndirect() const;
 
   u32 GetGraphicsQueueIndex() const;
   u32 GetComputeQueueIndex() const;
   u32 GetTransferQueueIndex() const;
   u32 GetPresentQueueIndex() const;
+  bool HasAsyncCompute() const;
+  const std::vector<u32>& GetConcurrentQueueIndices() const;
 
   ImGui_ImplVulkan_InitInfo GetImguiVulkanInitInfo() const;
 
   const vk::raii::Sampler& GetSampler() const;
 
+  // Device-wide bindless table, see gpu::BindlessTable.
+  const vk::raii::DescriptorSetLayout& GetBindlessDescriptorSetLayout() const;
+  const vk::raii::DescriptorSet& GetBindlessDescriptorSet() const;
+  u32 AddBindlessSampler(const vk::raii::Sampler& sampler);
+  u32 AddBindlessImage(const vk::raii::ImageView& image_view);
+  u32 AddBindlessMaterial(const void* data, u64 size);
+  void RemoveBindlessSampler(u32 index);
+  void RemoveBindlessImage(u32 index);
+  void RemoveBindlessMaterial(u32 index);
+
+  const vk::raii::PipelineCache& GetPipelineCache() const;
+  std::vector<u8> GetPipelineCacheData() const;
+  void MergePipelineCaches(
+      const std::vector<vk::raii::PipelineCache>& pipeline_caches);
+
+  vk::DeviceAddress GetBufferDeviceAddress(vk::Buffer buffer) const;
+
   gpu::Buffer CreateBuffer(const vk::BufferCreateInfo& buffer_ci,
                            const void* data, bool map = false,
                            const std::string& name = {}, i32 index = -1);
@@ -52,6 +77,9 @@ class Gpu {
                            const gpu::Buffer& staging_buffer,
                            const vk::raii::CommandBuffer& command_buffer,
                            const std::string& name = {}, i32 index = -1);
+  gpu::Buffer CreateDeviceBuffer(const vk::BufferCreateInfo& buffer_ci,
+                                 const std::string& name = {},
+                                 i32 index = -1);
   gpu::Image CreateImage(
       const vk::ImageCreateInfo& image_ci,
       const vk::ImageLayout& new_layout = vk::ImageLayout::eUndefined,
@@ -88,6 +116,11 @@ class Gpu {
   vk::raii::DescriptorPool CreateDescriptorPool(
       const vk::DescriptorPoolCreateInfo& descriptor_pool_ci,
       const std::string& name = {}, i32 index = -1);
+  gpu::DescriptorAllocator CreateDescriptorAllocator();
+  vk::raii::DescriptorUpdateTemplate CreateDescriptorUpdateTemplate(
+      const vk::DescriptorUpdateTemplateCreateInfo&
+          descriptor_update_template_ci,
+      const std::string& name = {}, i32 index = -1);
   vk::raii::DescriptorSetLayout CreateDescriptorSetLayout(
       const vk::DescriptorSetLayoutCreateInfo& descriptor_set_layout_ci,
       const std::string& name = {}, i32 index = -1);
@@ -112,14 +145,16 @@ class Gpu {
   vk::raii::CommandBuffers AllocateCommandBuffers(
       const vk::CommandBufferAllocateInfo& command_buffer_ai,
       const std::string& name = {}, i32 index = -1);
-  vk::raii::DescriptorSets AllocateNormalDescriptorSets(
-      vk::DescriptorSetAllocateInfo descriptor_set_ai,
-      const std::string& name = {}, i32 index = -1);
-  vk::raii::DescriptorSet AllocateBindlessDescriptorSet(
-      vk::DescriptorSetAllocateInfo descriptor_set_ai,
+  std::vector<vk::DescriptorSet> AllocateDescriptorSets(
+      gpu::DescriptorAllocator& descriptor_allocator,
+      const vk::DescriptorSetAllocateInfo& descriptor_set_ai,
       const std::string& name = {}, i32 index = -1);
 
   void UpdateDescriptorSets(const std::vector<vk::WriteDescriptorSet>& writes);
+  void UpdateDescriptorSet(
+      vk::DescriptorSet descriptor_set,
+      const vk::raii::DescriptorUpdateTemplate& descriptor_update_template,
+      const void* data);
   vk::Result WaitSemaphores(const vk::SemaphoreWaitInfo& semaphore_wi);
   vk::Result WaitForFences(const vk::raii::Fence& fence);
   void ResetFence(const vk::raii::Fence& fence);
@@ -139,12 +174,16 @@ class Gpu {
  private:
   void CreateInstance();
   void CreateSurface();
+  bool CanPresent(u32 queue_family_index) const;
   void CreatePhysicalDevice();
   void CreateDevice();
   void CreateVmaAllocator();
   void CreateDescriptorPool();
+  void CreateBindlessTable();
   void CreateDefaultResource();
+  void LoadPipelineCache();
 
+  void SavePipelineCache() const;
   void DestroyAllocator();
 
   void SetObjectName(vk::ObjectType object_type, u64 handle,
@@ -175,8 +214,12 @@ class Gpu {
   std::optional<u32> compute_queue_index_;
   std::optional<u32> transfer_queue_index_;
   std::optional<u32> present_queue_index_;
+  std::vector<u32> concurrent_queue_indices_;
   std::unordered_set<std::string> enabled_device_extensions_;
   bool has_index_type_uint8_{};
+  bool has_buffer_device_address_{};
+  bool has_multi_draw_indirect_{};
+  bool has_descriptor_update_after_bind_{};
   vk::raii::Device device_{nullptr};
   vk::raii::Queue graphics_queue_{nullptr};
   vk::raii::Queue compute_queue_{nullptr};
@@ -185,13 +228,19 @@ class Gpu {
 
   VmaAllocator allocator_{};
 
-  vk::raii::DescriptorPool bindless_descriptor_pool_{nullptr};
   vk::raii::DescriptorPool normal_descriptor_pool_{nullptr};
+  std::unique_ptr<gpu::BindlessTable> bindless_table_;
 
   std::vector<std::unordered_map<std::string, vk::ImageView>>
       shared_image_views_;
 
   vk::raii::Sampler sampler_{nullptr};
+
+  std::filesystem::path pipeline_cache_file_;
+  vk::raii::PipelineCache pipeline_cache_{nullptr};
+  // Merges from the shader reload task race with pipelines created on the
+  // render thread, the device cache must be externally synchronized.
+  mutable std::mutex pipeline_cache_mutex_;
 };
 
 }  // namespace luka
\ No newline at end of file
@@ -20,9 +20,23 @@ Image::Image(const VmaAllocator& allocator, const vk::ImageCreateInfo& image_ci)
     : allocator_{allocator} {
   VkImageCreateInfo vk_image_ci{static_cast<VkImageCreateInfo>(image_ci)};
   VmaAllocationCreateInfo allocation_ci{.usage = VMA_MEMORY_USAGE_AUTO};
+  // Transient attachments prefer lazily allocated memory, which tile-based
+  // hardware never commits. Other devices fall back to regular memory.
+  if (image_ci.usage & vk::ImageUsageFlagBits::eTransientAttachment) {
+    allocation_ci.usage = VMA_MEMORY_USAGE_GPU_LAZILY_ALLOCATED;
+  }
   VkImage image{};
-  vmaCreateImage(allocator_, &vk_image_ci, &allocation_ci, &image, &allocation_,
-                 nullptr);
+  VkResult result{vmaCreateImage(allocator_, &vk_image_ci, &allocation_ci,
+                                 &image, &allocation_, nullptr)};
+  if (result != VK_SUCCESS &&
+      allocation_ci.usage == VMA_MEMORY_USAGE_GPU_LAZILY_ALLOCATED) {
+    allocation_ci.usage = VMA_MEMORY_USAGE_AUTO;
+    result = vmaCreateImage(allocator_, &vk_image_ci, &allocation_ci, &image,
+                            &allocation_, nullptr);
+  }
+  if (result != VK_SUCCESS) {
+    THROW("Fail to create image ({}).", static_cast<i32>(result));
+  }
   image_ = image;
 }
 
@@ -23,8 +23,9 @@ void TaskScheduler::AddTaskSetToPipe(enki::ITaskSet* task_set) {
   task_scheduler_.AddTaskSetToPipe(task_set);
 }
 
-void TaskScheduler::WaitforTask(const enki::ICompletable* completable) {
-  task_scheduler_.WaitforTask(completable);
+void TaskScheduler::WaitforTask(const enki::ICompletable* completable,
+                                enki::TaskPriority lowest_priority) {
+  task_scheduler_.WaitforTask(completable, lowest_priority);
 }
 
 }  // namespace luka
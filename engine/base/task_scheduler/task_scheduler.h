@@ -19,7 +19,11 @@ class TaskScheduler {
 
   u32 GetThreadCount() const;
   void AddTaskSetToPipe(enki::ITaskSet* task_set);
-  void WaitforTask(const enki::ICompletable* completable);
+  // Tasks of lower priority than the given one are left to other threads, so
+  // a frame never waits on background work picked up while waiting.
+  void WaitforTask(
+      const enki::ICompletable* completable,
+      enki::TaskPriority lowest_priority = enki::TASK_PRIORITY_HIGH);
 
  private:
   const u32 kThreadCount{3};
@@ -11,7 +11,14 @@
 
 namespace luka {
 
-Window::Window(const WindowInfo& window_info) {
+Window::Window(const WindowInfo& window_info)
+    : headless_{window_info.headless},
+      headless_width_{window_info.width},
+      headless_height_{window_info.height} {
+  if (headless_) {
+    return;
+  }
+
   if (!static_cast<bool>(glfwInit())) {
     THROW("Fail to init glfw.");
   }
@@ -54,11 +61,21 @@ Window::Window(const WindowInfo& window_info) {
 }
 
 Window::~Window() {
+  if (headless_) {
+    return;
+  }
   glfwDestroyWindow(glfw_window_);
   glfwTerminate();
 }
 
-void Window::Tick() { glfwPollEvents(); }
+void Window::Tick() const {
+  if (headless_) {
+    return;
+  }
+  glfwPollEvents();
+}
+
+bool Window::IsHeadless() const { return headless_; }
 
 GLFWwindow* Window::GetGlfwWindow() const { return glfw_window_; }
 
@@ -67,21 +84,33 @@ bool Window::GetWindowResized() const { return window_resized_; }
 void Window::SetWindowResized(bool resized) { window_resized_ = resized; }
 
 void Window::GetWindowSize(i32* width, i32* height) const {
+  if (headless_) {
+    *width = headless_width_;
+    *height = headless_height_;
+    return;
+  }
   glfwGetWindowSize(glfw_window_, width, height);
 }
 
 f32 Window::GetWindowRatio() const {
   i32 width{};
   i32 height{};
-  glfwGetWindowSize(glfw_window_, &width, &height);
+  GetWindowSize(&width, &height);
   return static_cast<f32>(width) / static_cast<f32>(height);
 }
 
 bool Window::WindowShouldClose() const {
+  if (headless_) {
+    return headless_should_close_;
+  }
   return static_cast<bool>(glfwWindowShouldClose(glfw_window_));
 }
 
 void Window::SetWindowShouldClose() {
+  if (headless_) {
+    headless_should_close_ = true;
+    return;
+  }
   glfwSetWindowShouldClose(glfw_window_, GLFW_TRUE);
 }
 
@@ -96,6 +125,11 @@ void Window::SetFramebufferResized(bool resized) {
 }
 
 void Window::GetFramebufferSize(i32* width, i32* height) const {
+  if (headless_) {
+    *width = headless_width_;
+    *height = headless_height_;
+    return;
+  }
   glfwGetFramebufferSize(glfw_window_, width, height);
 }
 
@@ -103,25 +137,33 @@ bool Window::GetFocusMode() const { return focus_mode_; }
 
 void Window::SetFocusMode(bool mode) {
   focus_mode_ = mode;
+  if (headless_) {
+    return;
+  }
   glfwSetInputMode(glfw_window_, GLFW_CURSOR,
                    focus_mode_ ? GLFW_CURSOR_DISABLED : GLFW_CURSOR_NORMAL);
 }
 
 bool Window::IsMouseButtonDown(int button) const {
-  if (button < GLFW_MOUSE_BUTTON_1 || button > GLFW_MOUSE_BUTTON_LAST) {
+  if (headless_ || button < GLFW_MOUSE_BUTTON_1 ||
+      button > GLFW_MOUSE_BUTTON_LAST) {
     return false;
   }
   return glfwGetMouseButton(glfw_window_, button) == GLFW_PRESS;
 }
 
 bool Window::IsMouseButtonRelease(int button) const {
-  if (button < GLFW_MOUSE_BUTTON_1 || button > GLFW_MOUSE_BUTTON_LAST) {
+  if (headless_ || button < GLFW_MOUSE_BUTTON_1 ||
+      button > GLFW_MOUSE_BUTTON_LAST) {
     return false;
   }
   return glfwGetMouseButton(glfw_window_, button) == GLFW_RELEASE;
 }
 
 void Window::SetCursorPos(f64 xpos, f64 ypos) {
+  if (headless_) {
+    return;
+  }
   glfwSetCursorPos(glfw_window_, xpos, ypos);
 }
 
@@ -14,10 +14,13 @@
 
 namespace luka {
 
+// A headless window never touches glfw, it only reports its size, so the
+// engine runs where there is no display.
 struct WindowInfo {
   i32 width;
   i32 height;
   std::string title;
+  bool headless;
 };
 
 class Window {
@@ -40,12 +43,13 @@ class Window {
 
   DELETE_SPECIAL_MEMBER_FUNCTIONS(Window);
 
-  explicit Window(const WindowInfo& window_info = {640, 640, "luka"});
+  explicit Window(const WindowInfo& window_info = {640, 640, "luka", false});
 
   ~Window();
 
-  static void Tick();
+  void Tick() const;
 
+  bool IsHeadless() const;
   GLFWwindow* GetGlfwWindow() const;
   bool GetWindowResized() const;
   f32 GetWindowRatio() const;
@@ -132,6 +136,11 @@ class Window {
   void WindowIconify(i32 iconified);
   void FramebufferSize(i32 width, i32 height);
 
+  bool headless_{};
+  i32 headless_width_{};
+  i32 headless_height_{};
+  bool headless_should_close_{};
+
   GLFWwindow* glfw_window_{};
   bool window_resized_{};
   bool window_iconified_{};
@@ -0,0 +1,119 @@
+// SPDX license identifier: MIT.
+// Copyright (C) 2023-present Liam Hauw.
+
+// clang-format off
+#include "platform/pch.h"
+// clang-format on
+
+#include "core/file_watcher.h"
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#include "core/log.h"
+
+namespace luka {
+
+namespace {
+
+std::filesystem::file_time_type GetWriteTime(
+    const std::filesystem::path& path) {
+  std::error_code error_code;
+  std::filesystem::file_time_type write_time{
+      std::filesystem::last_write_time(path, error_code)};
+  return error_code ? std::filesystem::file_time_type{} : write_time;
+}
+
+}  // namespace
+
+FileWatcher::FileWatcher() {
+#ifdef __linux__
+  inotify_fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (inotify_fd_ == -1) {
+    LOGW("Fail to init inotify, poll write times instead");
+  }
+#endif
+}
+
+FileWatcher::~FileWatcher() {
+#ifdef __linux__
+  if (inotify_fd_ != -1) {
+    close(inotify_fd_);
+  }
+#endif
+}
+
+void FileWatcher::Watch(const std::filesystem::path& path) {
+  std::filesystem::path watched_path{path.lexically_normal()};
+  if (!write_times_.emplace(watched_path.string(), GetWriteTime(watched_path))
+           .second) {
+    return;
+  }
+
+#ifdef __linux__
+  // Editors often save by renaming a new file over the old one, so the
+  // directory is watched rather than the file.
+  if (inotify_fd_ == -1) {
+    return;
+  }
+  std::filesystem::path directory{watched_path.parent_path()};
+  if (directory_watches_.contains(directory.string())) {
+    return;
+  }
+  i32 watch{inotify_add_watch(inotify_fd_, directory.c_str(),
+                              IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE)};
+  if (watch == -1) {
+    LOGW("Fail to watch {}", directory.string());
+    return;
+  }
+  directory_watches_.emplace(directory.string(), watch);
+  watch_directories_.emplace(watch, directory);
+#endif
+}
+
+std::vector<std::filesystem::path> FileWatcher::Poll() {
+  std::vector<std::filesystem::path> changed_paths;
+  std::unordered_set<std::string> changed_path_strings;
+  auto add_changed_path{[&](const std::filesystem::path& path) {
+    auto it{write_times_.find(path.string())};
+    if (it == write_times_.end() ||
+        !changed_path_strings.insert(it->first).second) {
+      return;
+    }
+    it->second = GetWriteTime(path);
+    changed_paths.push_back(path);
+  }};
+
+#ifdef __linux__
+  if (inotify_fd_ != -1) {
+    alignas(inotify_event) char buffer[4096];
+    while (true) {
+      ssize_t size{read(inotify_fd_, buffer, sizeof(buffer))};
+      if (size <= 0) {
+        break;
+      }
+      for (ssize_t offset{}; offset < size;) {
+        const auto* event{
+            reinterpret_cast<const inotify_event*>(buffer + offset)};
+        auto it{watch_directories_.find(event->wd)};
+        if (it != watch_directories_.end() && event->len > 0) {
+          add_changed_path(it->second / event->name);
+        }
+        offset += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+      }
+    }
+    return changed_paths;
+  }
+#endif
+
+  for (const auto& [path, write_time] : write_times_) {
+    if (GetWriteTime(path) != write_time) {
+      add_changed_path(path);
+    }
+  }
+  return changed_paths;
+}
+
+}  // namespace luka
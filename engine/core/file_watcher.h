@@ -0,0 +1,41 @@
+// SPDX license identifier: MIT.
+// Copyright (C) 2023-present Liam Hauw.
+
+#pragma once
+
+// clang-format off
+#include "platform/pch.h"
+// clang-format on
+
+#include "core/util.h"
+
+namespace luka {
+
+/**
+ * Reports files written since the last poll. Linux watches their directories
+ * with inotify, other platforms compare write times on every poll.
+ */
+class FileWatcher {
+ public:
+  DELETE_SPECIAL_MEMBER_FUNCTIONS(FileWatcher)
+
+  FileWatcher();
+
+  ~FileWatcher();
+
+  void Watch(const std::filesystem::path& path);
+
+  std::vector<std::filesystem::path> Poll();
+
+ private:
+  std::unordered_map<std::string, std::filesystem::file_time_type>
+      write_times_;
+
+#ifdef __linux__
+  i32 inotify_fd_{-1};
+  std::unordered_map<std::string, i32> directory_watches_;
+  std::unordered_map<i32, std::filesystem::path> watch_directories_;
+#endif
+};
+
+}  // namespace luka
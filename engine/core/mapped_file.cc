@@ -0,0 +1,113 @@
+// SPDX license identifier: MIT.
+// Copyright (C) 2023-present Liam Hauw.
+
+// clang-format off
+#include "platform/pch.h"
+// clang-format on
+
+#include "core/mapped_file.h"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "core/log.h"
+
+namespace luka {
+
+MappedFile::~MappedFile() { Unmap(); }
+
+void MappedFile::Map(const std::filesystem::path& path) {
+  Unmap();
+
+  if (!std::filesystem::exists(path)) {
+    return;
+  }
+
+#ifdef _WIN32
+  file_ = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                      OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file_ == INVALID_HANDLE_VALUE) {
+    file_ = nullptr;
+    THROW("Fail to open {}", path.string());
+  }
+
+  LARGE_INTEGER file_size{};
+  GetFileSizeEx(file_, &file_size);
+  size_ = static_cast<u64>(file_size.QuadPart);
+  if (size_ == 0) {
+    return;
+  }
+
+  mapping_ = CreateFileMappingW(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (!mapping_) {
+    THROW("Fail to map {}", path.string());
+  }
+  data_ = static_cast<const u8*>(
+      MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+#else
+  file_ = open(path.c_str(), O_RDONLY);
+  if (file_ == -1) {
+    THROW("Fail to open {}", path.string());
+  }
+
+  struct stat file_stat {};
+  fstat(file_, &file_stat);
+  size_ = static_cast<u64>(file_stat.st_size);
+  if (size_ == 0) {
+    return;
+  }
+
+  void* data{mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, file_, 0)};
+  if (data != MAP_FAILED) {
+    data_ = static_cast<const u8*>(data);
+  }
+#endif
+
+  if (!data_) {
+    THROW("Fail to map {}", path.string());
+  }
+}
+
+void MappedFile::Unmap() {
+#ifdef _WIN32
+  if (data_) {
+    UnmapViewOfFile(data_);
+  }
+  if (mapping_) {
+    CloseHandle(mapping_);
+    mapping_ = nullptr;
+  }
+  if (file_) {
+    CloseHandle(file_);
+    file_ = nullptr;
+  }
+#else
+  if (data_) {
+    munmap(const_cast<u8*>(data_), size_);
+  }
+  if (file_ != -1) {
+    close(file_);
+    file_ = -1;
+  }
+#endif
+  data_ = nullptr;
+  size_ = 0;
+}
+
+const u8* MappedFile::GetData() const { return data_; }
+
+u64 MappedFile::GetSize() const { return size_; }
+
+}  // namespace luka
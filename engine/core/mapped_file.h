@@ -0,0 +1,40 @@
+// SPDX license identifier: MIT.
+// Copyright (C) 2023-present Liam Hauw.
+
+#pragma once
+
+// clang-format off
+#include "platform/pch.h"
+// clang-format on
+
+#include "core/util.h"
+
+namespace luka {
+
+// Read-only view of a whole file, empty when the file is missing or empty.
+class MappedFile {
+ public:
+  DELETE_SPECIAL_MEMBER_FUNCTIONS(MappedFile)
+
+  MappedFile() = default;
+
+  ~MappedFile();
+
+  void Map(const std::filesystem::path& path);
+  void Unmap();
+
+  const u8* GetData() const;
+  u64 GetSize() const;
+
+ private:
+#ifdef _WIN32
+  void* file_{};
+  void* mapping_{};
+#else
+  i32 file_{-1};
+#endif
+  const u8* data_{};
+  u64 size_{};
+};
+
+}  // namespace luka
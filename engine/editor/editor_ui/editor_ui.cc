@@ -17,7 +17,7 @@ EditorUi::EditorUi(std::shared_ptr<Window> window,
       time_{std::move(time)} {}
 
 void EditorUi::Tick() {
-  if (window_->GetIconified()) {
+  if (window_->IsHeadless() || window_->GetIconified()) {
     return;
   }
 
@@ -7,13 +7,15 @@
 
 #include "engine.h"
 
+#include "core/log.h"
+
 namespace luka {
 
 Engine::Engine()
     : task_scheduler_{std::make_shared<TaskScheduler>()},
-      window_{std::make_shared<Window>()},
-      gpu_{std::make_shared<Gpu>(window_)},
       config_{std::make_shared<Config>()},
+      window_{std::make_shared<Window>(GetWindowInfo(*config_))},
+      gpu_{std::make_shared<Gpu>(window_)},
       asset_{std::make_shared<Asset>(task_scheduler_, gpu_, config_)},
       time_{std::make_shared<Time>()},
       camera_{std::make_shared<Camera>(window_)},
@@ -27,6 +29,11 @@ Engine::Engine()
                                              function_ui_)} {}
 
 void Engine::Run() {
+  bool headless{config_->GetHeadless()};
+  u32 headless_frame_count{config_->GetHeadlessFrameCount()};
+  u32 frame_count{};
+  auto start_time{std::chrono::steady_clock::now()};
+
   while (!window_->WindowShouldClose()) {
     task_scheduler_->Tick();
     window_->Tick();
@@ -40,7 +47,28 @@ void Engine::Run() {
     editor_input_->Tick();
     editor_ui_->Tick();
     framework_->Tick();
+
+    if (headless && ++frame_count >= headless_frame_count) {
+      window_->SetWindowShouldClose();
+    }
+  }
+
+  if (headless) {
+    gpu_->WaitIdle();
+    f64 total_time{std::chrono::duration<f64, std::milli>(
+                       std::chrono::steady_clock::now() - start_time)
+                       .count()};
+    LOGI("Headless: {} frames in {:.3f} ms, {:.3f} ms per frame.", frame_count,
+         total_time, frame_count == 0 ? 0.0 : total_time / frame_count);
+  }
+}
+
+WindowInfo Engine::GetWindowInfo(const Config& config) {
+  if (!config.GetHeadless()) {
+    return {640, 640, "luka", false};
   }
+  return {static_cast<i32>(config.GetHeadlessWidth()),
+          static_cast<i32>(config.GetHeadlessHeight()), "luka", true};
 }
 
 }  // namespace luka
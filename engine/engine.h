@@ -29,10 +29,12 @@ class Engine {
   void Run();
 
  private:
+  static WindowInfo GetWindowInfo(const Config& config);
+
   std::shared_ptr<TaskScheduler> task_scheduler_;
+  std::shared_ptr<Config> config_;
   std::shared_ptr<Window> window_;
   std::shared_ptr<Gpu> gpu_;
-  std::shared_ptr<Config> config_;
   std::shared_ptr<Asset> asset_;
   std::shared_ptr<Time> time_;
   std::shared_ptr<Camera> camera_;
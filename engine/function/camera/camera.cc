@@ -13,8 +13,9 @@ Camera::Camera(std::shared_ptr<Window> window)
     : window_{std::move(window)},
       view_matirx_{glm::mat4(glm::lookAt(position_, position_ + look_,
                                          glm::cross(right_, look_)))},
-      projection_matirx_{glm::perspective(
-          glm::radians(60.0F), window_->GetWindowRatio(), 0.1F, 1000.0F)} {
+      projection_matirx_{glm::perspective(glm::radians(60.0F),
+                                          window_->GetWindowRatio(),
+                                          near_plane_, far_plane_)} {
   projection_matirx_[1][1] *= -1;
 }
 
@@ -24,8 +25,9 @@ void Camera::Tick() {
   }
 
   if (window_->GetFramebufferResized()) {
-    projection_matirx_ = glm::perspective(
-        glm::radians(60.0F), window_->GetWindowRatio(), 0.1F, 1000.0F);
+    projection_matirx_ =
+        glm::perspective(glm::radians(60.0F), window_->GetWindowRatio(),
+                         near_plane_, far_plane_);
     projection_matirx_[1][1] *= -1;
   }
 }
@@ -63,4 +65,8 @@ const glm::mat4& Camera::GetProjectionMatrix() const {
   return projection_matirx_;
 }
 
+f32 Camera::GetNearPlane() const { return near_plane_; }
+
+f32 Camera::GetFarPlane() const { return far_plane_; }
+
 }  // namespace luka
\ No newline at end of file
@@ -25,6 +25,8 @@ class Camera {
   const glm::vec3& GetPosition() const;
   const glm::mat4& GetViewMatrix();
   const glm::mat4& GetProjectionMatrix() const;
+  f32 GetNearPlane() const;
+  f32 GetFarPlane() const;
 
  private:
   std::shared_ptr<Window> window_;
@@ -32,6 +34,8 @@ class Camera {
   glm::vec3 position_{0.0F, 2.0F, 4.0F};
   glm::vec3 look_{0.0F, 0.0F, -1.0F};
   glm::vec3 right_{1.0F, 0.0F, 0.0F};
+  f32 near_plane_{0.1F};
+  f32 far_plane_{1000.0F};
 
   bool view_matrix_dirty_{};
   glm::mat4 view_matirx_{};
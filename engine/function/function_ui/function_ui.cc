@@ -9,16 +9,28 @@
 
 namespace luka {
 
+namespace {
+
+constexpr u32 kOffscreenImageCount{3};
+
+}  // namespace
+
 FunctionUi::FunctionUi(std::shared_ptr<Window> window, std::shared_ptr<Gpu> gpu)
-    : window_{std::move(window)}, gpu_{std::move(gpu)} {
-  CreateSwapchain();
+    : window_{std::move(window)},
+      gpu_{std::move(gpu)},
+      headless_{window_->IsHeadless()} {
+  if (headless_) {
+    CreateOffscreenImages();
+  } else {
+    CreateSwapchain();
+  }
   CreateImgui();
 }
 
 FunctionUi::~FunctionUi() { DestroyImgui(); }
 
 void FunctionUi::Tick() {
-  if (window_->GetIconified()) {
+  if (headless_ || window_->GetIconified()) {
     return;
   }
 
@@ -30,7 +42,10 @@ void FunctionUi::Tick() {
   CreateUi();
 }
 
-void FunctionUi::Render(const vk::raii::CommandBuffer& command_buffer) {
+void FunctionUi::Render(const vk::raii::CommandBuffer& command_buffer) const {
+  if (headless_) {
+    return;
+  }
   ImGui::Render();
   ImDrawData* draw_data{ImGui::GetDrawData()};
   ImGui_ImplVulkan_RenderDrawData(
@@ -145,6 +160,42 @@ void FunctionUi::CreateSwapchain() {
   swapchain_ = gpu_->CreateSwapchain(swapchain_ci);
 }
 
+void FunctionUi::CreateOffscreenImages() {
+  i32 width{};
+  i32 height{};
+  window_->GetFramebufferSize(&width, &height);
+
+  swapchain_info_.image_count = kOffscreenImageCount;
+  swapchain_info_.color_format = vk::Format::eR8G8B8A8Srgb;
+  swapchain_info_.color_space = vk::ColorSpaceKHR::eSrgbNonlinear;
+  swapchain_info_.extent =
+      vk::Extent2D{static_cast<u32>(width), static_cast<u32>(height)};
+  swapchain_info_.present_mode = vk::PresentModeKHR::eFifo;
+
+  // Frames are left in transfer source layout, ready to be read back.
+  vk::ImageCreateInfo image_ci{
+      {},
+      vk::ImageType::e2D,
+      swapchain_info_.color_format,
+      {swapchain_info_.extent.width, swapchain_info_.extent.height, 1},
+      1,
+      1,
+      vk::SampleCountFlagBits::e1,
+      vk::ImageTiling::eOptimal,
+      vk::ImageUsageFlagBits::eColorAttachment |
+          vk::ImageUsageFlagBits::eTransferSrc,
+      vk::SharingMode::eExclusive,
+      {},
+      vk::ImageLayout::eUndefined};
+
+  offscreen_images_.clear();
+  for (u32 i{}; i < swapchain_info_.image_count; ++i) {
+    offscreen_images_.push_back(gpu_->CreateImage(
+        image_ci, vk::ImageLayout::eUndefined, nullptr, "offscreen",
+        static_cast<i32>(i)));
+  }
+}
+
 void FunctionUi::CreateImgui() {
   // Ui render pass.
   std::vector<vk::AttachmentDescription> attachment_descriptions;
@@ -154,7 +205,8 @@ void FunctionUi::CreateImgui() {
       vk::SampleCountFlagBits::e1, vk::AttachmentLoadOp::eClear,
       vk::AttachmentStoreOp::eStore, vk::AttachmentLoadOp::eClear,
       vk::AttachmentStoreOp::eStore, vk::ImageLayout::eUndefined,
-      vk::ImageLayout::ePresentSrcKHR);
+      headless_ ? vk::ImageLayout::eTransferSrcOptimal
+                : vk::ImageLayout::ePresentSrcKHR);
 
   vk::AttachmentReference color_attachment_refs{
       0, vk::ImageLayout::eColorAttachmentOptimal};
@@ -177,6 +229,11 @@ void FunctionUi::CreateImgui() {
 
   ui_render_pass_ = gpu_->CreateRenderPass(render_pass_ci, "ui");
 
+  // There is no window to draw the ui on.
+  if (headless_) {
+    return;
+  }
+
   // ImGui.
   IMGUI_CHECKVERSION();
   ImGui::CreateContext();
@@ -194,7 +251,10 @@ void FunctionUi::CreateImgui() {
   ImGui_ImplVulkan_Init(&init_info);
 }
 
-void FunctionUi::DestroyImgui() {
+void FunctionUi::DestroyImgui() const {
+  if (headless_) {
+    return;
+  }
   ImGui_ImplVulkan_Shutdown();
   ImGui_ImplGlfw_Shutdown();
   ImGui::DestroyContext();
@@ -213,6 +273,8 @@ void FunctionUi::UpdateImgui() {
 
 void FunctionUi::CreateUi() {}
 
+bool FunctionUi::IsHeadless() const { return headless_; }
+
 const SwapchainInfo& FunctionUi::GetSwapchainInfo() const {
   return swapchain_info_;
 }
@@ -221,6 +283,19 @@ const vk::raii::SwapchainKHR& FunctionUi::GetSwapchain() const {
   return swapchain_;
 }
 
+std::vector<vk::Image> FunctionUi::GetSwapchainImages() const {
+  if (!headless_) {
+    return swapchain_.getImages();
+  }
+
+  std::vector<vk::Image> images;
+  images.reserve(offscreen_images_.size());
+  for (const auto& offscreen_image : offscreen_images_) {
+    images.push_back(*offscreen_image);
+  }
+  return images;
+}
+
 vk::raii::RenderPass FunctionUi::GetUiRenderPass() {
   return std::move(ui_render_pass_);
 }
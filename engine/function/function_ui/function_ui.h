@@ -35,28 +35,34 @@ class FunctionUi {
 
   void Tick();
 
-  static void Render(const vk::raii::CommandBuffer& command_buffer);
+  void Render(const vk::raii::CommandBuffer& command_buffer) const;
+  void Resize();
 
+  bool IsHeadless() const;
   const SwapchainInfo& GetSwapchainInfo() const;
   const vk::raii::SwapchainKHR& GetSwapchain() const;
+  std::vector<vk::Image> GetSwapchainImages() const;
 
   vk::raii::RenderPass GetUiRenderPass();
 
  private:
   void CreateSwapchain();
+  void CreateOffscreenImages();
   void CreateImgui();
 
-  static void DestroyImgui();
+  void DestroyImgui() const;
 
-  void Resize();
   static void UpdateImgui();
   void CreateUi();
 
   std::shared_ptr<Window> window_;
   std::shared_ptr<Gpu> gpu_;
 
+  bool headless_{};
   SwapchainInfo swapchain_info_{};
   vk::raii::SwapchainKHR swapchain_{nullptr};
+  // Stand in for the swapchain images when there is no window.
+  std::vector<gpu::Image> offscreen_images_;
 
   vk::raii::RenderPass ui_render_pass_{nullptr};
 };
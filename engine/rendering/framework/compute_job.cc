@@ -14,10 +14,13 @@
 #include <vulkan/vulkan_hash.hpp>
 
 #include "core/log.h"
+#include "core/util.h"
+#include "rendering/framework/descriptor_update.h"
 
 namespace luka::fw {
 ComputeJob::ComputeJob(
-    std::shared_ptr<Gpu> gpu, std::shared_ptr<Asset> asset, u32 frame_count,
+    std::shared_ptr<Gpu> gpu, std::shared_ptr<ResourceCache> resource_cache,
+    std::shared_ptr<Asset> asset, u32 frame_count,
     const std::vector<std::vector<vk::raii::ImageView>>& attachment_image_views,
     const ast::ComputeJob& ast_compute_job,
     std::vector<std::unordered_map<std::string, vk::Image>>* shared_images,
@@ -25,6 +28,7 @@ ComputeJob::ComputeJob(
         shared_image_views,
     const SwapchainInfo& swapchain_info)
     : gpu_{std::move(gpu)},
+      resource_cache_{std::move(resource_cache)},
       asset_{std::move(asset)},
       frame_count_{frame_count},
       attachment_image_views_{&attachment_image_views},
@@ -32,6 +36,7 @@ ComputeJob::ComputeJob(
       shared_images_{shared_images},
       shared_image_views_{shared_image_views},
       shader_{ast_compute_job_->shader},
+      descriptor_allocator_{gpu_->CreateDescriptorAllocator()},
       swapchain_info_{&swapchain_info},
       group_count_x_{swapchain_info_->extent.width / 16},
       group_count_y_{swapchain_info_->extent.height / 16} {
@@ -42,7 +47,9 @@ ComputeJob::ComputeJob(
                        sorted_sets_, push_constant_ranges_);
   CreatePipelineResources(set_shader_resources_, sorted_sets_,
                           push_constant_ranges_);
-  CreatePipeline(spirv);
+  interface_hash_value_ = HashShaderInterface(name_shader_resources);
+  pipeline_hash_value_ = CreatePipeline(spirv);
+  pipeline_ = &resource_cache_->GetPipeline(pipeline_hash_value_);
 }
 
 void ComputeJob::Resize(
@@ -55,6 +62,8 @@ void ComputeJob::Resize(
   shared_image_views_ = shared_image_views;
   uniforms_.clear();
   uniform_buffers_.clear();
+  descriptor_allocator_.Reset();
+  descriptor_sets_.clear();
 
   CreatePipelineResources(set_shader_resources_, sorted_sets_,
                           push_constant_ranges_);
@@ -75,11 +84,13 @@ void ComputeJob::Update(u32 frame_index) {
 
 const vk::raii::Pipeline* ComputeJob::GetPipeline() const { return pipeline_; }
 
+u64 ComputeJob::GetPipelineHashValue() const { return pipeline_hash_value_; }
+
 const vk::raii::PipelineLayout* ComputeJob::GetPipelineLayout() const {
   return pipeline_layout_;
 }
 
-const vk::raii::DescriptorSets& ComputeJob::GetDescriptorSets(
+const std::vector<vk::DescriptorSet>& ComputeJob::GetDescriptorSets(
     u32 frame_index) const {
   return descriptor_sets_[frame_index];
 }
@@ -90,50 +101,107 @@ u32 ComputeJob::GetGroupCountY() const { return group_count_y_; }
 
 u32 ComputeJob::GetGroupCountZ() const { return group_count_z_; }
 
+const std::unordered_set<std::string>& ComputeJob::GetSharedImageNames() const {
+  return shared_image_names_;
+}
+
+void ComputeJob::SetStorageImageDependency(
+    const std::string& name, const StorageImageDependency& dependency) {
+  storage_image_dependencies_[name] = dependency;
+}
+
 void ComputeJob::PreTransferResources(
     const vk::raii::CommandBuffer& command_buffer, u32 frame_index) const {
-  for (auto tr : image_layout_trans_[frame_index]) {
-    vk::Image image{tr.first};
-    const auto& layout{tr.second};
-    vk::ImageLayout ext{layout.first};
-    vk::ImageLayout inn{layout.second};
-    vk::ImageMemoryBarrier barrier{
-        {},
-        vk::AccessFlagBits::eShaderWrite | vk::AccessFlagBits::eShaderRead,
-        ext,
-        inn,
-        VK_QUEUE_FAMILY_IGNORED,
-        VK_QUEUE_FAMILY_IGNORED,
-        image,
-        {vk::ImageAspectFlagBits::eColor, 0, VK_REMAINING_MIP_LEVELS, 0,
-         VK_REMAINING_ARRAY_LAYERS}};
-    command_buffer.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe,
-                                   vk::PipelineStageFlagBits::eAllCommands, {},
-                                   {}, {}, barrier);
+  std::vector<vk::ImageMemoryBarrier2> barriers;
+  for (const auto& [name, image] : storage_images_[frame_index]) {
+    StorageImageDependency dependency{GetStorageImageDependency(name)};
+    barriers.emplace_back(
+        dependency.producer_stage, dependency.producer_access,
+        vk::PipelineStageFlagBits2::eComputeShader,
+        vk::AccessFlagBits2::eShaderStorageRead |
+            vk::AccessFlagBits2::eShaderStorageWrite,
+        vk::ImageLayout::eShaderReadOnlyOptimal, vk::ImageLayout::eGeneral,
+        VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, image,
+        vk::ImageSubresourceRange{vk::ImageAspectFlagBits::eColor, 0,
+                                  VK_REMAINING_MIP_LEVELS, 0,
+                                  VK_REMAINING_ARRAY_LAYERS});
+  }
+
+  if (!barriers.empty()) {
+    command_buffer.pipelineBarrier2(vk::DependencyInfo{{}, {}, {}, barriers});
   }
 }
 
 void ComputeJob::PostTransferResources(
     const vk::raii::CommandBuffer& command_buffer, u32 frame_index) const {
-  for (auto tr : image_layout_trans_[frame_index]) {
-    vk::Image image{tr.first};
-    const auto& layout{tr.second};
-    vk::ImageLayout ext{layout.first};
-    vk::ImageLayout inn{layout.second};
-    vk::ImageMemoryBarrier barrier{
-        {},
-        vk::AccessFlagBits::eShaderWrite | vk::AccessFlagBits::eShaderRead,
-        inn,
-        ext,
-        VK_QUEUE_FAMILY_IGNORED,
-        VK_QUEUE_FAMILY_IGNORED,
-        image,
-        {vk::ImageAspectFlagBits::eColor, 0, VK_REMAINING_MIP_LEVELS, 0,
-         VK_REMAINING_ARRAY_LAYERS}};
-    command_buffer.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe,
-                                   vk::PipelineStageFlagBits::eAllCommands, {},
-                                   {}, {}, barrier);
+  std::vector<vk::ImageMemoryBarrier2> barriers;
+  for (const auto& [name, image] : storage_images_[frame_index]) {
+    StorageImageDependency dependency{GetStorageImageDependency(name)};
+    barriers.emplace_back(
+        vk::PipelineStageFlagBits2::eComputeShader,
+        vk::AccessFlagBits2::eShaderStorageWrite, dependency.consumer_stage,
+        dependency.consumer_access, vk::ImageLayout::eGeneral,
+        vk::ImageLayout::eShaderReadOnlyOptimal, VK_QUEUE_FAMILY_IGNORED,
+        VK_QUEUE_FAMILY_IGNORED, image,
+        vk::ImageSubresourceRange{vk::ImageAspectFlagBits::eColor, 0,
+                                  VK_REMAINING_MIP_LEVELS, 0,
+                                  VK_REMAINING_ARRAY_LAYERS});
+  }
+
+  if (!barriers.empty()) {
+    command_buffer.pipelineBarrier2(vk::DependencyInfo{{}, {}, {}, barriers});
+  }
+}
+
+bool ComputeJob::UsesShader(const std::vector<u32>& shader_indices) const {
+  return std::find(shader_indices.begin(), shader_indices.end(), shader_) !=
+         shader_indices.end();
+}
+
+void ComputeJob::ReloadPipeline() {
+  reloaded_pipeline_hash_value_ = 0;
+
+  try {
+    const SPIRV* spirv{};
+    std::unordered_map<std::string, ShaderResource> name_shader_resources;
+    std::unordered_map<u32, std::vector<ShaderResource>> set_shader_resources;
+    std::vector<u32> sorted_sets;
+    std::vector<vk::PushConstantRange> push_constant_ranges;
+    ParseShaderResources(spirv, name_shader_resources, set_shader_resources,
+                         sorted_sets, push_constant_ranges);
+
+    if (HashShaderInterface(name_shader_resources) != interface_hash_value_) {
+      LOGW("Shader interface of compute job {} changes, restart to apply it",
+           shader_);
+      return;
+    }
+
+    reloaded_pipeline_hash_value_ = CreatePipeline(spirv);
+  } catch (const Exception&) {
+    LOGW("Fail to reload pipeline of compute job {}", shader_);
+  }
+}
+
+void ComputeJob::SwapPipeline(std::unordered_set<u64>& replaced_hash_values) {
+  if (reloaded_pipeline_hash_value_ == 0 ||
+      reloaded_pipeline_hash_value_ == pipeline_hash_value_) {
+    reloaded_pipeline_hash_value_ = 0;
+    return;
+  }
+
+  replaced_hash_values.insert(pipeline_hash_value_);
+  pipeline_hash_value_ = reloaded_pipeline_hash_value_;
+  pipeline_ = &resource_cache_->GetPipeline(pipeline_hash_value_);
+  reloaded_pipeline_hash_value_ = 0;
+}
+
+StorageImageDependency ComputeJob::GetStorageImageDependency(
+    const std::string& name) const {
+  auto it{storage_image_dependencies_.find(name)};
+  if (it != storage_image_dependencies_.end()) {
+    return it->second;
   }
+  return {};
 }
 
 void ComputeJob::ParseShaderResources(
@@ -142,8 +210,8 @@ void ComputeJob::ParseShaderResources(
     std::unordered_map<u32, std::vector<ShaderResource>>& set_shader_resources,
     std::vector<u32>& sorted_sets,
     std::vector<vk::PushConstantRange>& push_constant_ranges) {
-  spirv = &RequestSpirv(asset_->GetShader(shader_), {},
-                        vk::ShaderStageFlagBits::eCompute);
+  spirv = &resource_cache_->RequestSpirv(asset_->GetShader(shader_), {},
+                                         vk::ShaderStageFlagBits::eCompute);
 
   const auto& shader_resources{spirv->GetShaderResources()};
   for (const auto& shader_resource : shader_resources) {
@@ -191,15 +259,10 @@ void ComputeJob::CreatePipelineResources(
         set_shader_resources,
     const std::vector<u32>& sorted_sets,
     const std::vector<vk::PushConstantRange>& push_constant_ranges) {
-  image_layout_trans_.clear();
-  image_layout_trans_.resize(frame_count_);
-
-  std::vector<vk::WriteDescriptorSet> write_descriptor_sets;
-  std::vector<vk::DescriptorImageInfo> image_infos;
-  std::vector<vk::DescriptorBufferInfo> buffer_infos;
+  storage_images_.clear();
+  storage_images_.resize(frame_count_);
 
-  image_infos.reserve(kComputeImageInfoMaxCount);
-  buffer_infos.reserve(kComputeBufferInfoMaxCount);
+  descriptor_sets_.resize(frame_count_);
 
   std::vector<vk::DescriptorSetLayout> set_layouts;
 
@@ -207,6 +270,17 @@ void ComputeJob::CreatePipelineResources(
     const vk::raii::DescriptorSetLayout* descriptor_set_layout{};
     const auto& shader_resources{set_shader_resources.at(set)};
 
+    // The device-wide bindless table is shared with the subpasses.
+    std::string resource_name{ToLower(shader_resources[0].name)};
+    if (resource_name.find("bindless") != std::string::npos) {
+      has_descriptor_set_ = true;
+      for (u32 i{}; i < frame_count_; ++i) {
+        descriptor_sets_[i].push_back(*(gpu_->GetBindlessDescriptorSet()));
+      }
+      set_layouts.push_back(*(gpu_->GetBindlessDescriptorSetLayout()));
+      continue;
+    }
+
     // Create descriptor set layout.
     descriptor_set_index_ = std::min(descriptor_set_index_, set);
     std::vector<vk::DescriptorSetLayoutBinding> bindings;
@@ -233,8 +307,8 @@ void ComputeJob::CreatePipelineResources(
 
     vk::DescriptorSetLayoutCreateInfo descriptor_set_layout_ci{{}, bindings};
 
-    descriptor_set_layout =
-        &(RequestDescriptorSetLayout(descriptor_set_layout_ci));
+    descriptor_set_layout = &(
+        resource_cache_->RequestDescriptorSetLayout(descriptor_set_layout_ci));
 
     // Allocate descriptor sets.
     has_descriptor_set_ = true;
@@ -242,13 +316,13 @@ void ComputeJob::CreatePipelineResources(
       vk::DescriptorSetAllocateInfo descriptor_set_ai{nullptr,
                                                       **descriptor_set_layout};
 
-      vk::raii::DescriptorSets descriptor_sets{
-          gpu_->AllocateNormalDescriptorSets(descriptor_set_ai)};
-
-      descriptor_sets_.push_back(std::move(descriptor_sets));
+      descriptor_sets_[i].push_back(
+          gpu_->AllocateDescriptorSets(descriptor_allocator_, descriptor_set_ai)
+              .front());
     }
 
     // Update descriptor sets.
+    std::vector<DescriptorUpdate> descriptor_updates(frame_count_);
     for (const auto& shader_resource : shader_resources) {
       if (shader_resource.type == ShaderResourceType::kUniformBuffer) {
         if (shader_resource.name == "ComputeJob") {
@@ -267,35 +341,24 @@ void ComputeJob::CreatePipelineResources(
 
             vk::DescriptorBufferInfo descriptor_buffer_info{
                 *compute_job_uniform_buffer, 0, sizeof(ComputeJobUniform)};
-            buffer_infos.push_back(descriptor_buffer_info);
-
-            vk::WriteDescriptorSet write_descriptor_set{
-                *descriptor_sets_[i]
-                                 [shader_resource.set - descriptor_set_index_],
-                shader_resource.binding,
-                0,
-                vk::DescriptorType::eUniformBuffer,
-                nullptr,
-                buffer_infos.back()};
+            descriptor_updates[i].AddBuffer(shader_resource.binding,
+                                            vk::DescriptorType::eUniformBuffer,
+                                            descriptor_buffer_info);
 
             uniforms_.push_back(compute_job_uniform);
             uniform_buffers_.push_back(std::move(compute_job_uniform_buffer));
-
-            write_descriptor_sets.push_back(write_descriptor_set);
           }
         }
       } else if (shader_resource.type == ShaderResourceType::kStorageImage) {
         need_resize_ = true;
+        shared_image_names_.insert(shader_resource.name);
         for (u32 i{}; i < frame_count_; ++i) {
           vk::Image image{nullptr};
 
           auto image_it{(*shared_images_)[i].find(shader_resource.name)};
           if (image_it != (*shared_images_)[i].end()) {
             image = image_it->second;
-            image_layout_trans_[i].insert(
-                {image, std::pair<vk::ImageLayout, vk::ImageLayout>{
-                            vk::ImageLayout::eShaderReadOnlyOptimal,
-                            vk::ImageLayout::eGeneral}});
+            storage_images_[i].emplace(shader_resource.name, image);
           } else {
             THROW("Image is nullptr");
           }
@@ -311,34 +374,22 @@ void ComputeJob::CreatePipelineResources(
 
           vk::DescriptorImageInfo descriptor_image_info{
               *(gpu_->GetSampler()), image_view, vk::ImageLayout::eGeneral};
-          image_infos.push_back(descriptor_image_info);
-
-          vk::WriteDescriptorSet write_descriptor_set{
-              *(descriptor_sets_[i]
-                                [shader_resource.set - descriptor_set_index_]),
-              shader_resource.binding, 0, vk::DescriptorType::eStorageImage,
-              image_infos.back()};
-
-          write_descriptor_sets.push_back(write_descriptor_set);
+          descriptor_updates[i].AddImage(shader_resource.binding,
+                                         vk::DescriptorType::eStorageImage,
+                                         descriptor_image_info);
         }
       }
     }
 
-    set_layouts.push_back(**descriptor_set_layout);
-  }
+    for (u32 i{}; i < frame_count_; ++i) {
+      descriptor_updates[i].Update(*gpu_, *resource_cache_,
+                                   descriptor_sets_[i].back(),
+                                   **descriptor_set_layout, "compute_job");
+    }
 
-  if (image_infos.size() >= kComputeImageInfoMaxCount) {
-    THROW("The size of image_infos ({}) exceeds kComputeImageInfoMaxCount ({})",
-          image_infos.size(), kComputeImageInfoMaxCount);
-  }
-  if (buffer_infos.size() >= kComputeBufferInfoMaxCount) {
-    THROW(
-        "The size of buffer_infos ({}) exceeds kComputeBufferInfoMaxCount ({})",
-        buffer_infos.size(), kComputeBufferInfoMaxCount);
+    set_layouts.push_back(**descriptor_set_layout);
   }
 
-  gpu_->UpdateDescriptorSets(write_descriptor_sets);
-
   // Pipeline layouts.
   vk::PipelineLayoutCreateInfo pipeline_layout_ci;
 
@@ -352,12 +403,12 @@ void ComputeJob::CreatePipelineResources(
   }
 
   const vk::raii::PipelineLayout& pipeline_layout{
-      RequestPipelineLayout(pipeline_layout_ci)};
+      resource_cache_->RequestPipelineLayout(pipeline_layout_ci)};
 
   pipeline_layout_ = &pipeline_layout;
 }
 
-void ComputeJob::CreatePipeline(const SPIRV* spirv_shader) {
+u64 ComputeJob::CreatePipeline(const SPIRV* spirv_shader) {
   u64 pipeline_hash_value{};
   u64 shader_module_hash_value{spirv_shader->GetHashValue()};
   HashCombine(pipeline_hash_value, shader_module_hash_value);
@@ -368,7 +419,8 @@ void ComputeJob::CreatePipeline(const SPIRV* spirv_shader) {
   vk::ShaderModuleCreateInfo shader_module_ci{
       {}, spirv.size() * 4, spirv.data()};
   const vk::raii::ShaderModule& shader_module{
-      RequestShaderModule(shader_module_ci, shader_module_hash_value)};
+      resource_cache_->RequestShaderModule(shader_module_ci,
+                                           shader_module_hash_value)};
 
   vk::PipelineShaderStageCreateInfo shader_stage_ci{
       {}, spirv_shader->GetStage(), *shader_module, "main", nullptr};
@@ -376,161 +428,9 @@ void ComputeJob::CreatePipeline(const SPIRV* spirv_shader) {
   vk::ComputePipelineCreateInfo compute_pipeline_ci{
       {}, shader_stage_ci, **pipeline_layout_};
 
-  pipeline_ = &RequestPipeline(compute_pipeline_ci, pipeline_hash_value);
-}
-
-const SPIRV& ComputeJob::RequestSpirv(const ast::Shader& shader,
-                                      const std::vector<std::string>& processes,
-                                      vk::ShaderStageFlagBits shader_stage) {
-  u64 hash_value{shader.GetHashValue(processes)};
-
-  auto it{spirv_shaders_.find(hash_value)};
-  if (it != spirv_shaders_.end()) {
-    return it->second;
-  }
-
-  std::filesystem::path root_path{GetPath(LUKA_ROOT_PATH)};
-  std::filesystem::path cache_path{root_path / ".cache" / "engine"};
-  std::filesystem::path spirv_cache_file{
-      cache_path / ("spirv_" + std::to_string(hash_value) + ".cache")};
-
-  std::vector<u32> spirv_cache_data;
-  if (std::filesystem::exists(spirv_cache_file)) {
-    spirv_cache_data = LoadBinaryU32(spirv_cache_file);
-  } else {
-    spirv_cache_data = shader.CompileToSpirv(processes);
-    if (!std::filesystem::exists(cache_path)) {
-      std::filesystem::create_directories(cache_path);
-    }
-    SaveBinaryU32(spirv_cache_data, spirv_cache_file);
-  }
-
-  SPIRV spirv{spirv_cache_data, shader_stage, hash_value};
-
-  auto it1{spirv_shaders_.emplace(hash_value, std::move(spirv))};
-
-  return it1.first->second;
-}
-
-const vk::raii::DescriptorSetLayout& ComputeJob::RequestDescriptorSetLayout(
-    const vk::DescriptorSetLayoutCreateInfo& descriptor_set_layout_ci,
-    const std::string& name, i32 index) {
-  u64 hash_value{};
-  HashCombine(hash_value, descriptor_set_layout_ci.flags);
-  for (u32 i{}; i < descriptor_set_layout_ci.bindingCount; ++i) {
-    HashCombine(hash_value, descriptor_set_layout_ci.pBindings[i]);
-  }
-
-  auto it{descriptor_set_layouts_.find(hash_value)};
-  if (it != descriptor_set_layouts_.end()) {
-    return it->second;
-  }
-
-  vk::raii::DescriptorSetLayout descriptor_set_layout{
-      gpu_->CreateDescriptorSetLayout(descriptor_set_layout_ci, name, index)};
-
-  auto it1{descriptor_set_layouts_.emplace(hash_value,
-                                           std::move(descriptor_set_layout))};
-
-  return it1.first->second;
-}
-
-const vk::raii::PipelineLayout& ComputeJob::RequestPipelineLayout(
-    const vk::PipelineLayoutCreateInfo& pipeline_layout_ci,
-    const std::string& name, i32 index) {
-  u64 hash_value{};
-  HashCombine(hash_value, pipeline_layout_ci.flags);
-  for (u32 i{}; i < pipeline_layout_ci.setLayoutCount; ++i) {
-    HashCombine(hash_value, pipeline_layout_ci.pSetLayouts[i]);
-  }
-  for (u32 i{}; i < pipeline_layout_ci.pushConstantRangeCount; ++i) {
-    HashCombine(hash_value, pipeline_layout_ci.pPushConstantRanges[i]);
-  }
-
-  auto it{pipeline_layouts_.find(hash_value)};
-  if (it != pipeline_layouts_.end()) {
-    return it->second;
-  }
-
-  vk::raii::PipelineLayout pipeline_layout{
-      gpu_->CreatePipelineLayout(pipeline_layout_ci, name, index)};
-
-  auto it1{pipeline_layouts_.emplace(hash_value, std::move(pipeline_layout))};
-
-  return it1.first->second;
-}
-
-const vk::raii::ShaderModule& ComputeJob::RequestShaderModule(
-    const vk::ShaderModuleCreateInfo& shader_module_ci, u64 hash_value,
-    const std::string& name, i32 index) {
-  auto it{shader_modules_.find(hash_value)};
-  if (it != shader_modules_.end()) {
-    return it->second;
-  }
-
-  vk::raii::ShaderModule shader_module{
-      gpu_->CreateShaderModule(shader_module_ci, name, index)};
-
-  auto it1{shader_modules_.emplace(hash_value, std::move(shader_module))};
-
-  return it1.first->second;
-}
-
-const vk::raii::Pipeline& ComputeJob::RequestPipeline(
-    const vk::ComputePipelineCreateInfo& compute_pipeline_ci, u64 hash_value,
-    const std::string& name, i32 index) {
-  auto it{pipelines_.find(hash_value)};
-  if (it != pipelines_.end()) {
-    return it->second;
-  }
-
-  vk::PipelineCacheCreateInfo pipeline_cache_ci;
-
-  std::filesystem::path root_path{GetPath(LUKA_ROOT_PATH)};
-  std::filesystem::path cache_path{root_path / ".cache" / "engine"};
-  std::filesystem::path pipeline_cache_file{
-      cache_path / ("pipeline_" + std::to_string(hash_value) + ".cache")};
-  std::vector<u8> pipeline_cache_data;
-
-  bool has_cache{};
-  if (std::filesystem::exists(pipeline_cache_file)) {
-    pipeline_cache_data = LoadBinaryU8(pipeline_cache_file);
-
-    vk::PipelineCacheHeaderVersionOne* header_version_one{
-        reinterpret_cast<vk::PipelineCacheHeaderVersionOne*>(
-            pipeline_cache_data.data())};
-    vk::PhysicalDeviceProperties physical_device_properties{
-        gpu_->GetPhysicalDeviceProperties()};
-
-    if (header_version_one->headerSize > 0 &&
-        header_version_one->headerVersion ==
-            vk::PipelineCacheHeaderVersion::eOne &&
-        header_version_one->vendorID == physical_device_properties.vendorID &&
-        header_version_one->deviceID == physical_device_properties.deviceID) {
-      has_cache = true;
-
-      pipeline_cache_ci.initialDataSize = pipeline_cache_data.size();
-      pipeline_cache_ci.pInitialData = pipeline_cache_data.data();
-    }
-  }
-
-  vk::raii::PipelineCache pipeline_cache{
-      gpu_->CreatePipelineCache(pipeline_cache_ci, name, index)};
-
-  vk::raii::Pipeline pipeline{
-      gpu_->CreatePipeline(compute_pipeline_ci, pipeline_cache, name, index)};
-
-  if (!has_cache) {
-    std::vector<u8> pipeline_cache_data{pipeline_cache.getData()};
-    if (!std::filesystem::exists(cache_path)) {
-      std::filesystem::create_directories(cache_path);
-    }
-    SaveBinaryU8(pipeline_cache_data, pipeline_cache_file);
-  }
-
-  auto it1{pipelines_.emplace(hash_value, std::move(pipeline))};
+  resource_cache_->RequestPipeline(compute_pipeline_ci, pipeline_hash_value);
 
-  return it1.first->second;
+  return pipeline_hash_value;
 }
 
 }  // namespace luka::fw
\ No newline at end of file
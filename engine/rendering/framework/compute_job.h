@@ -10,24 +10,34 @@
 #include "base/gpu/gpu.h"
 #include "core/math.h"
 #include "function/function_ui/function_ui.h"
+#include "rendering/framework/resource_cache.h"
 #include "rendering/framework/spirv.h"
 #include "resource/asset/asset.h"
 
 namespace luka::fw {
 
-constexpr u32 kComputeImageInfoMaxCount{20};
-constexpr u32 kComputeBufferInfoMaxCount{10};
-
 struct ComputeJobUniform {
   glm::uvec2 image_size;
 };
 
+// How a storage image is written before and read after the compute job, the
+// defaults are conservative for images the frame graph knows nothing about.
+struct StorageImageDependency {
+  vk::PipelineStageFlags2 producer_stage{
+      vk::PipelineStageFlagBits2::eAllCommands};
+  vk::AccessFlags2 producer_access{vk::AccessFlagBits2::eMemoryWrite};
+  vk::PipelineStageFlags2 consumer_stage{
+      vk::PipelineStageFlagBits2::eAllCommands};
+  vk::AccessFlags2 consumer_access{vk::AccessFlagBits2::eMemoryRead};
+};
+
 class ComputeJob {
  public:
   ComputeJob() = default;
 
   ComputeJob(
-      std::shared_ptr<Gpu> gpu, std::shared_ptr<Asset> asset, u32 frame_count,
+      std::shared_ptr<Gpu> gpu, std::shared_ptr<ResourceCache> resource_cache,
+      std::shared_ptr<Asset> asset, u32 frame_count,
       const std::vector<std::vector<vk::raii::ImageView>>&
           attachment_image_views,
       const ast::ComputeJob& ast_compute_job,
@@ -45,17 +55,28 @@ class ComputeJob {
   void Update(u32 frame_index);
 
   const vk::raii::Pipeline* GetPipeline() const;
+  u64 GetPipelineHashValue() const;
   const vk::raii::PipelineLayout* GetPipelineLayout() const;
-  const vk::raii::DescriptorSets& GetDescriptorSets(u32 frame_index) const;
+  const std::vector<vk::DescriptorSet>& GetDescriptorSets(
+      u32 frame_index) const;
   u32 GetGroupCountX() const;
   u32 GetGroupCountY() const;
   u32 GetGroupCountZ() const;
+  const std::unordered_set<std::string>& GetSharedImageNames() const;
+
+  void SetStorageImageDependency(const std::string& name,
+                                 const StorageImageDependency& dependency);
 
   void PreTransferResources(const vk::raii::CommandBuffer& command_buffer,
                             u32 frame_index) const;
   void PostTransferResources(const vk::raii::CommandBuffer& command_buffer,
                              u32 frame_index) const;
 
+  // Hot reload, see Subpass.
+  bool UsesShader(const std::vector<u32>& shader_indices) const;
+  void ReloadPipeline();
+  void SwapPipeline(std::unordered_set<u64>& replaced_hash_values);
+
  private:
   void ParseShaderResources(
       const SPIRV*& spirv,
@@ -71,29 +92,13 @@ class ComputeJob {
       const std::vector<u32>& sorted_sets,
       const std::vector<vk::PushConstantRange>& push_constant_ranges);
 
-  void CreatePipeline(const SPIRV* spirv);
+  u64 CreatePipeline(const SPIRV* spirv);
 
-  const SPIRV& RequestSpirv(const ast::Shader& shader,
-                            const std::vector<std::string>& processes,
-                            vk::ShaderStageFlagBits shader_stage);
-
-  const vk::raii::DescriptorSetLayout& RequestDescriptorSetLayout(
-      const vk::DescriptorSetLayoutCreateInfo& descriptor_set_layout_ci,
-      const std::string& name = {}, i32 index = -1);
-
-  const vk::raii::PipelineLayout& RequestPipelineLayout(
-      const vk::PipelineLayoutCreateInfo& pipeline_layout_ci,
-      const std::string& name = {}, i32 index = -1);
-
-  const vk::raii::ShaderModule& RequestShaderModule(
-      const vk::ShaderModuleCreateInfo& shader_module_ci, u64 hash_value,
-      const std::string& name = {}, i32 index = -1);
-
-  const vk::raii::Pipeline& RequestPipeline(
-      const vk::ComputePipelineCreateInfo& compute_pipeline_ci, u64 hash_value,
-      const std::string& name = {}, i32 index = -1);
+  StorageImageDependency GetStorageImageDependency(
+      const std::string& name) const;
 
   std::shared_ptr<Gpu> gpu_;
+  std::shared_ptr<ResourceCache> resource_cache_;
   std::shared_ptr<Asset> asset_;
 
   u32 frame_count_{};
@@ -107,12 +112,17 @@ class ComputeJob {
   u32 shader_{};
 
   bool need_resize_{};
+  std::unordered_set<std::string> shared_image_names_;
 
+  gpu::DescriptorAllocator descriptor_allocator_;
   bool has_descriptor_set_{};
   const vk::raii::PipelineLayout* pipeline_layout_{};
-  std::vector<vk::raii::DescriptorSets> descriptor_sets_;
+  std::vector<std::vector<vk::DescriptorSet>> descriptor_sets_;
   bool has_push_constant_{};
   const vk::raii::Pipeline* pipeline_{};
+  u64 interface_hash_value_{};
+  u64 pipeline_hash_value_{};
+  u64 reloaded_pipeline_hash_value_{};
 
   const SwapchainInfo* swapchain_info_{};
   u32 group_count_x_{40};
@@ -121,15 +131,9 @@ class ComputeJob {
 
   u32 descriptor_set_index_{UINT32_MAX};
 
-  std::unordered_map<u64, SPIRV> spirv_shaders_;
-  std::unordered_map<u64, vk::raii::DescriptorSetLayout>
-      descriptor_set_layouts_;
-  std::unordered_map<u64, vk::raii::PipelineLayout> pipeline_layouts_;
-  std::unordered_map<u64, vk::raii::ShaderModule> shader_modules_;
-  std::unordered_map<u64, vk::raii::Pipeline> pipelines_;
-
-  std::vector<std::map<vk::Image, std::pair<vk::ImageLayout, vk::ImageLayout>>>
-      image_layout_trans_;
+  std::vector<std::map<std::string, vk::Image>> storage_images_;
+  std::unordered_map<std::string, StorageImageDependency>
+      storage_image_dependencies_;
 
   std::vector<ComputeJobUniform> uniforms_;
   std::vector<gpu::Buffer> uniform_buffers_;
@@ -0,0 +1,53 @@
+// SPDX license identifier: MIT.
+// Copyright (C) 2023-present Liam Hauw.
+
+// clang-format off
+#include "platform/pch.h"
+// clang-format on
+
+#include "rendering/framework/descriptor_update.h"
+
+namespace luka::fw {
+
+void DescriptorUpdate::AddBuffer(
+    u32 binding, vk::DescriptorType descriptor_type,
+    const vk::DescriptorBufferInfo& descriptor_buffer_info) {
+  entries_.emplace_back(binding, 0, 1, descriptor_type,
+                        infos_.size() * sizeof(DescriptorInfo),
+                        sizeof(DescriptorInfo));
+  DescriptorInfo& info{infos_.emplace_back()};
+  info.buffer = static_cast<VkDescriptorBufferInfo>(descriptor_buffer_info);
+}
+
+void DescriptorUpdate::AddImage(
+    u32 binding, vk::DescriptorType descriptor_type,
+    const vk::DescriptorImageInfo& descriptor_image_info) {
+  entries_.emplace_back(binding, 0, 1, descriptor_type,
+                        infos_.size() * sizeof(DescriptorInfo),
+                        sizeof(DescriptorInfo));
+  DescriptorInfo& info{infos_.emplace_back()};
+  info.image = static_cast<VkDescriptorImageInfo>(descriptor_image_info);
+}
+
+bool DescriptorUpdate::IsEmpty() const { return entries_.empty(); }
+
+void DescriptorUpdate::Update(Gpu& gpu, ResourceCache& resource_cache,
+                              vk::DescriptorSet descriptor_set,
+                              vk::DescriptorSetLayout descriptor_set_layout,
+                              const std::string& name) const {
+  if (entries_.empty()) {
+    return;
+  }
+
+  vk::DescriptorUpdateTemplateCreateInfo descriptor_update_template_ci{
+      {}, entries_, vk::DescriptorUpdateTemplateType::eDescriptorSet,
+      descriptor_set_layout};
+  const vk::raii::DescriptorUpdateTemplate& descriptor_update_template{
+      resource_cache.RequestDescriptorUpdateTemplate(
+          descriptor_update_template_ci, name)};
+
+  gpu.UpdateDescriptorSet(descriptor_set, descriptor_update_template,
+                          infos_.data());
+}
+
+}  // namespace luka::fw
@@ -0,0 +1,45 @@
+// SPDX license identifier: MIT.
+// Copyright (C) 2023-present Liam Hauw.
+
+#pragma once
+
+// clang-format off
+#include "platform/pch.h"
+// clang-format on
+
+#include "base/gpu/gpu.h"
+#include "rendering/framework/resource_cache.h"
+
+namespace luka::fw {
+
+// One descriptor as an update template reads it.
+union DescriptorInfo {
+  VkDescriptorImageInfo image;
+  VkDescriptorBufferInfo buffer;
+};
+
+/**
+ * Descriptors of one set gathered from the reflected bindings and written in
+ * a single call through an update template. Templates are cached, sets with
+ * the same layout and bindings share one.
+ */
+class DescriptorUpdate {
+ public:
+  void AddBuffer(u32 binding, vk::DescriptorType descriptor_type,
+                 const vk::DescriptorBufferInfo& descriptor_buffer_info);
+  void AddImage(u32 binding, vk::DescriptorType descriptor_type,
+                const vk::DescriptorImageInfo& descriptor_image_info);
+
+  bool IsEmpty() const;
+
+  void Update(Gpu& gpu, ResourceCache& resource_cache,
+              vk::DescriptorSet descriptor_set,
+              vk::DescriptorSetLayout descriptor_set_layout,
+              const std::string& name = {}) const;
+
+ private:
+  std::vector<vk::DescriptorUpdateTemplateEntry> entries_;
+  std::vector<DescriptorInfo> infos_;
+};
+
+}  // namespace luka::fw
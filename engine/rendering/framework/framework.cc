@@ -11,7 +11,7 @@
 
 namespace luka {
 
-void RecordGraphicsCommand(
+void BindGraphicsResources(
     const vk::raii::CommandBuffer& command_buffer, const fw::Subpass& subpass,
     const fw::DrawElement& draw_element,
     const vk::raii::Pipeline*& prev_pipeline,
@@ -27,16 +27,16 @@ void RecordGraphicsCommand(
   const vk::raii::PipelineLayout* pipeline_layout{draw_element.pipeline_layout};
   if (prev_pipeline_layout != pipeline_layout) {
     if (subpass.HasPushConstant()) {
-      subpass.PushConstants(command_buffer, **pipeline_layout);
+      subpass.PushConstants(command_buffer, **pipeline_layout, frame_index);
     }
 
     if (subpass.HasSubpassDescriptorSet()) {
       u32 subpass_descriptor_set_index{subpass.GetSubpassDescriptorSetIndex()};
-      const vk::raii::DescriptorSet& subpass_descriptor_set{
+      vk::DescriptorSet subpass_descriptor_set{
           subpass.GetSubpassDescriptorSet(frame_index)};
       command_buffer.bindDescriptorSets(
           vk::PipelineBindPoint::eGraphics, **pipeline_layout,
-          subpass_descriptor_set_index, *subpass_descriptor_set, nullptr);
+          subpass_descriptor_set_index, subpass_descriptor_set, nullptr);
     }
 
     if (subpass.HasBindlessDescriptorSet()) {
@@ -57,16 +57,26 @@ void RecordGraphicsCommand(
     u32 draw_element_descriptor_set_index{
         subpass.GetDrawElementDescriptorSetIndex()};
 
-    const vk::raii::DescriptorSets& descriptor_sets{
-        draw_element.descriptor_sets[frame_index]};
-
-    std::vector<vk::DescriptorSet> vk_descriptor_sets;
-    for (const auto& descriptor_set : descriptor_sets) {
-      vk_descriptor_sets.push_back(*(descriptor_set));
-    }
     command_buffer.bindDescriptorSets(
         vk::PipelineBindPoint::eGraphics, **pipeline_layout,
-        draw_element_descriptor_set_index, vk_descriptor_sets, nullptr);
+        draw_element_descriptor_set_index,
+        draw_element.descriptor_sets[frame_index], nullptr);
+  }
+}
+
+void RecordGraphicsCommand(
+    const vk::raii::CommandBuffer& command_buffer, const fw::Subpass& subpass,
+    const fw::DrawElement& draw_element,
+    const vk::raii::Pipeline*& prev_pipeline,
+    const vk::raii::PipelineLayout*& prev_pipeline_layout, u32 frame_index) {
+  BindGraphicsResources(command_buffer, subpass, draw_element, prev_pipeline,
+                        prev_pipeline_layout, frame_index);
+
+  // Small per draw data is pushed instead of bound through a descriptor set.
+  if (subpass.HasPushConstant()) {
+    subpass.PushDrawElementConstants(command_buffer,
+                                     **(draw_element.pipeline_layout),
+                                     draw_element);
   }
 
   // Draw.
@@ -80,7 +90,9 @@ void RecordGraphicsCommand(
     }
 
     if (!draw_element.has_index) {
-      command_buffer.draw(draw_element.vertex_count, 1, 0, 0);
+      command_buffer.draw(draw_element.vertex_count,
+                          draw_element.instance_count, 0,
+                          draw_element.first_instance);
     } else {
       const ast::sc::IndexAttribute* index_attribute{
           draw_element.index_attribute};
@@ -89,64 +101,131 @@ void RecordGraphicsCommand(
                                      index_attribute->offset,
                                      index_attribute->index_type);
 
-      command_buffer.drawIndexed(index_attribute->count, 1, 0, 0, 0);
+      command_buffer.drawIndexed(index_attribute->count,
+                                 draw_element.instance_count, 0, 0,
+                                 draw_element.first_instance);
     }
   } else {
     command_buffer.draw(3, 1, 0, 0);
   }
 }
 
+void RecordGraphicsCommands(const vk::raii::CommandBuffer& command_buffer,
+                            const fw::Subpass& subpass,
+                            const std::vector<fw::DrawElement>& draw_elements,
+                            const std::vector<u32>& draw_element_indices,
+                            u32 begin, u32 end, u32 frame_index) {
+  const vk::raii::Pipeline* prev_pipeline{};
+  const vk::raii::PipelineLayout* prev_pipeline_layout{};
+
+  if (!subpass.IsVertexPulling()) {
+    for (u32 i{begin}; i < end; ++i) {
+      RecordGraphicsCommand(command_buffer, subpass,
+                            draw_elements[draw_element_indices[i]],
+                            prev_pipeline, prev_pipeline_layout, frame_index);
+    }
+    return;
+  }
+
+  if (begin == end) {
+    return;
+  }
+
+  // Draw elements pulling vertices only differ in their indirect command, so
+  // consecutive ones sharing a pipeline and a layout become one indirect draw.
+  // Command i of the indirect buffer belongs to position i of the queue, so
+  // chunks recorded in parallel never write the same command.
+  command_buffer.bindIndexBuffer(subpass.GetIndexBuffer(), 0,
+                                 vk::IndexType::eUint32);
+
+  vk::Buffer indirect_buffer{subpass.GetIndirectBuffer(frame_index)};
+  vk::DrawIndexedIndirectCommand* indirect_commands{
+      subpass.GetIndirectCommands(frame_index)};
+  u32 stride{sizeof(vk::DrawIndexedIndirectCommand)};
+
+  u32 batch_begin{begin};
+  for (u32 i{begin}; i < end; ++i) {
+    const fw::DrawElement& draw_element{draw_elements[draw_element_indices[i]]};
+    indirect_commands[i] = vk::DrawIndexedIndirectCommand{
+        draw_element.index_count, draw_element.instance_count,
+        draw_element.first_index, 0, draw_element.first_instance};
+
+    if (i + 1 < end) {
+      const fw::DrawElement& next_draw_element{
+          draw_elements[draw_element_indices[i + 1]]};
+      if (next_draw_element.pipeline == draw_element.pipeline &&
+          next_draw_element.pipeline_layout == draw_element.pipeline_layout) {
+        continue;
+      }
+    }
+
+    BindGraphicsResources(command_buffer, subpass, draw_element, prev_pipeline,
+                          prev_pipeline_layout, frame_index);
+    command_buffer.drawIndexedIndirect(indirect_buffer, batch_begin * stride,
+                                       i + 1 - batch_begin, stride);
+    batch_begin = i + 1;
+  }
+}
+
 CommandRecord::CommandRecord(
-    std::shared_ptr<Config> config,
     const std::vector<vk::raii::CommandBuffers>& secondary_buffers,
     const fw::Subpass& subpass,
     const std::vector<fw::DrawElement>& draw_elements,
-    const vk::Viewport& viewport, const vk::Rect2D& scissor, u32 frame_index,
-    u32 thread_count, u32 scm_index)
-    : config_{std::move(config)},
-      secondary_buffers_{&secondary_buffers},
+    const std::vector<u32>& draw_element_indices, const vk::Viewport& viewport,
+    const vk::Rect2D& scissor, u32 frame_index, u32 chunk_count, u32 scm_index)
+    : secondary_buffers_{&secondary_buffers},
       subpass_{&subpass},
       draw_elements_{&draw_elements},
+      draw_element_indices_{&draw_element_indices},
       viewport_{&viewport},
       scissor_{&scissor},
       frame_index_{frame_index},
-      thread_count_{thread_count},
+      chunk_count_{chunk_count},
       scm_index_{scm_index},
-      draw_element_count_{static_cast<u32>((*draw_elements_).size())},
-      prev_pipeline_(thread_count_),
-      prev_pipeline_layout_(thread_count_) {}
+      chunk_size_{static_cast<u32>(
+          (draw_element_indices_->size() + chunk_count_ - 1) / chunk_count_)} {}
 
-void CommandRecord::Record(enki::TaskSetPartition range, u32 thread_num) {
-  const vk::raii::CommandBuffer& command_buffer{
-      (*secondary_buffers_)[thread_num][scm_index_]};
+void CommandRecord::Record(enki::TaskSetPartition range) {
+  u32 draw_element_count{static_cast<u32>(draw_element_indices_->size())};
 
-  for (u32 i{range.start}; i < range.end; ++i) {
-    const fw::DrawElement& draw_element{(*draw_elements_)[i]};
-
-    if (draw_element.has_scene &&
-        !(config_->GetGlobalContext().show_scenes[draw_element.scene_index])) {
-      continue;
-    }
+  // Every chunk is a contiguous slice of the sorted render queue recorded into
+  // its own secondary command buffer, executing them in chunk order keeps the
+  // queue order.
+  for (u32 chunk{range.start}; chunk < range.end; ++chunk) {
+    const vk::raii::CommandBuffer& command_buffer{
+        (*secondary_buffers_)[chunk][scm_index_]};
 
     command_buffer.setViewport(0, *viewport_);
     command_buffer.setScissor(0, *scissor_);
 
-    RecordGraphicsCommand(command_buffer, *subpass_, draw_element,
-                          prev_pipeline_[thread_num],
-                          prev_pipeline_layout_[thread_num], frame_index_);
+    u32 begin{std::min(chunk * chunk_size_, draw_element_count)};
+    u32 end{std::min(begin + chunk_size_, draw_element_count)};
+    RecordGraphicsCommands(command_buffer, *subpass_, *draw_elements_,
+                           *draw_element_indices_, begin, end, frame_index_);
   }
 }
 
-u32 CommandRecord::GetDrawElmentCount() const { return draw_element_count_; }
+u32 CommandRecord::GetChunkCount() const { return chunk_count_; }
 
 CommandRecordTaskSet::CommandRecordTaskSet(CommandRecord* command_record)
     : command_record_{command_record} {
-  m_SetSize = command_record_->GetDrawElmentCount();
+  m_SetSize = command_record_->GetChunkCount();
 }
 
 void CommandRecordTaskSet::ExecuteRange(enki::TaskSetPartition range,
                                         uint32_t thread_num) {
-  command_record_->Record(range, thread_num);
+  command_record_->Record(range);
+}
+
+ShaderReloadTaskSet::ShaderReloadTaskSet(Framework* framework)
+    : framework_{framework} {
+  m_SetSize = 1;
+  m_Priority = enki::TASK_PRIORITY_LOW;
+}
+
+void ShaderReloadTaskSet::ExecuteRange(enki::TaskSetPartition range,
+                                       uint32_t thread_num) {
+  framework_->ReloadPipelines();
 }
 
 Framework::Framework(std::shared_ptr<TaskScheduler> task_scheduler,
@@ -162,15 +241,22 @@ Framework::Framework(std::shared_ptr<TaskScheduler> task_scheduler,
       asset_{std::move(asset)},
       camera_{std::move(camera)},
       function_ui_{std::move(function_ui)},
-      thread_count_{task_scheduler_->GetThreadCount()} {
+      headless_{function_ui_->IsHeadless()},
+      thread_count_{task_scheduler_->GetThreadCount()},
+      resource_cache_{std::make_shared<fw::ResourceCache>(gpu_)} {
   GetSwapchain();
   CreateSyncObjects();
-  CreateCommandObjects();
   CreateViewportAndScissor();
   CreatePasses();
+  CompileFrameGraph();
+  CreateCommandObjects();
 }
 
-Framework::~Framework() { gpu_->WaitIdle(); }
+Framework::~Framework() {
+  task_scheduler_->WaitforTask(&shader_reload_task_set_,
+                               enki::TASK_PRIORITY_LOW);
+  gpu_->WaitIdle();
+}
 
 void Framework::Tick() {
   if (window_->GetIconified()) {
@@ -182,14 +268,25 @@ void Framework::Tick() {
     Resize();
   }
 
+  ReloadShaders();
+
   Render();
 }
 
+void Framework::ReloadPipelines() {
+  for (auto* subpass : reload_subpasses_) {
+    subpass->ReloadPipelines();
+  }
+  for (auto* compute_job : reload_compute_jobs_) {
+    compute_job->ReloadPipeline();
+  }
+}
+
 void Framework::GetSwapchain() {
   swapchain_info_ = &(function_ui_->GetSwapchainInfo());
   swapchain_ = &(function_ui_->GetSwapchain());
-  swapchain_images_ = swapchain_->getImages();
-  frame_count_ = swapchain_images_.size();
+  swapchain_images_ = function_ui_->GetSwapchainImages();
+  frame_count_ = config_->GetFramesInFlight();
 }
 
 void Framework::CreateSyncObjects() {
@@ -199,14 +296,26 @@ void Framework::CreateSyncObjects() {
                                                 &timeline_semaphore_type_ci};
   vk::SemaphoreCreateInfo semaphore_ci;
 
+  // Every queue signals its own timeline, every frame remembers the last
+  // values it signaled so the cpu only waits for the frame it reuses.
+  graphics_timeline_semaphore_ =
+      gpu_->CreateSemaphoreLuka(timeline_semaphore_ci, "graphics_timeline");
+  compute_timeline_semaphore_ =
+      gpu_->CreateSemaphoreLuka(timeline_semaphore_ci, "compute_timeline");
+  frame_graphics_timeline_values_.resize(frame_count_);
+  frame_compute_timeline_values_.resize(frame_count_);
+
   for (u32 i{}; i < frame_count_; ++i) {
     image_acquired_semaphores_.push_back(
         gpu_->CreateSemaphoreLuka(semaphore_ci, "image_acquired"));
+  }
+
+  // Presentation may hold an image for longer than a frame in flight, so the
+  // semaphore it waits on belongs to the swapchain image.
+  rendering_finished_semaphores_.clear();
+  for (u32 i{}; i < swapchain_images_.size(); ++i) {
     rendering_finished_semaphores_.push_back(
         gpu_->CreateSemaphoreLuka(semaphore_ci, "graphics_finished"));
-    timeline_semaphores_.push_back(
-        gpu_->CreateSemaphoreLuka(timeline_semaphore_ci, "timeline"));
-    timeline_values_.push_back(1);
   }
 }
 
@@ -217,10 +326,14 @@ void Framework::CreateCommandObjects() {
   vk::CommandBufferAllocateInfo primary_command_buffer_ai{
       nullptr, vk::CommandBufferLevel::ePrimary, kGraphicsCommandBufferCount};
 
+  // Secondary command buffers are kept across frames and re-recorded one by
+  // one, every subpass owns one per thread and frame.
   vk::CommandPoolCreateInfo secondary_command_pool_ci{
-      {}, gpu_->GetGraphicsQueueIndex()};
+      vk::CommandPoolCreateFlagBits::eResetCommandBuffer,
+      gpu_->GetGraphicsQueueIndex()};
   vk::CommandBufferAllocateInfo secondary_command_buffer_ai{
-      nullptr, vk::CommandBufferLevel::eSecondary, kGraphicsCommandBufferCount};
+      nullptr, vk::CommandBufferLevel::eSecondary,
+      std::max(secondary_count_, 1U)};
 
   vk::CommandPoolCreateInfo compute_command_pool_ci{
       vk::CommandPoolCreateFlagBits::eResetCommandBuffer,
@@ -247,6 +360,8 @@ void Framework::CreateCommandObjects() {
           secondary_command_buffer_ai, "secondary"));
     }
 
+    secondary_hash_values_.emplace_back(secondary_count_, 0);
+
     compute_command_pools_.push_back(
         gpu_->CreateCommandPool(compute_command_pool_ci, "compute"));
     compute_command_buffer_ai.commandPool = *(compute_command_pools_.back());
@@ -344,22 +459,238 @@ void Framework::CreatePasses() {
   shared_images_.resize(frame_count_);
   shared_image_views_.resize(frame_count_);
   for (u32 i{}; i < ast_passes.size(); ++i) {
-    passes_.emplace_back(gpu_, asset_, camera_, function_ui_, frame_count_,
+    passes_.emplace_back(task_scheduler_, gpu_, resource_cache_, config_,
+                         asset_, camera_, function_ui_, frame_count_,
                          *swapchain_info_, swapchain_images_, ast_passes, i,
-                         scene_primitives, shared_images_, shared_image_views_);
+                         scene_primitives, shared_images_, shared_image_views_,
+                         transient_images_);
+
+    std::vector<fw::RenderQueue> render_queues;
+    std::vector<u32> secondary_indices;
+    const std::vector<ast::Subpass>& ast_subpasses{ast_passes[i].subpasses};
+    for (u32 j{}; j < ast_subpasses.size(); ++j) {
+      bool back_to_front{ast_subpasses[j].scene == "transparency"};
+      render_queues.emplace_back(task_scheduler_, i, j, back_to_front);
+      secondary_indices.push_back(secondary_count_++);
+    }
+    render_queues_.push_back(std::move(render_queues));
+    secondary_indices_.push_back(std::move(secondary_indices));
+  }
+
+  fw::ResourceCacheCounters counters{resource_cache_->GetCounters()};
+  LOGI("Spirv cache: {} hits, {} misses, {} ms", counters.spirv.hit_count,
+       counters.spirv.miss_count, counters.spirv.creation_time / 1000000);
+  LOGI("Pipeline cache: {} hits, {} misses, {} ms",
+       counters.pipeline.hit_count, counters.pipeline.miss_count,
+       counters.pipeline.creation_time / 1000000);
+}
+
+void Framework::CompileFrameGraph() {
+  // Walk back from the passes that present, a pass whose outputs nobody reads
+  // is culled.
+  std::vector<bool> live_passes(passes_.size());
+  std::unordered_set<std::string> needed_image_names;
+  for (u32 i{static_cast<u32>(passes_.size())}; i-- > 0;) {
+    const fw::Pass& pass{passes_[i]};
+
+    bool live{pass.HasSwapchain()};
+    for (const auto& name : pass.GetOutputImageNames()) {
+      live = live || needed_image_names.contains(name);
+    }
+    if (!live) {
+      LOGI("Cull pass: {}", pass.GetName());
+      continue;
+    }
+
+    live_passes[i] = true;
+    std::unordered_set<std::string> input_image_names{
+        pass.GetInputImageNames()};
+    needed_image_names.insert(input_image_names.begin(),
+                              input_image_names.end());
+  }
+
+  live_pass_indices_.clear();
+  for (u32 i{}; i < passes_.size(); ++i) {
+    if (live_passes[i]) {
+      live_pass_indices_.push_back(i);
+    }
+  }
+
+  // Storage images of compute passes only synchronize with the passes that
+  // write them before and read them after. Across submissions the timeline
+  // semaphores already carry the memory dependency, so the barriers only
+  // order the layout transitions.
+  for (u32 k{}; k < live_pass_indices_.size(); ++k) {
+    fw::Pass& pass{passes_[live_pass_indices_[k]]};
+    if (pass.GetType() != ast::PassType::kCompute) {
+      continue;
+    }
+
+    fw::ComputeJob& compute_job{pass.GetComputeJob()};
+    for (const auto& name : compute_job.GetSharedImageNames()) {
+      fw::StorageImageDependency dependency{
+          vk::PipelineStageFlagBits2::eNone, vk::AccessFlagBits2::eNone,
+          vk::PipelineStageFlagBits2::eNone, vk::AccessFlagBits2::eNone};
+
+      bool same_submission{true};
+      for (u32 j{k}; j-- > 0;) {
+        const fw::Pass& producer{passes_[live_pass_indices_[j]]};
+        same_submission =
+            same_submission && producer.GetType() == ast::PassType::kCompute;
+        const std::vector<std::string>& output_image_names{
+            producer.GetOutputImageNames()};
+        if (std::find(output_image_names.begin(), output_image_names.end(),
+                      name) != output_image_names.end()) {
+          dependency.producer_stage =
+              vk::PipelineStageFlagBits2::eComputeShader;
+          dependency.producer_access =
+              same_submission ? vk::AccessFlagBits2::eShaderStorageWrite
+                              : vk::AccessFlagBits2::eNone;
+          break;
+        }
+      }
+
+      same_submission = true;
+      for (u32 j{k + 1}; j < live_pass_indices_.size(); ++j) {
+        const fw::Pass& consumer{passes_[live_pass_indices_[j]]};
+        same_submission =
+            same_submission && consumer.GetType() == ast::PassType::kCompute;
+        if (consumer.GetInputImageNames().contains(name)) {
+          if (same_submission) {
+            dependency.consumer_stage =
+                vk::PipelineStageFlagBits2::eComputeShader;
+            dependency.consumer_access =
+                vk::AccessFlagBits2::eShaderStorageRead;
+          }
+          break;
+        }
+      }
+
+      compute_job.SetStorageImageDependency(name, dependency);
+    }
   }
 }
 
 void Framework::Resize() {
   gpu_->WaitIdle();
+  if (shader_reloading_) {
+    task_scheduler_->WaitforTask(&shader_reload_task_set_,
+                                 enki::TASK_PRIORITY_LOW);
+    SwapPipelines();
+  }
+  retired_pipelines_.clear();
   frame_index_ = 0;
   absolute_frame_ = 0;
 
   GetSwapchain();
+  if (rendering_finished_semaphores_.size() != swapchain_images_.size()) {
+    vk::SemaphoreCreateInfo semaphore_ci;
+    rendering_finished_semaphores_.clear();
+    for (u32 i{}; i < swapchain_images_.size(); ++i) {
+      rendering_finished_semaphores_.push_back(
+          gpu_->CreateSemaphoreLuka(semaphore_ci, "graphics_finished"));
+    }
+  }
   CreateViewportAndScissor();
+  transient_images_.clear();
   for (auto& pass : passes_) {
     pass.Resize(*swapchain_info_, swapchain_images_);
   }
+
+  for (auto& secondary_hash_values : secondary_hash_values_) {
+    std::fill(secondary_hash_values.begin(), secondary_hash_values.end(), 0);
+  }
+}
+
+void Framework::ReloadShaders() {
+  // Pipelines rebuilt in the background are swapped in between frames.
+  if (shader_reloading_) {
+    if (!shader_reload_task_set_.GetIsComplete()) {
+      return;
+    }
+    SwapPipelines();
+  }
+  DestroyRetiredPipelines();
+
+  std::vector<u32> reloaded_shaders{asset_->ReloadChangedShaders()};
+  if (reloaded_shaders.empty()) {
+    return;
+  }
+
+  for (auto& pass : passes_) {
+    if (pass.GetType() == ast::PassType::kCompute) {
+      fw::ComputeJob& compute_job{pass.GetComputeJob()};
+      if (compute_job.UsesShader(reloaded_shaders)) {
+        reload_compute_jobs_.push_back(&compute_job);
+      }
+      continue;
+    }
+    for (auto& subpass : pass.GetSubpasses()) {
+      if (subpass.UsesShader(reloaded_shaders)) {
+        reload_subpasses_.push_back(&subpass);
+      }
+    }
+  }
+
+  if (reload_subpasses_.empty() && reload_compute_jobs_.empty()) {
+    return;
+  }
+
+  shader_reloading_ = true;
+  task_scheduler_->AddTaskSetToPipe(&shader_reload_task_set_);
+}
+
+void Framework::SwapPipelines() {
+  std::unordered_set<u64> replaced_hash_values;
+  for (auto* subpass : reload_subpasses_) {
+    subpass->SwapPipelines(replaced_hash_values);
+  }
+  for (auto* compute_job : reload_compute_jobs_) {
+    compute_job->SwapPipeline(replaced_hash_values);
+  }
+  reload_subpasses_.clear();
+  reload_compute_jobs_.clear();
+  shader_reloading_ = false;
+
+  // Pipelines are shared through the resource cache, one still bound
+  // somewhere else is kept.
+  for (const auto& pass : passes_) {
+    if (pass.GetType() == ast::PassType::kCompute) {
+      replaced_hash_values.erase(pass.GetComputeJob().GetPipelineHashValue());
+      continue;
+    }
+    for (const auto& subpass : pass.GetSubpasses()) {
+      replaced_hash_values.erase(subpass.GetLightClusterPipelineHashValue());
+      for (const auto& draw_element : subpass.GetDrawElements()) {
+        replaced_hash_values.erase(draw_element.pipeline_hash_value);
+      }
+    }
+  }
+
+  for (u64 hash_value : replaced_hash_values) {
+    vk::raii::Pipeline pipeline{resource_cache_->TakePipeline(hash_value)};
+    if (*pipeline) {
+      retired_pipelines_.push_back(RetiredPipeline{std::move(pipeline),
+                                                   graphics_timeline_value_,
+                                                   compute_timeline_value_});
+    }
+  }
+}
+
+void Framework::DestroyRetiredPipelines() {
+  if (retired_pipelines_.empty()) {
+    return;
+  }
+
+  u64 graphics_timeline_value{graphics_timeline_semaphore_.getCounterValue()};
+  u64 compute_timeline_value{compute_timeline_semaphore_.getCounterValue()};
+  std::erase_if(retired_pipelines_,
+                [&](const RetiredPipeline& retired_pipeline) {
+                  return retired_pipeline.graphics_timeline_value <=
+                             graphics_timeline_value &&
+                         retired_pipeline.compute_timeline_value <=
+                             compute_timeline_value;
+                });
 }
 
 void Framework::Render() {
@@ -370,36 +701,78 @@ void Framework::Render() {
 
 void Framework::BeginFrame() {
   WaitSemaphore();
+  AcquireSwapchainImage();
+}
+
+// The image is acquired before any pass is recorded, the framebuffers and the
+// semaphore waited on by presentation are chosen from its index.
+void Framework::AcquireSwapchainImage() {
+  // Without a swapchain the offscreen images are used in turn.
+  if (headless_) {
+    swapchain_image_index_ =
+        static_cast<u32>(absolute_frame_ % swapchain_images_.size());
+    return;
+  }
+
+  while (true) {
+    vk::Result acquire_next_image_result{};
+    try {
+      std::tie(acquire_next_image_result, swapchain_image_index_) =
+          swapchain_->acquireNextImage(
+              UINT64_MAX, *(image_acquired_semaphores_[frame_index_]));
+    } catch (const vk::OutOfDateKHRError&) {
+      // Nothing was signaled, so the swapchain is recreated right away.
+      function_ui_->Resize();
+      Resize();
+      continue;
+    }
 
-  for (u32 j{}; j < thread_count_; ++j) {
-    secondary_command_pools_[frame_index_][j].reset();
+    // The semaphore is signaled and the image can still be presented, the
+    // swapchain is recreated on the next tick.
+    if (acquire_next_image_result == vk::Result::eSuboptimalKHR) {
+      window_->SetFramebufferResized(true);
+    }
+    break;
   }
 }
 
 void Framework::RenderFrame() {
+  const glm::mat4& view{camera_->GetViewMatrix()};
+  f32 near_plane{camera_->GetNearPlane()};
+  f32 far_plane{camera_->GetFarPlane()};
+  const std::unordered_map<u32, bool>& show_scenes{
+      config_->GetGlobalContext().show_scenes};
+
+  image_producers_.clear();
+
   ast::PassType prev_pass_type{ast::PassType::kNone};
   const vk::raii::CommandBuffer* command_buffer{};
-  for (u32 i{}; i < passes_.size(); ++i) {
+  for (u32 k{}; k < live_pass_indices_.size(); ++k) {
+    u32 i{live_pass_indices_[k]};
     auto& pass{passes_[i]};
-    bool last_pass{i == passes_.size() - 1};
+    bool last_pass{k == live_pass_indices_.size() - 1};
 
     ast::PassType cur_pass_type{pass.GetType()};
     ast::PassType next_pass_type{ast::PassType::kNone};
-    if (i + 1 < passes_.size()) {
-      next_pass_type = passes_[i + 1].GetType();
+    if (k + 1 < live_pass_indices_.size()) {
+      next_pass_type = passes_[live_pass_indices_[k + 1]].GetType();
     }
 
     if (cur_pass_type == ast::PassType::kGraphics) {
       std::vector<fw::Subpass>& subpasses{pass.GetSubpasses()};
-      for (auto& subpass : subpasses) {
-        subpass.Update(frame_index_);
+      for (u32 j{}; j < subpasses.size(); ++j) {
+        subpasses[j].Update(frame_index_);
+
+        render_queues_[i][j].Build(subpasses[j].GetDrawElements(), view,
+                                   near_plane, far_plane, show_scenes);
       }
 
       if (prev_pass_type != ast::PassType::kGraphics) {
         command_buffer = &BeginGraphics();
       }
+      AddPassDependencies(pass);
 
-      RenderGraphics(*command_buffer, pass);
+      RenderGraphics(*command_buffer, pass, i);
 
       if (next_pass_type != ast::PassType::kGraphics) {
         EndGraphics(*command_buffer, last_pass);
@@ -410,6 +783,7 @@ void Framework::RenderFrame() {
       if (prev_pass_type != ast::PassType::kCompute) {
         command_buffer = &BeginCompute();
       }
+      AddPassDependencies(pass);
 
       RenderCompute(*command_buffer, pass);
 
@@ -417,28 +791,31 @@ void Framework::RenderFrame() {
         EndCompute(*command_buffer, last_pass);
       }
     }
+
+    prev_pass_type = cur_pass_type;
   }
 }
 
 void Framework::EndFrame() {
-  vk::PresentInfoKHR present_info{
-      *(rendering_finished_semaphores_[frame_index_]), **swapchain_,
-      swapchain_image_index_};
-
-  vk::Result present_result{gpu_->PresentQueuePresent(present_info)};
-  if (present_result != vk::Result::eSuccess &&
-      present_result != vk::Result::eSuboptimalKHR) {
-    THROW("Fail to present.");
+  if (!headless_) {
+    vk::PresentInfoKHR present_info{
+        *(rendering_finished_semaphores_[swapchain_image_index_]),
+        **swapchain_, swapchain_image_index_};
+
+    vk::Result present_result{gpu_->PresentQueuePresent(present_info)};
+    if (present_result != vk::Result::eSuccess &&
+        present_result != vk::Result::eSuboptimalKHR) {
+      THROW("Fail to present.");
+    }
   }
 
   ++absolute_frame_;
   primary_command_buffer_indices_[frame_index_] = 0;
+  compute_command_buffer_indices_[frame_index_] = 0;
   frame_index_ = absolute_frame_ % frame_count_;
-  scm_index_ = 0;
 }
 
 const vk::raii::CommandBuffer& Framework::BeginGraphics() {
-  WaitSemaphore();
   const vk::raii::CommandBuffer& primary_command_buffer{
       RequestPrimaryCommandBuffer()};
   primary_command_buffer.reset();
@@ -447,17 +824,23 @@ const vk::raii::CommandBuffer& Framework::BeginGraphics() {
 }
 
 void Framework::RenderGraphics(
-    const vk::raii::CommandBuffer& primary_command_buffer,
-    const fw::Pass& pass) {
+    const vk::raii::CommandBuffer& primary_command_buffer, const fw::Pass& pass,
+    u32 pass_index) {
 #ifndef NDEBUG
   gpu_->BeginLabel(primary_command_buffer, "Pass " + pass.GetName(),
                    {0.549F, 0.478F, 0.663F, 1.0F});
 #endif
   const vk::RenderPassBeginInfo& render_pass_bi{
-      pass.GetRenderPassBeginInfo(frame_index_)};
+      pass.GetRenderPassBeginInfo(frame_index_, swapchain_image_index_)};
 
-  // Tarverse subpasses.
   const std::vector<fw::Subpass>& subpasses{pass.GetSubpasses()};
+
+  // Light lists are built by compute, which can not run inside the pass.
+  for (const auto& subpass : subpasses) {
+    subpass.CullLights(primary_command_buffer, frame_index_);
+  }
+
+  // Tarverse subpasses.
   for (u32 i{}; i < subpasses.size(); ++i) {
     const fw::Subpass& subpass{subpasses[i]};
 #ifndef NDEBUG
@@ -467,8 +850,11 @@ void Framework::RenderGraphics(
 
     const std::vector<fw::DrawElement>& draw_elements{
         subpass.GetDrawElements()};
+    fw::RenderQueue& render_queue{render_queues_[pass_index][i]};
+    const std::vector<u32>& draw_element_indices{
+        render_queue.GetDrawElementIndices()};
 
-    bool use_secondary_command_buffer{draw_elements.size() > 10};
+    bool use_secondary_command_buffer{draw_element_indices.size() > 10};
 
     vk::SubpassContents subpass_contents{
         use_secondary_command_buffer
@@ -482,57 +868,72 @@ void Framework::RenderGraphics(
     }
 
     if (use_secondary_command_buffer) {
-      vk::CommandBufferInheritanceInfo inheritance_info{
-          render_pass_bi.renderPass, i, render_pass_bi.framebuffer};
-
-      for (u32 j{}; j < thread_count_; ++j) {
-        vk::CommandBufferBeginInfo command_buffer_bi{
-            vk::CommandBufferUsageFlagBits::eRenderPassContinue,
-            &inheritance_info};
-        secondary_command_buffers_[frame_index_][j][scm_index_].begin(
-            command_buffer_bi);
+      u32 secondary_index{secondary_indices_[pass_index][i]};
+
+      // Camera data lives in the subpass uniform buffer, so recorded commands
+      // stay valid until the draw list or the visible scenes change. The order
+      // of a back-to-front queue matters as well.
+      u64 hash_value{subpass.GetDrawElementVersion()};
+      HashCombine(hash_value, render_queue.GetVisibilityHashValue());
+      if (render_queue.IsBackToFront()) {
+        render_queue.Sort();
+        HashCombine(hash_value, render_queue.GetOrderHashValue());
       }
 
-      CommandRecord command_record{
-          config_,      secondary_command_buffers_[frame_index_],
-          subpass,      draw_elements,
-          viewport_,    scissor_,
-          frame_index_, thread_count_,
-          scm_index_};
-      CommandRecordTaskSet command_record_task_set{&command_record};
-      task_scheduler_->AddTaskSetToPipe(&command_record_task_set);
-
-      task_scheduler_->WaitforTask(&command_record_task_set);
+      u64& secondary_hash_value{
+          secondary_hash_values_[frame_index_][secondary_index]};
+      if (secondary_hash_value != hash_value) {
+        secondary_hash_value = hash_value;
+        render_queue.Sort();
+
+        // The framebuffer is left unknown, it changes with the swapchain image
+        // while the recorded commands do not.
+        vk::CommandBufferInheritanceInfo inheritance_info{
+            render_pass_bi.renderPass, i};
+
+        for (u32 j{}; j < thread_count_; ++j) {
+          vk::CommandBufferBeginInfo command_buffer_bi{
+              vk::CommandBufferUsageFlagBits::eRenderPassContinue,
+              &inheritance_info};
+          secondary_command_buffers_[frame_index_][j][secondary_index].begin(
+              command_buffer_bi);
+        }
 
-      for (u32 j{}; j < thread_count_; ++j) {
-        secondary_command_buffers_[frame_index_][j][scm_index_].end();
+        CommandRecord command_record{secondary_command_buffers_[frame_index_],
+                                     subpass,
+                                     draw_elements,
+                                     draw_element_indices,
+                                     viewport_,
+                                     scissor_,
+                                     frame_index_,
+                                     thread_count_,
+                                     secondary_index};
+        CommandRecordTaskSet command_record_task_set{&command_record};
+        task_scheduler_->AddTaskSetToPipe(&command_record_task_set);
+
+        task_scheduler_->WaitforTask(&command_record_task_set);
+
+        for (u32 j{}; j < thread_count_; ++j) {
+          secondary_command_buffers_[frame_index_][j][secondary_index].end();
+        }
       }
 
       std::vector<vk::CommandBuffer> command_buffers;
       for (u32 j{}; j < thread_count_; ++j) {
         command_buffers.push_back(
-            *(secondary_command_buffers_[frame_index_][j][scm_index_]));
+            *(secondary_command_buffers_[frame_index_][j][secondary_index]));
       }
 
       primary_command_buffer.executeCommands(command_buffers);
-
-      ++scm_index_;
     } else {
+      render_queue.Sort();
+
       primary_command_buffer.setViewport(0, viewport_);
       primary_command_buffer.setScissor(0, scissor_);
 
-      const vk::raii::Pipeline* prev_pipeline{};
-      const vk::raii::PipelineLayout* prev_pipeline_layout{};
-      for (const fw::DrawElement& draw_element : draw_elements) {
-        if (draw_element.has_scene &&
-            !(config_->GetGlobalContext()
-                  .show_scenes[draw_element.scene_index])) {
-          continue;
-        }
-        RecordGraphicsCommand(primary_command_buffer, subpass, draw_element,
-                              prev_pipeline, prev_pipeline_layout,
-                              frame_index_);
-      }
+      RecordGraphicsCommands(
+          primary_command_buffer, subpass, draw_elements, draw_element_indices,
+          0, static_cast<u32>(draw_element_indices.size()), frame_index_);
     }
 
     // Ui.
@@ -558,22 +959,16 @@ void Framework::EndGraphics(
   std::vector<vk::SemaphoreSubmitInfo> wait_semaphore_sis;
   std::vector<vk::CommandBufferSubmitInfo> command_buffer_sis{
       *primary_command_buffer};
-  std::vector<vk::SemaphoreSubmitInfo> signal_semaphore_sis{
-      {*timeline_semaphores_[frame_index_], timeline_values_[frame_index_]++,
-       vk::PipelineStageFlagBits2::eColorAttachmentOutput}};
-
-  if (last_pass) {
-    vk::Result acquire_next_image_result{};
-    std::tie(acquire_next_image_result, swapchain_image_index_) =
-        swapchain_->acquireNextImage(
-            UINT64_MAX, *(image_acquired_semaphores_[frame_index_]));
+  std::vector<vk::SemaphoreSubmitInfo> signal_semaphore_sis;
+  AddTimelineSubmitInfos(false, wait_semaphore_sis, signal_semaphore_sis);
 
+  if (last_pass && !headless_) {
     wait_semaphore_sis.emplace_back(
         *(image_acquired_semaphores_[frame_index_]), 0,
         vk::PipelineStageFlagBits2::eColorAttachmentOutput);
 
     signal_semaphore_sis.emplace_back(
-        *(rendering_finished_semaphores_[frame_index_]), 0,
+        *(rendering_finished_semaphores_[swapchain_image_index_]), 0,
         vk::PipelineStageFlagBits2::eColorAttachmentOutput);
   }
 
@@ -584,9 +979,8 @@ void Framework::EndGraphics(
 }
 
 const vk::raii::CommandBuffer& Framework::BeginCompute() {
-  WaitSemaphore();
   const vk::raii::CommandBuffer& compute_command_buffer{
-      RequestPrimaryCommandBuffer()};
+      RequestComputeCommandBuffer()};
   compute_command_buffer.reset();
   compute_command_buffer.begin({});
   return compute_command_buffer;
@@ -610,16 +1004,9 @@ void Framework::RenderCompute(
 
   const vk::raii::PipelineLayout* pipeline_layout{
       compute_job.GetPipelineLayout()};
-  const vk::raii::DescriptorSets& descriptor_sets{
-      compute_job.GetDescriptorSets(frame_index_)};
-
-  std::vector<vk::DescriptorSet> vk_descriptor_sets;
-  for (const auto& descriptor_set : descriptor_sets) {
-    vk_descriptor_sets.push_back(*(descriptor_set));
-  }
-  compute_command_buffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute,
-                                            *pipeline_layout, 0,
-                                            vk_descriptor_sets, nullptr);
+  compute_command_buffer.bindDescriptorSets(
+      vk::PipelineBindPoint::eCompute, *pipeline_layout, 0,
+      compute_job.GetDescriptorSets(frame_index_), nullptr);
 
   u32 group_count_x{compute_job.GetGroupCountX()};
   u32 group_count_y{compute_job.GetGroupCountY()};
@@ -640,22 +1027,16 @@ void Framework::EndCompute(
   std::vector<vk::SemaphoreSubmitInfo> wait_semaphore_sis;
   std::vector<vk::CommandBufferSubmitInfo> command_buffer_sis{
       *compute_command_buffer};
-  std::vector<vk::SemaphoreSubmitInfo> signal_semaphore_sis{
-      {*timeline_semaphores_[frame_index_], timeline_values_[frame_index_]++,
-       vk::PipelineStageFlagBits2::eComputeShader}};
-
-  if (last_pass) {
-    vk::Result acquire_next_image_result{};
-    std::tie(acquire_next_image_result, swapchain_image_index_) =
-        swapchain_->acquireNextImage(
-            UINT64_MAX, *(image_acquired_semaphores_[frame_index_]));
+  std::vector<vk::SemaphoreSubmitInfo> signal_semaphore_sis;
+  AddTimelineSubmitInfos(true, wait_semaphore_sis, signal_semaphore_sis);
 
+  if (last_pass && !headless_) {
     wait_semaphore_sis.emplace_back(*(image_acquired_semaphores_[frame_index_]),
                                     0,
                                     vk::PipelineStageFlagBits2::eComputeShader);
 
     signal_semaphore_sis.emplace_back(
-        *(rendering_finished_semaphores_[frame_index_]), 0,
+        *(rendering_finished_semaphores_[swapchain_image_index_]), 0,
         vk::PipelineStageFlagBits2::eComputeShader);
   }
 
@@ -670,13 +1051,88 @@ const vk::raii::CommandBuffer& Framework::RequestPrimaryCommandBuffer() {
   return primary_command_buffers_[frame_index_][index];
 }
 
+const vk::raii::CommandBuffer& Framework::RequestComputeCommandBuffer() {
+  u32 index{compute_command_buffer_indices_[frame_index_]++};
+  return compute_command_buffers_[frame_index_][index];
+}
+
 void Framework::WaitSemaphore() {
-  u64 value{timeline_values_[frame_index_] - 1};
-  if (value > 0) {
-    const vk::raii::Semaphore& semaphore{timeline_semaphores_[frame_index_]};
-    vk::SemaphoreWaitInfo semaphore_wi{{}, *semaphore, value};
+  std::vector<vk::Semaphore> semaphores;
+  std::vector<u64> values;
+  if (frame_graphics_timeline_values_[frame_index_] > 0) {
+    semaphores.push_back(*graphics_timeline_semaphore_);
+    values.push_back(frame_graphics_timeline_values_[frame_index_]);
+  }
+  if (frame_compute_timeline_values_[frame_index_] > 0) {
+    semaphores.push_back(*compute_timeline_semaphore_);
+    values.push_back(frame_compute_timeline_values_[frame_index_]);
+  }
+  if (!semaphores.empty()) {
+    vk::SemaphoreWaitInfo semaphore_wi{{}, semaphores, values};
     gpu_->WaitSemaphores(semaphore_wi);
   }
 }
 
+void Framework::AddPassDependencies(const fw::Pass& pass) {
+  // Only images produced by an earlier submission of this frame are waited
+  // on, so compute and graphics queues overlap wherever the graph allows it.
+  auto add_dependency{[this](const std::string& name) {
+    auto it{image_producers_.find(name)};
+    if (it == image_producers_.end()) {
+      return;
+    }
+    for (auto& wait_semaphore_si : pending_wait_semaphore_sis_) {
+      if (wait_semaphore_si.semaphore == it->second.semaphore) {
+        wait_semaphore_si.value =
+            std::max(wait_semaphore_si.value, it->second.value);
+        return;
+      }
+    }
+    pending_wait_semaphore_sis_.push_back(it->second);
+  }};
+
+  if (pass.GetType() == ast::PassType::kGraphics) {
+    for (const auto& subpass : pass.GetSubpasses()) {
+      for (const auto& name : subpass.GetSharedImageNames()) {
+        add_dependency(name);
+      }
+    }
+  } else {
+    for (const auto& name : pass.GetComputeJob().GetSharedImageNames()) {
+      add_dependency(name);
+    }
+  }
+
+  const std::vector<std::string>& output_image_names{
+      pass.GetOutputImageNames()};
+  pending_output_image_names_.insert(pending_output_image_names_.end(),
+                                     output_image_names.begin(),
+                                     output_image_names.end());
+}
+
+void Framework::AddTimelineSubmitInfos(
+    bool compute, std::vector<vk::SemaphoreSubmitInfo>& wait_semaphore_sis,
+    std::vector<vk::SemaphoreSubmitInfo>& signal_semaphore_sis) {
+  const vk::raii::Semaphore& semaphore{compute ? compute_timeline_semaphore_
+                                               : graphics_timeline_semaphore_};
+  u64& value{compute ? compute_timeline_value_ : graphics_timeline_value_};
+  std::vector<u64>& frame_values{compute ? frame_compute_timeline_values_
+                                         : frame_graphics_timeline_values_};
+
+  wait_semaphore_sis.insert(wait_semaphore_sis.end(),
+                            pending_wait_semaphore_sis_.begin(),
+                            pending_wait_semaphore_sis_.end());
+  pending_wait_semaphore_sis_.clear();
+
+  vk::SemaphoreSubmitInfo signal_semaphore_si{
+      *semaphore, ++value, vk::PipelineStageFlagBits2::eAllCommands};
+  signal_semaphore_sis.push_back(signal_semaphore_si);
+  frame_values[frame_index_] = value;
+
+  for (const auto& name : pending_output_image_names_) {
+    image_producers_[name] = signal_semaphore_si;
+  }
+  pending_output_image_names_.clear();
+}
+
 }  // namespace luka
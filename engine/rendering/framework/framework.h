@@ -14,6 +14,8 @@
 #include "function/camera/camera.h"
 #include "function/function_ui/function_ui.h"
 #include "rendering/framework/pass.h"
+#include "rendering/framework/render_queue.h"
+#include "rendering/framework/resource_cache.h"
 #include "resource/asset/asset.h"
 #include "resource/config/config.h"
 
@@ -21,32 +23,29 @@ namespace luka {
 
 class CommandRecord {
  public:
-  CommandRecord(std::shared_ptr<Config> config,
-                const std::vector<vk::raii::CommandBuffers>& secondary_buffers,
+  CommandRecord(const std::vector<vk::raii::CommandBuffers>& secondary_buffers,
                 const fw::Subpass& subpass,
                 const std::vector<fw::DrawElement>& draw_elements,
+                const std::vector<u32>& draw_element_indices,
                 const vk::Viewport& viewport, const vk::Rect2D& scissor,
-                u32 frame_index, u32 thread_count, u32 scm_index);
+                u32 frame_index, u32 chunk_count, u32 scm_index);
 
-  void Record(enki::TaskSetPartition range, u32 thread_num);
+  void Record(enki::TaskSetPartition range);
 
-  u32 GetDrawElmentCount() const;
+  u32 GetChunkCount() const;
 
  private:
-  std::shared_ptr<Config> config_;
-
   const std::vector<vk::raii::CommandBuffers>* secondary_buffers_{};
   const fw::Subpass* subpass_{};
   const std::vector<fw::DrawElement>* draw_elements_{};
+  const std::vector<u32>* draw_element_indices_{};
   const vk::Viewport* viewport_{};
   const vk::Rect2D* scissor_{};
   u32 frame_index_{};
-  u32 thread_count_{};
+  u32 chunk_count_{};
   u32 scm_index_{};
 
-  u32 draw_element_count_{};
-  std::vector<const vk::raii::Pipeline*> prev_pipeline_;
-  std::vector<const vk::raii::PipelineLayout*> prev_pipeline_layout_;
+  u32 chunk_size_{};
 };
 
 class CommandRecordTaskSet : public enki::ITaskSet {
@@ -59,6 +58,28 @@ class CommandRecordTaskSet : public enki::ITaskSet {
   CommandRecord* command_record_{};
 };
 
+class Framework;
+
+// Rebuilds the pipelines of reloaded shaders at low priority, waits of the
+// render loop only run high priority tasks and never pick it up.
+class ShaderReloadTaskSet : public enki::ITaskSet {
+ public:
+  explicit ShaderReloadTaskSet(Framework* framework);
+
+  void ExecuteRange(enki::TaskSetPartition range, uint32_t thread_num) override;
+
+ private:
+  Framework* framework_{};
+};
+
+// A replaced pipeline lives until both queues have passed the submissions
+// that may still use it.
+struct RetiredPipeline {
+  vk::raii::Pipeline pipeline{nullptr};
+  u64 graphics_timeline_value;
+  u64 compute_timeline_value;
+};
+
 class Framework {
  public:
   DELETE_SPECIAL_MEMBER_FUNCTIONS(Framework)
@@ -73,24 +94,32 @@ class Framework {
 
   void Tick();
 
+  void ReloadPipelines();
+
  private:
   void GetSwapchain();
   void CreateSyncObjects();
   void CreateCommandObjects();
   void CreateViewportAndScissor();
   void CreatePasses();
+  void CompileFrameGraph();
 
   void Resize();
 
+  void ReloadShaders();
+  void SwapPipelines();
+  void DestroyRetiredPipelines();
+
   void Render();
 
   void BeginFrame();
+  void AcquireSwapchainImage();
   void RenderFrame();
   void EndFrame();
 
   const vk::raii::CommandBuffer& BeginGraphics();
   void RenderGraphics(const vk::raii::CommandBuffer& primary_command_buffer,
-                      const fw::Pass& pass);
+                      const fw::Pass& pass, u32 pass_index);
   void EndGraphics(const vk::raii::CommandBuffer& primary_command_buffer,
                    bool last_pass = false);
 
@@ -102,6 +131,11 @@ class Framework {
 
   const vk::raii::CommandBuffer& RequestPrimaryCommandBuffer();
   void WaitSemaphore();
+  const vk::raii::CommandBuffer& RequestComputeCommandBuffer();
+  void AddPassDependencies(const fw::Pass& pass);
+  void AddTimelineSubmitInfos(
+      bool compute, std::vector<vk::SemaphoreSubmitInfo>& wait_semaphore_sis,
+      std::vector<vk::SemaphoreSubmitInfo>& signal_semaphore_sis);
 
   std::shared_ptr<TaskScheduler> task_scheduler_;
   std::shared_ptr<Window> window_;
@@ -110,9 +144,12 @@ class Framework {
   std::shared_ptr<Asset> asset_;
   std::shared_ptr<Camera> camera_;
   std::shared_ptr<FunctionUi> function_ui_;
+  bool headless_{};
 
   u32 thread_count_{};
 
+  std::shared_ptr<fw::ResourceCache> resource_cache_;
+
   const SwapchainInfo* swapchain_info_{};
   const vk::raii::SwapchainKHR* swapchain_{};
   std::vector<vk::Image> swapchain_images_;
@@ -120,8 +157,15 @@ class Framework {
 
   std::vector<vk::raii::Semaphore> image_acquired_semaphores_;
   std::vector<vk::raii::Semaphore> rendering_finished_semaphores_;
-  std::vector<vk::raii::Semaphore> timeline_semaphores_;
-  std::vector<u64> timeline_values_;
+  vk::raii::Semaphore graphics_timeline_semaphore_{nullptr};
+  vk::raii::Semaphore compute_timeline_semaphore_{nullptr};
+  u64 graphics_timeline_value_{};
+  u64 compute_timeline_value_{};
+  std::vector<u64> frame_graphics_timeline_values_;
+  std::vector<u64> frame_compute_timeline_values_;
+  std::unordered_map<std::string, vk::SemaphoreSubmitInfo> image_producers_;
+  std::vector<vk::SemaphoreSubmitInfo> pending_wait_semaphore_sis_;
+  std::vector<std::string> pending_output_image_names_;
 
   const u32 kGraphicsCommandBufferCount{4};
   const u32 kComputeCommandBufferCount{4};
@@ -129,6 +173,7 @@ class Framework {
   std::vector<vk::raii::CommandBuffers> primary_command_buffers_;
   std::vector<std::vector<vk::raii::CommandPool>> secondary_command_pools_;
   std::vector<std::vector<vk::raii::CommandBuffers>> secondary_command_buffers_;
+  std::vector<std::vector<u64>> secondary_hash_values_;
   std::vector<vk::raii::CommandPool> compute_command_pools_;
   std::vector<vk::raii::CommandBuffers> compute_command_buffers_;
   std::vector<u32> primary_command_buffer_indices_;
@@ -140,12 +185,22 @@ class Framework {
   std::vector<std::unordered_map<std::string, vk::Image>> shared_images_;
   std::vector<std::unordered_map<std::string, vk::ImageView>>
       shared_image_views_;
+  std::unordered_map<u64, std::vector<gpu::Image>> transient_images_;
   std::vector<fw::Pass> passes_;
+  std::vector<u32> live_pass_indices_;
+  std::vector<std::vector<fw::RenderQueue>> render_queues_;
+  std::vector<std::vector<u32>> secondary_indices_;
+  u32 secondary_count_{};
 
   u32 frame_index_{};
   u64 absolute_frame_{};
-  u32 scm_index_{};
   u32 swapchain_image_index_{};
+
+  ShaderReloadTaskSet shader_reload_task_set_{this};
+  bool shader_reloading_{};
+  std::vector<fw::Subpass*> reload_subpasses_;
+  std::vector<fw::ComputeJob*> reload_compute_jobs_;
+  std::vector<RetiredPipeline> retired_pipelines_;
 };
 
 }  // namespace luka
@@ -0,0 +1,243 @@
+// SPDX license identifier: MIT.
+// Copyright (C) 2023-present Liam Hauw.
+
+// clang-format off
+#include "platform/pch.h"
+// clang-format on
+
+#include "rendering/framework/light_cluster.h"
+
+#include "core/log.h"
+#include "rendering/framework/descriptor_update.h"
+
+namespace luka::fw {
+
+namespace {
+
+constexpr u32 kLightClusterGroupSize{64};
+
+}  // namespace
+
+std::vector<std::string> GetLightClusterShaderProcesses() {
+  return {
+      "DLIGHT_CLUSTER_X " + std::to_string(kLightClusterXCount),
+      "DLIGHT_CLUSTER_Y " + std::to_string(kLightClusterYCount),
+      "DLIGHT_CLUSTER_Z " + std::to_string(kLightClusterZCount),
+      "DLIGHT_CLUSTER_LIGHT_MAX_COUNT " +
+          std::to_string(kLightClusterLightMaxCount),
+      "DDIRECTIONAL_LIGHT " + std::to_string(static_cast<u32>(
+                                  ast::PunctualLightType::kDirectional)),
+      "DPOINT_LIGHT " +
+          std::to_string(static_cast<u32>(ast::PunctualLightType::kPoint)),
+      "DSPOT_LIGHT " +
+          std::to_string(static_cast<u32>(ast::PunctualLightType::kSpot))};
+}
+
+LightCluster::LightCluster(std::shared_ptr<Gpu> gpu,
+                           std::shared_ptr<ResourceCache> resource_cache,
+                           std::shared_ptr<Asset> asset,
+                           std::shared_ptr<Camera> camera, u32 frame_count,
+                           u32 shader, const std::vector<u32>& lights)
+    : gpu_{std::move(gpu)},
+      resource_cache_{std::move(resource_cache)},
+      asset_{std::move(asset)},
+      camera_{std::move(camera)},
+      frame_count_{frame_count},
+      shader_{shader},
+      descriptor_allocator_{gpu_->CreateDescriptorAllocator()} {
+  CreateBuffers(lights);
+  CreatePipelineResources();
+  pipeline_hash_value_ = CreatePipeline();
+  pipeline_ = &resource_cache_->GetPipeline(pipeline_hash_value_);
+}
+
+void LightCluster::Update(u32 frame_index) {
+  LightClusterUniform uniform{camera_->GetViewMatrix(),
+                              glm::inverse(camera_->GetProjectionMatrix()),
+                              camera_->GetNearPlane(), camera_->GetFarPlane(),
+                              light_count_};
+
+  void* mapped{uniform_buffers_[frame_index].Map()};
+  memcpy(mapped, reinterpret_cast<const void*>(&uniform),
+         sizeof(LightClusterUniform));
+}
+
+void LightCluster::Cull(const vk::raii::CommandBuffer& command_buffer,
+                        u32 frame_index) const {
+  command_buffer.bindPipeline(vk::PipelineBindPoint::eCompute, **pipeline_);
+  command_buffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute,
+                                    **pipeline_layout_, 0,
+                                    descriptor_sets_[frame_index], nullptr);
+  command_buffer.dispatch(
+      (kLightClusterCount + kLightClusterGroupSize - 1) /
+          kLightClusterGroupSize,
+      1, 1);
+
+  // The previous reads of this frame's lists finished before the frame was
+  // acquired again, so only the new lists have to reach the fragments.
+  vk::BufferMemoryBarrier2 buffer_memory_barrier{
+      vk::PipelineStageFlagBits2::eComputeShader,
+      vk::AccessFlagBits2::eShaderStorageWrite,
+      vk::PipelineStageFlagBits2::eFragmentShader,
+      vk::AccessFlagBits2::eShaderStorageRead,
+      VK_QUEUE_FAMILY_IGNORED,
+      VK_QUEUE_FAMILY_IGNORED,
+      *cluster_buffers_[frame_index],
+      0,
+      cluster_buffer_size_};
+  command_buffer.pipelineBarrier2(
+      vk::DependencyInfo{{}, {}, buffer_memory_barrier, {}});
+}
+
+vk::DescriptorBufferInfo LightCluster::GetLightBufferInfo() const {
+  return {*light_buffer_, 0, light_buffer_size_};
+}
+
+vk::DescriptorBufferInfo LightCluster::GetClusterBufferInfo(
+    u32 frame_index) const {
+  return {*cluster_buffers_[frame_index], 0, cluster_buffer_size_};
+}
+
+u64 LightCluster::GetPipelineHashValue() const {
+  return pipeline_hash_value_;
+}
+
+// The bindings are fixed by this class, so only the shader can change.
+void LightCluster::ReloadPipeline() {
+  reloaded_pipeline_hash_value_ = 0;
+
+  try {
+    reloaded_pipeline_hash_value_ = CreatePipeline();
+  } catch (const Exception&) {
+    LOGW("Fail to reload pipeline of light cluster {}", shader_);
+  }
+}
+
+void LightCluster::SwapPipeline(std::unordered_set<u64>& replaced_hash_values) {
+  if (reloaded_pipeline_hash_value_ == 0 ||
+      reloaded_pipeline_hash_value_ == pipeline_hash_value_) {
+    reloaded_pipeline_hash_value_ = 0;
+    return;
+  }
+
+  replaced_hash_values.insert(pipeline_hash_value_);
+  pipeline_hash_value_ = reloaded_pipeline_hash_value_;
+  pipeline_ = &resource_cache_->GetPipeline(pipeline_hash_value_);
+  reloaded_pipeline_hash_value_ = 0;
+}
+
+void LightCluster::CreateBuffers(const std::vector<u32>& lights) {
+  // Lights do not move, they are uploaded once.
+  std::vector<ast::PunctualLight> punctual_lights;
+  for (u32 light : lights) {
+    const auto& pls{asset_->GetLight(light).GetPunctualLights()};
+    punctual_lights.insert(punctual_lights.end(), pls.begin(), pls.end());
+  }
+  light_count_ = static_cast<u32>(punctual_lights.size());
+
+  // Storage buffers can not be empty.
+  if (punctual_lights.empty()) {
+    punctual_lights.emplace_back();
+  }
+
+  light_buffer_size_ = sizeof(ast::PunctualLight) * punctual_lights.size();
+  vk::BufferCreateInfo light_buffer_ci{
+      {}, light_buffer_size_, vk::BufferUsageFlagBits::eStorageBuffer};
+  light_buffer_ = gpu_->CreateBuffer(light_buffer_ci, punctual_lights.data(),
+                                     false, "light_cluster_light");
+
+  // A light count per cluster followed by the light indices of all clusters.
+  cluster_buffer_size_ =
+      sizeof(u32) * (kLightClusterCount +
+                     static_cast<u64>(kLightClusterCount) *
+                         kLightClusterLightMaxCount);
+  vk::BufferCreateInfo cluster_buffer_ci{
+      {}, cluster_buffer_size_, vk::BufferUsageFlagBits::eStorageBuffer};
+
+  LightClusterUniform uniform{};
+  vk::BufferCreateInfo uniform_buffer_ci{
+      {}, sizeof(LightClusterUniform), vk::BufferUsageFlagBits::eUniformBuffer};
+
+  for (u32 i{}; i < frame_count_; ++i) {
+    cluster_buffers_.push_back(gpu_->CreateDeviceBuffer(
+        cluster_buffer_ci, "light_cluster_cluster", static_cast<i32>(i)));
+    uniform_buffers_.push_back(gpu_->CreateBuffer(
+        uniform_buffer_ci, &uniform, true, "light_cluster_uniform",
+        static_cast<i32>(i)));
+  }
+}
+
+void LightCluster::CreatePipelineResources() {
+  // Descriptor set layout, the bindings are fixed by the culling shader.
+  std::vector<vk::DescriptorSetLayoutBinding> bindings{
+      {0, vk::DescriptorType::eUniformBuffer, 1,
+       vk::ShaderStageFlagBits::eCompute},
+      {1, vk::DescriptorType::eStorageBuffer, 1,
+       vk::ShaderStageFlagBits::eCompute},
+      {2, vk::DescriptorType::eStorageBuffer, 1,
+       vk::ShaderStageFlagBits::eCompute}};
+  vk::DescriptorSetLayoutCreateInfo descriptor_set_layout_ci{{}, bindings};
+  const vk::raii::DescriptorSetLayout& descriptor_set_layout{
+      resource_cache_->RequestDescriptorSetLayout(descriptor_set_layout_ci,
+                                                  "light_cluster")};
+
+  // Descriptor sets.
+  std::vector<vk::DescriptorSetLayout> descriptor_set_layouts(
+      frame_count_, *descriptor_set_layout);
+  vk::DescriptorSetAllocateInfo descriptor_set_ai{nullptr,
+                                                  descriptor_set_layouts};
+  descriptor_sets_ = gpu_->AllocateDescriptorSets(
+      descriptor_allocator_, descriptor_set_ai, "light_cluster");
+
+  for (u32 i{}; i < frame_count_; ++i) {
+    DescriptorUpdate descriptor_update;
+    descriptor_update.AddBuffer(
+        0, vk::DescriptorType::eUniformBuffer,
+        vk::DescriptorBufferInfo{*uniform_buffers_[i], 0,
+                                 sizeof(LightClusterUniform)});
+    descriptor_update.AddBuffer(1, vk::DescriptorType::eStorageBuffer,
+                                GetLightBufferInfo());
+    descriptor_update.AddBuffer(2, vk::DescriptorType::eStorageBuffer,
+                                GetClusterBufferInfo(i));
+    descriptor_update.Update(*gpu_, *resource_cache_, descriptor_sets_[i],
+                             *descriptor_set_layout, "light_cluster");
+  }
+
+  // Pipeline layout.
+  vk::PipelineLayoutCreateInfo pipeline_layout_ci{{}, *descriptor_set_layout};
+  pipeline_layout_ = &(resource_cache_->RequestPipelineLayout(
+      pipeline_layout_ci, "light_cluster"));
+}
+
+u64 LightCluster::CreatePipeline() {
+  std::vector<std::string> processes{GetLightClusterShaderProcesses()};
+  processes.push_back("DLIGHT_CLUSTER_GROUP_SIZE " +
+                      std::to_string(kLightClusterGroupSize));
+
+  const SPIRV& spirv{resource_cache_->RequestSpirv(
+      asset_->GetShader(shader_), processes,
+      vk::ShaderStageFlagBits::eCompute)};
+
+  u64 pipeline_hash_value{};
+  u64 shader_module_hash_value{spirv.GetHashValue()};
+  HashCombine(pipeline_hash_value, shader_module_hash_value);
+
+  const std::vector<u32>& code{spirv.GetSpirv()};
+  vk::ShaderModuleCreateInfo shader_module_ci{
+      {}, code.size() * 4, code.data()};
+  const vk::raii::ShaderModule& shader_module{
+      resource_cache_->RequestShaderModule(shader_module_ci,
+                                           shader_module_hash_value)};
+
+  vk::PipelineShaderStageCreateInfo shader_stage_ci{
+      {}, vk::ShaderStageFlagBits::eCompute, *shader_module, "main", nullptr};
+  vk::ComputePipelineCreateInfo compute_pipeline_ci{
+      {}, shader_stage_ci, **pipeline_layout_};
+
+  resource_cache_->RequestPipeline(compute_pipeline_ci, pipeline_hash_value,
+                                   "light_cluster");
+
+  return pipeline_hash_value;
+}
+
+}  // namespace luka::fw
@@ -0,0 +1,97 @@
+// SPDX license identifier: MIT.
+// Copyright (C) 2023-present Liam Hauw.
+
+#pragma once
+
+// clang-format off
+#include "platform/pch.h"
+// clang-format on
+
+#include "base/gpu/gpu.h"
+#include "core/math.h"
+#include "core/util.h"
+#include "function/camera/camera.h"
+#include "rendering/framework/resource_cache.h"
+#include "resource/asset/asset.h"
+
+namespace luka::fw {
+
+// Tiles are uniform in normalized device coordinates and slices exponential
+// in view depth.
+constexpr u32 kLightClusterXCount{16};
+constexpr u32 kLightClusterYCount{9};
+constexpr u32 kLightClusterZCount{24};
+constexpr u32 kLightClusterCount{kLightClusterXCount * kLightClusterYCount *
+                                 kLightClusterZCount};
+constexpr u32 kLightClusterLightMaxCount{128};
+
+struct alignas(16) LightClusterUniform {
+  glm::mat4 view;
+  glm::mat4 inverse_projection;
+  f32 z_near;
+  f32 z_far;
+  u32 light_count;
+};
+
+// Defines shared by the culling shader and the shaders reading its lists.
+std::vector<std::string> GetLightClusterShaderProcesses();
+
+/**
+ * Punctual lights of a subpass live in one storage buffer. Every frame a
+ * compute pass assigns them to a grid of view space clusters, the lit shaders
+ * then only loop over the lights of the cluster a fragment falls into.
+ */
+class LightCluster {
+ public:
+  DELETE_SPECIAL_MEMBER_FUNCTIONS(LightCluster)
+
+  LightCluster(std::shared_ptr<Gpu> gpu,
+               std::shared_ptr<ResourceCache> resource_cache,
+               std::shared_ptr<Asset> asset, std::shared_ptr<Camera> camera,
+               u32 frame_count, u32 shader, const std::vector<u32>& lights);
+
+  ~LightCluster() = default;
+
+  void Update(u32 frame_index);
+
+  void Cull(const vk::raii::CommandBuffer& command_buffer,
+            u32 frame_index) const;
+
+  vk::DescriptorBufferInfo GetLightBufferInfo() const;
+  vk::DescriptorBufferInfo GetClusterBufferInfo(u32 frame_index) const;
+  u64 GetPipelineHashValue() const;
+
+  // Hot reload, the pipeline is rebuilt off the render loop and swapped in
+  // between frames.
+  void ReloadPipeline();
+  void SwapPipeline(std::unordered_set<u64>& replaced_hash_values);
+
+ private:
+  void CreateBuffers(const std::vector<u32>& lights);
+  void CreatePipelineResources();
+  u64 CreatePipeline();
+
+  std::shared_ptr<Gpu> gpu_;
+  std::shared_ptr<ResourceCache> resource_cache_;
+  std::shared_ptr<Asset> asset_;
+  std::shared_ptr<Camera> camera_;
+
+  u32 frame_count_{};
+  u32 shader_{};
+
+  u32 light_count_{};
+  gpu::Buffer light_buffer_;
+  u64 light_buffer_size_{};
+  std::vector<gpu::Buffer> cluster_buffers_;
+  u64 cluster_buffer_size_{};
+  std::vector<gpu::Buffer> uniform_buffers_;
+
+  gpu::DescriptorAllocator descriptor_allocator_;
+  std::vector<vk::DescriptorSet> descriptor_sets_;
+  const vk::raii::PipelineLayout* pipeline_layout_{};
+  const vk::raii::Pipeline* pipeline_{};
+  u64 pipeline_hash_value_{};
+  u64 reloaded_pipeline_hash_value_{};
+};
+
+}  // namespace luka::fw
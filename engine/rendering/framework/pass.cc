@@ -8,11 +8,14 @@
 #include "rendering/framework/pass.h"
 
 #include "core/log.h"
+#include "core/util.h"
 
 namespace luka::fw {
 
 Pass::Pass(
-    std::shared_ptr<Gpu> gpu, std::shared_ptr<Asset> asset,
+    std::shared_ptr<TaskScheduler> task_scheduler, std::shared_ptr<Gpu> gpu,
+    std::shared_ptr<ResourceCache> resource_cache,
+    std::shared_ptr<Config> config, std::shared_ptr<Asset> asset,
     std::shared_ptr<Camera> camera, std::shared_ptr<FunctionUi> function_ui,
     u32 frame_count, const SwapchainInfo& swapchain_info,
     const std::vector<vk::Image>& swapchain_images,
@@ -20,8 +23,12 @@ Pass::Pass(
     const std::vector<ScenePrimitive>& scene_primitives,
     std::vector<std::unordered_map<std::string, vk::Image>>& shared_images,
     std::vector<std::unordered_map<std::string, vk::ImageView>>&
-        shared_image_views)
-    : gpu_{std::move(gpu)},
+        shared_image_views,
+    std::unordered_map<u64, std::vector<gpu::Image>>& transient_images)
+    : task_scheduler_{std::move(task_scheduler)},
+      gpu_{std::move(gpu)},
+      resource_cache_{std::move(resource_cache)},
+      config_{std::move(config)},
       asset_{std::move(asset)},
       camera_{std::move(camera)},
       function_ui_{std::move(function_ui)},
@@ -33,6 +40,7 @@ Pass::Pass(
       scene_primitives_{&scene_primitives},
       shared_images_{&shared_images},
       shared_image_views_{&shared_image_views},
+      transient_images_{&transient_images},
       ast_pass_{&(*ast_passes_)[pass_index_]},
       name_{ast_pass_->name},
       type_{ast_pass_->type},
@@ -51,6 +59,14 @@ Pass::Pass(
       std::move(gpu_->AllocateCommandBuffers(command_buffer_ai).front());
   transfer_command_buffer_.begin(command_buffer_bi);
 
+  for (const auto& ast_attachment : ast_pass_->attachments) {
+    if (ast_attachment.name == "swapchain") {
+      has_swapchain_ = true;
+    } else if (ast_attachment.output) {
+      output_image_names_.push_back(ast_attachment.name);
+    }
+  }
+
   if (type_ == ast::PassType::kGraphics) {
     CreateRenderPass();
     CreateFramebuffers();
@@ -95,9 +111,13 @@ const std::string& Pass::GetName() const { return name_; }
 
 ast::PassType Pass::GetType() const { return type_; }
 
-vk::RenderPassBeginInfo Pass::GetRenderPassBeginInfo(u32 frame_index) const {
+vk::RenderPassBeginInfo Pass::GetRenderPassBeginInfo(
+    u32 frame_index, u32 swapchain_image_index) const {
+  const std::vector<vk::raii::Framebuffer>& framebuffers{
+      framebuffers_[frame_index]};
+  u32 framebuffer_index{framebuffers.size() > 1 ? swapchain_image_index : 0};
   vk::RenderPassBeginInfo render_pass_bi{*render_pass_,
-                                         *(framebuffers_[frame_index]),
+                                         *(framebuffers[framebuffer_index]),
                                          render_area_, clear_values_};
   return render_pass_bi;
 }
@@ -110,6 +130,25 @@ ComputeJob& Pass::GetComputeJob() { return compute_job_; }
 
 bool Pass::HasUi() const { return has_ui_; }
 
+bool Pass::HasSwapchain() const { return has_swapchain_; }
+
+std::unordered_set<std::string> Pass::GetInputImageNames() const {
+  if (type_ == ast::PassType::kCompute) {
+    return compute_job_.GetSharedImageNames();
+  }
+
+  std::unordered_set<std::string> input_image_names;
+  for (const auto& subpass : subpasses_) {
+    const std::unordered_set<std::string>& names{subpass.GetSharedImageNames()};
+    input_image_names.insert(names.begin(), names.end());
+  }
+  return input_image_names;
+}
+
+const std::vector<std::string>& Pass::GetOutputImageNames() const {
+  return output_image_names_;
+}
+
 void Pass::CreateRenderPass() {
   // Ui render pass has been created, just move it.
   if (has_ui_) {
@@ -220,6 +259,23 @@ void Pass::CreateRenderPass() {
     }
   }
 
+  // Earlier passes may still write aliased transient attachments or the images
+  // sampled here.
+  subpass_dependencies.emplace_back(
+      VK_SUBPASS_EXTERNAL, 0,
+      vk::PipelineStageFlagBits::eColorAttachmentOutput |
+          vk::PipelineStageFlagBits::eLateFragmentTests |
+          vk::PipelineStageFlagBits::eFragmentShader,
+      vk::PipelineStageFlagBits::eColorAttachmentOutput |
+          vk::PipelineStageFlagBits::eEarlyFragmentTests |
+          vk::PipelineStageFlagBits::eFragmentShader,
+      vk::AccessFlagBits::eColorAttachmentWrite |
+          vk::AccessFlagBits::eDepthStencilAttachmentWrite,
+      vk::AccessFlagBits::eColorAttachmentWrite |
+          vk::AccessFlagBits::eDepthStencilAttachmentRead |
+          vk::AccessFlagBits::eDepthStencilAttachmentWrite |
+          vk::AccessFlagBits::eShaderRead);
+
   vk::RenderPassCreateInfo render_pass_ci{
       {}, attachment_descriptions, subpass_descriptions, subpass_dependencies};
 
@@ -229,55 +285,97 @@ void Pass::CreateRenderPass() {
 void Pass::CreateFramebuffers() {
   images_.clear();
   image_views_.clear();
+  swapchain_image_views_.clear();
   framebuffers_.clear();
 
   images_.resize(frame_count_);
   image_views_.resize(frame_count_);
+  framebuffers_.resize(frame_count_);
+
+  // Swapchain images are not tied to frames in flight, their views are shared
+  // by every frame and picked by the acquired image index.
+  u32 swapchain_attachment{UINT32_MAX};
+  const std::vector<ast::Attachment>& ast_attachments{ast_pass_->attachments};
+  for (u32 i{}; i < ast_attachments.size(); ++i) {
+    if (ast_attachments[i].name == "swapchain") {
+      swapchain_attachment = i;
+      break;
+    }
+  }
+  if (swapchain_attachment != UINT32_MAX) {
+    for (vk::Image swapchain_image : *swapchain_images_) {
+      vk::ImageViewCreateInfo image_view_ci{
+          {},
+          swapchain_image,
+          vk::ImageViewType::e2D,
+          (*swapchain_info_).color_format,
+          {},
+          {vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1}};
+      swapchain_image_views_.push_back(
+          gpu_->CreateImageView(image_view_ci, "swapchain"));
+    }
+  }
 
   for (u32 i{}; i < frame_count_; ++i) {
     std::vector<vk::ImageView> framebuffer_image_views;
+    std::unordered_map<u64, u32> transient_counts;
 
-    const std::vector<ast::Attachment>& ast_attachments{ast_pass_->attachments};
     for (const auto& ast_attachment : ast_attachments) {
       bool is_swapchain{ast_attachment.name == "swapchain"};
+      if (is_swapchain) {
+        framebuffer_image_views.emplace_back(nullptr);
+        images_[i].emplace_back();
+        image_views_[i].emplace_back(nullptr);
+        continue;
+      }
+
       gpu::Image image;
       vk::ImageAspectFlags aspect;
       vk::Format format{};
-      if (is_swapchain) {
-        image = gpu::Image{(*swapchain_images_)[i]};
+      vk::ImageUsageFlags usage{vk::ImageUsageFlagBits::eInputAttachment};
+      if (ast_attachment.format != vk::Format::eD32Sfloat) {
+        usage |= vk::ImageUsageFlagBits::eColorAttachment;
         aspect = vk::ImageAspectFlagBits::eColor;
-        format = (*swapchain_info_).color_format;
       } else {
-        vk::ImageUsageFlags usage{vk::ImageUsageFlagBits::eInputAttachment};
-        if (ast_attachment.format != vk::Format::eD32Sfloat) {
-          usage |= vk::ImageUsageFlagBits::eColorAttachment;
-          aspect = vk::ImageAspectFlagBits::eColor;
-        } else {
-          usage |= vk::ImageUsageFlagBits::eDepthStencilAttachment;
-          aspect = vk::ImageAspectFlagBits::eDepth;
-        }
-        if (ast_attachment.output) {
-          usage |= vk::ImageUsageFlagBits::eSampled |
-                   vk::ImageUsageFlagBits::eStorage;
-        }
-        format = ast_attachment.format;
-        vk::ImageCreateInfo image_ci{{},
-                                     vk::ImageType::e2D,
-                                     format,
-                                     {(*swapchain_info_).extent.width,
-                                      (*swapchain_info_).extent.height, 1},
-                                     1,
-                                     1,
-                                     vk::SampleCountFlagBits::e1,
-                                     vk::ImageTiling::eOptimal,
-                                     usage};
+        usage |= vk::ImageUsageFlagBits::eDepthStencilAttachment;
+        aspect = vk::ImageAspectFlagBits::eDepth;
+      }
+      if (ast_attachment.output) {
+        usage |= vk::ImageUsageFlagBits::eSampled |
+                 vk::ImageUsageFlagBits::eStorage;
+      }
+      format = ast_attachment.format;
+      vk::ImageCreateInfo image_ci{{},
+                                   vk::ImageType::e2D,
+                                   format,
+                                   {(*swapchain_info_).extent.width,
+                                    (*swapchain_info_).extent.height, 1},
+                                   1,
+                                   1,
+                                   vk::SampleCountFlagBits::e1,
+                                   vk::ImageTiling::eOptimal,
+                                   usage};
+      vk::Image attachment_image{nullptr};
+      if (ast_attachment.output) {
+        SetImageSharingMode(ast_attachment, image_ci);
         image = gpu_->CreateImage(image_ci, vk::ImageLayout::eUndefined,
                                   nullptr, ast_attachment.name);
+        attachment_image = *image;
+      } else {
+        // Never stored nor sampled, the contents only live on chip between
+        // subpasses.
+        image_ci.usage |= vk::ImageUsageFlagBits::eTransientAttachment;
+        attachment_image = RequestTransientImage(image_ci, transient_counts,
+                                                 ast_attachment.name);
       }
 
       // Image view.
-      vk::ImageViewCreateInfo image_view_ci{
-          {}, *image, vk::ImageViewType::e2D, format, {}, {aspect, 0, 1, 0, 1}};
+      vk::ImageViewCreateInfo image_view_ci{{},
+                                            attachment_image,
+                                            vk::ImageViewType::e2D,
+                                            format,
+                                            {},
+                                            {aspect, 0, 1, 0, 1}};
       vk::raii::ImageView image_view{
           gpu_->CreateImageView(image_view_ci, ast_attachment.name)};
 
@@ -302,17 +400,27 @@ void Pass::CreateFramebuffers() {
       }
     }
 
-    vk::FramebufferCreateInfo framebuffer_ci{{},
-                                             *render_pass_,
-                                             framebuffer_image_views,
-                                             (*swapchain_info_).extent.width,
-                                             (*swapchain_info_).extent.height,
-                                             1};
+    u32 framebuffer_count{
+        swapchain_attachment != UINT32_MAX
+            ? static_cast<u32>(swapchain_image_views_.size())
+            : 1};
+    for (u32 j{}; j < framebuffer_count; ++j) {
+      if (swapchain_attachment != UINT32_MAX) {
+        framebuffer_image_views[swapchain_attachment] =
+            *(swapchain_image_views_[j]);
+      }
 
-    vk::raii::Framebuffer framebuffer{
-        gpu_->CreateFramebuffer(framebuffer_ci, name_)};
+      vk::FramebufferCreateInfo framebuffer_ci{
+          {},
+          *render_pass_,
+          framebuffer_image_views,
+          (*swapchain_info_).extent.width,
+          (*swapchain_info_).extent.height,
+          1};
 
-    framebuffers_.push_back(std::move(framebuffer));
+      framebuffers_[i].push_back(
+          gpu_->CreateFramebuffer(framebuffer_ci, name_));
+    }
   }
 }
 
@@ -334,10 +442,12 @@ void Pass::CreateClearValues() {
 void Pass::CreateSubpasses() {
   const std::vector<ast::Subpass>& ast_subpasses{ast_pass_->subpasses};
   for (u32 i{}; i < ast_subpasses.size(); ++i) {
-    subpasses_.emplace_back(gpu_, asset_, camera_, frame_count_, *render_pass_,
-                            image_views_, color_attachment_counts_[i],
-                            ast_subpasses, i, *scene_primitives_,
-                            *shared_images_, *shared_image_views_);
+    subpasses_.emplace_back(task_scheduler_, gpu_, resource_cache_, config_,
+                            asset_, camera_, frame_count_, *render_pass_,
+                            image_views_,
+                            color_attachment_counts_[i], ast_subpasses, i,
+                            *scene_primitives_, *shared_images_,
+                            *shared_image_views_);
   }
 }
 
@@ -365,6 +475,7 @@ void Pass::CreateResources() {
                                    vk::SampleCountFlagBits::e1,
                                    vk::ImageTiling::eOptimal,
                                    usage};
+      SetImageSharingMode(ast_attachment, image_ci);
       gpu::Image image{
           gpu_->CreateImage(image_ci, vk::ImageLayout::eShaderReadOnlyOptimal,
                             transfer_command_buffer_, ast_attachment.name)};
@@ -397,9 +508,41 @@ void Pass::CreateResources() {
   }
 }
 
+vk::Image Pass::RequestTransientImage(
+    const vk::ImageCreateInfo& image_ci,
+    std::unordered_map<u64, u32>& transient_counts, const std::string& name) {
+  // Transient attachments only live inside one render pass instance and the
+  // render passes are ordered by their external dependency, so every frame
+  // and every pass can alias the same images.
+  u64 hash_value{0};
+  HashCombine(hash_value, image_ci.format);
+  HashCombine(hash_value, static_cast<VkImageUsageFlags>(image_ci.usage));
+
+  u32 index{transient_counts[hash_value]++};
+  std::vector<gpu::Image>& transient_images{(*transient_images_)[hash_value]};
+  if (index >= transient_images.size()) {
+    transient_images.push_back(gpu_->CreateImage(
+        image_ci, vk::ImageLayout::eUndefined, nullptr, name));
+  }
+
+  return *(transient_images[index]);
+}
+
+void Pass::SetImageSharingMode(const ast::Attachment& ast_attachment,
+                               vk::ImageCreateInfo& image_ci) const {
+  // Outputs may be consumed on another queue family, sharing them avoids
+  // ownership transfers between graphics and async compute.
+  const std::vector<u32>& queue_indices{gpu_->GetConcurrentQueueIndices()};
+  if (ast_attachment.output && !queue_indices.empty()) {
+    image_ci.setSharingMode(vk::SharingMode::eConcurrent);
+    image_ci.setQueueFamilyIndices(queue_indices);
+  }
+}
+
 void Pass::CreateComputeJob() {
   const ast::ComputeJob& ast_compute_job{ast_pass_->compute_job};
   compute_job_ = ComputeJob{gpu_,
+                            resource_cache_,
                             asset_,
                             frame_count_,
                             image_views_,
@@ -8,17 +8,22 @@
 // clang-format on
 
 #include "base/gpu/gpu.h"
+#include "base/task_scheduler/task_scheduler.h"
 #include "function/camera/camera.h"
 #include "function/function_ui/function_ui.h"
 #include "rendering/framework/compute_job.h"
+#include "rendering/framework/resource_cache.h"
 #include "rendering/framework/subpass.h"
 #include "resource/asset/asset.h"
+#include "resource/config/config.h"
 
 namespace luka::fw {
 
 class Pass {
  public:
-  Pass(std::shared_ptr<Gpu> gpu, std::shared_ptr<Asset> asset,
+  Pass(std::shared_ptr<TaskScheduler> task_scheduler,
+       std::shared_ptr<Gpu> gpu, std::shared_ptr<ResourceCache> resource_cache,
+       std::shared_ptr<Config> config, std::shared_ptr<Asset> asset,
        std::shared_ptr<Camera> camera, std::shared_ptr<FunctionUi> function_ui,
        u32 frame_count, const SwapchainInfo& swapchain_info,
        const std::vector<vk::Image>& swapchain_images,
@@ -26,7 +31,8 @@ class Pass {
        const std::vector<ScenePrimitive>& scene_primitives,
        std::vector<std::unordered_map<std::string, vk::Image>>& shared_images,
        std::vector<std::unordered_map<std::string, vk::ImageView>>&
-           shared_image_views);
+           shared_image_views,
+       std::unordered_map<u64, std::vector<gpu::Image>>& transient_images);
 
   void Resize(const SwapchainInfo& swapchain_info,
               const std::vector<vk::Image>& swapchain_images);
@@ -34,7 +40,11 @@ class Pass {
   const std::string& GetName() const;
   ast::PassType GetType() const;
   bool HasUi() const;
-  vk::RenderPassBeginInfo GetRenderPassBeginInfo(u32 frame_index) const;
+  bool HasSwapchain() const;
+  std::unordered_set<std::string> GetInputImageNames() const;
+  const std::vector<std::string>& GetOutputImageNames() const;
+  vk::RenderPassBeginInfo GetRenderPassBeginInfo(
+      u32 frame_index, u32 swapchain_image_index) const;
   const std::vector<Subpass>& GetSubpasses() const;
   std::vector<Subpass>& GetSubpasses();
 
@@ -51,7 +61,16 @@ class Pass {
   void CreateResources();
   void CreateComputeJob();
 
+  vk::Image RequestTransientImage(
+      const vk::ImageCreateInfo& image_ci,
+      std::unordered_map<u64, u32>& transient_counts, const std::string& name);
+  void SetImageSharingMode(const ast::Attachment& ast_attachment,
+                           vk::ImageCreateInfo& image_ci) const;
+
+  std::shared_ptr<TaskScheduler> task_scheduler_;
   std::shared_ptr<Gpu> gpu_;
+  std::shared_ptr<ResourceCache> resource_cache_;
+  std::shared_ptr<Config> config_;
   std::shared_ptr<Asset> asset_;
   std::shared_ptr<Camera> camera_;
   std::shared_ptr<FunctionUi> function_ui_;
@@ -65,18 +84,22 @@ class Pass {
   std::vector<std::unordered_map<std::string, vk::Image>>* shared_images_;
   std::vector<std::unordered_map<std::string, vk::ImageView>>*
       shared_image_views_;
+  std::unordered_map<u64, std::vector<gpu::Image>>* transient_images_;
 
   const ast::Pass* ast_pass_{};
   std::string name_;
   ast::PassType type_;
   bool has_ui_{};
+  bool has_swapchain_{};
+  std::vector<std::string> output_image_names_;
 
   std::vector<u32> color_attachment_counts_;
   vk::raii::RenderPass render_pass_{nullptr};
 
   std::vector<std::vector<gpu::Image>> images_;
   std::vector<std::vector<vk::raii::ImageView>> image_views_;
-  std::vector<vk::raii::Framebuffer> framebuffers_;
+  std::vector<vk::raii::ImageView> swapchain_image_views_;
+  std::vector<std::vector<vk::raii::Framebuffer>> framebuffers_;
 
   vk::Rect2D render_area_;
 
@@ -0,0 +1,215 @@
+// SPDX license identifier: MIT.
+// Copyright (C) 2023-present Liam Hauw.
+
+// clang-format off
+#include "platform/pch.h"
+// clang-format on
+
+#include "rendering/framework/render_queue.h"
+
+#include "core/util.h"
+
+namespace luka::fw {
+
+constexpr u32 kSortKeySpareBits{64 - kSortKeyPassBits - kSortKeySubpassBits -
+                                kSortKeyPipelineBits - kSortKeyMaterialBits -
+                                kSortKeyDepthBits};
+
+RenderQueue::RenderQueue(std::shared_ptr<TaskScheduler> task_scheduler,
+                         u32 pass_index, u32 subpass_index, bool back_to_front)
+    : task_scheduler_{std::move(task_scheduler)},
+      back_to_front_{back_to_front} {
+  u64 pass{std::min<u64>(pass_index, (1ULL << kSortKeyPassBits) - 1)};
+  u64 subpass{std::min<u64>(subpass_index, (1ULL << kSortKeySubpassBits) - 1)};
+  pass_key_ = (pass << (64 - kSortKeyPassBits)) |
+              (subpass << (64 - kSortKeyPassBits - kSortKeySubpassBits));
+}
+
+void RenderQueue::Build(const std::vector<DrawElement>& draw_elements,
+                        const glm::mat4& view, f32 near_plane, f32 far_plane,
+                        const std::unordered_map<u32, bool>& show_scenes) {
+  sorted_ = false;
+  visibility_hash_value_ = 0;
+  keys_.clear();
+  draw_element_indices_.clear();
+
+  for (u32 i{}; i < draw_elements.size(); ++i) {
+    const DrawElement& draw_element{draw_elements[i]};
+
+    if (draw_element.has_scene) {
+      auto it{show_scenes.find(draw_element.scene_index)};
+      if (it != show_scenes.end() && !it->second) {
+        continue;
+      }
+    }
+
+    u64 pipeline{std::min<u64>(draw_element.pipeline_id,
+                               (1ULL << kSortKeyPipelineBits) - 1)};
+    u64 material{std::min<u64>(draw_element.material_id,
+                               (1ULL << kSortKeyMaterialBits) - 1)};
+    u64 depth{
+        QuantizeDepth(draw_element.center, view, near_plane, far_plane)};
+
+    u64 key{pass_key_};
+    if (back_to_front_) {
+      u64 inverse_depth{((1ULL << kSortKeyDepthBits) - 1) - depth};
+      key |= inverse_depth << (kSortKeyPipelineBits + kSortKeyMaterialBits +
+                               kSortKeySpareBits);
+      key |= pipeline << (kSortKeyMaterialBits + kSortKeySpareBits);
+      key |= material << kSortKeySpareBits;
+    } else {
+      key |= pipeline << (kSortKeyMaterialBits + kSortKeyDepthBits +
+                          kSortKeySpareBits);
+      key |= material << (kSortKeyDepthBits + kSortKeySpareBits);
+      key |= depth << kSortKeySpareBits;
+    }
+
+    keys_.push_back(key);
+    draw_element_indices_.push_back(i);
+    HashCombine(visibility_hash_value_, i);
+  }
+}
+
+void RenderQueue::Sort() {
+  if (sorted_) {
+    return;
+  }
+  sorted_ = true;
+
+  RadixSort();
+
+  order_hash_value_ = 0;
+  for (u32 draw_element_index : draw_element_indices_) {
+    HashCombine(order_hash_value_, draw_element_index);
+  }
+}
+
+bool RenderQueue::IsBackToFront() const { return back_to_front_; }
+
+const std::vector<u32>& RenderQueue::GetDrawElementIndices() const {
+  return draw_element_indices_;
+}
+
+u64 RenderQueue::GetVisibilityHashValue() const {
+  return visibility_hash_value_;
+}
+
+u64 RenderQueue::GetOrderHashValue() const { return order_hash_value_; }
+
+void RenderQueue::RadixSort() {
+  u32 count{static_cast<u32>(keys_.size())};
+  if (count < 2) {
+    return;
+  }
+
+  chunk_count_ =
+      count < kParallelSortMinCount ? 1 : task_scheduler_->GetThreadCount();
+  chunk_size_ = (count + chunk_count_ - 1) / chunk_count_;
+  histograms_.resize(chunk_count_);
+  scratch_keys_.resize(count);
+  scratch_draw_element_indices_.resize(count);
+
+  // Least significant digit first, every pass is stable so equal keys keep
+  // the order of the draw elements.
+  for (shift_ = 0; shift_ < 64; shift_ += kRadixBits) {
+    if (chunk_count_ == 1) {
+      CountDigits(0);
+    } else {
+      RadixSortTaskSet count_task_set{this, chunk_count_, false};
+      task_scheduler_->AddTaskSetToPipe(&count_task_set);
+      task_scheduler_->WaitforTask(&count_task_set);
+    }
+
+    // Turn histograms into scatter offsets, a digit shared by all keys means
+    // nothing to reorder.
+    bool skip{};
+    u32 offset{};
+    for (u32 digit{}; digit < kRadixBucketCount; ++digit) {
+      u32 digit_count{};
+      for (u32 chunk{}; chunk < chunk_count_; ++chunk) {
+        digit_count += histograms_[chunk][digit];
+      }
+      if (digit_count == count) {
+        skip = true;
+        break;
+      }
+
+      for (u32 chunk{}; chunk < chunk_count_; ++chunk) {
+        u32 chunk_digit_count{histograms_[chunk][digit]};
+        histograms_[chunk][digit] = offset;
+        offset += chunk_digit_count;
+      }
+    }
+    if (skip) {
+      continue;
+    }
+
+    if (chunk_count_ == 1) {
+      ScatterDigits(0);
+    } else {
+      RadixSortTaskSet scatter_task_set{this, chunk_count_, true};
+      task_scheduler_->AddTaskSetToPipe(&scatter_task_set);
+      task_scheduler_->WaitforTask(&scatter_task_set);
+    }
+
+    std::swap(keys_, scratch_keys_);
+    std::swap(draw_element_indices_, scratch_draw_element_indices_);
+  }
+}
+
+void RenderQueue::CountDigits(u32 chunk) {
+  std::array<u32, kRadixBucketCount>& histogram{histograms_[chunk]};
+  histogram.fill(0);
+
+  u32 count{static_cast<u32>(keys_.size())};
+  u32 begin{std::min(chunk * chunk_size_, count)};
+  u32 end{std::min(begin + chunk_size_, count)};
+  for (u32 i{begin}; i < end; ++i) {
+    ++histogram[(keys_[i] >> shift_) & (kRadixBucketCount - 1)];
+  }
+}
+
+void RenderQueue::ScatterDigits(u32 chunk) {
+  std::array<u32, kRadixBucketCount>& offsets{histograms_[chunk]};
+
+  u32 count{static_cast<u32>(keys_.size())};
+  u32 begin{std::min(chunk * chunk_size_, count)};
+  u32 end{std::min(begin + chunk_size_, count)};
+  for (u32 i{begin}; i < end; ++i) {
+    u32 dst{offsets[(keys_[i] >> shift_) & (kRadixBucketCount - 1)]++};
+    scratch_keys_[dst] = keys_[i];
+    scratch_draw_element_indices_[dst] = draw_element_indices_[i];
+  }
+}
+
+u64 RenderQueue::QuantizeDepth(const glm::vec3& center, const glm::mat4& view,
+                               f32 near_plane, f32 far_plane) const {
+  glm::vec4 view_position{view * glm::vec4{center, 1.0F}};
+  f32 distance{std::clamp(-view_position.z, near_plane, far_plane)};
+
+  // Logarithmic distribution keeps precision close to the camera.
+  f32 normalized{std::log(distance / near_plane) /
+                 std::log(far_plane / near_plane)};
+
+  return static_cast<u64>(
+      normalized * static_cast<f32>((1ULL << kSortKeyDepthBits) - 1));
+}
+
+RadixSortTaskSet::RadixSortTaskSet(RenderQueue* render_queue, u32 chunk_count,
+                                   bool scatter)
+    : render_queue_{render_queue}, scatter_{scatter} {
+  m_SetSize = chunk_count;
+}
+
+void RadixSortTaskSet::ExecuteRange(enki::TaskSetPartition range,
+                                    uint32_t thread_num) {
+  for (u32 i{range.start}; i < range.end; ++i) {
+    if (scatter_) {
+      render_queue_->ScatterDigits(i);
+    } else {
+      render_queue_->CountDigits(i);
+    }
+  }
+}
+
+}  // namespace luka::fw
@@ -0,0 +1,90 @@
+// SPDX license identifier: MIT.
+// Copyright (C) 2023-present Liam Hauw.
+
+#pragma once
+
+// clang-format off
+#include "platform/pch.h"
+// clang-format on
+
+#include "base/task_scheduler/task_scheduler.h"
+#include "core/math.h"
+#include "rendering/framework/subpass.h"
+
+namespace luka::fw {
+
+/**
+ * Layout of a sort key, from the most significant bit:
+ *
+ * opaque:      pass | subpass | pipeline | material | depth (front-to-back)
+ * transparent: pass | subpass | depth (back-to-front) | pipeline | material
+ *
+ * The lowest bits are left unused, the radix sort skips them for free.
+ */
+constexpr u32 kSortKeyPassBits{4};
+constexpr u32 kSortKeySubpassBits{4};
+constexpr u32 kSortKeyPipelineBits{12};
+constexpr u32 kSortKeyMaterialBits{16};
+constexpr u32 kSortKeyDepthBits{24};
+
+constexpr u32 kRadixBits{8};
+constexpr u32 kRadixBucketCount{1 << kRadixBits};
+constexpr u32 kParallelSortMinCount{1024};
+
+class RenderQueue {
+ public:
+  RenderQueue(std::shared_ptr<TaskScheduler> task_scheduler, u32 pass_index,
+              u32 subpass_index, bool back_to_front);
+
+  void Build(const std::vector<DrawElement>& draw_elements,
+             const glm::mat4& view, f32 near_plane, f32 far_plane,
+             const std::unordered_map<u32, bool>& show_scenes);
+
+  void Sort();
+
+  bool IsBackToFront() const;
+  const std::vector<u32>& GetDrawElementIndices() const;
+  u64 GetVisibilityHashValue() const;
+  u64 GetOrderHashValue() const;
+
+  void CountDigits(u32 chunk);
+  void ScatterDigits(u32 chunk);
+
+ private:
+  void RadixSort();
+
+  u64 QuantizeDepth(const glm::vec3& center, const glm::mat4& view,
+                    f32 near_plane, f32 far_plane) const;
+
+  std::shared_ptr<TaskScheduler> task_scheduler_;
+
+  u64 pass_key_{};
+  bool back_to_front_{};
+
+  bool sorted_{};
+  u64 visibility_hash_value_{};
+  u64 order_hash_value_{};
+
+  std::vector<u64> keys_;
+  std::vector<u32> draw_element_indices_;
+  std::vector<u64> scratch_keys_;
+  std::vector<u32> scratch_draw_element_indices_;
+
+  u32 chunk_count_{};
+  u32 chunk_size_{};
+  u32 shift_{};
+  std::vector<std::array<u32, kRadixBucketCount>> histograms_;
+};
+
+class RadixSortTaskSet : public enki::ITaskSet {
+ public:
+  RadixSortTaskSet(RenderQueue* render_queue, u32 chunk_count, bool scatter);
+
+  void ExecuteRange(enki::TaskSetPartition range, uint32_t thread_num) override;
+
+ private:
+  RenderQueue* render_queue_{};
+  bool scatter_{};
+};
+
+}  // namespace luka::fw
@@ -0,0 +1,159 @@
+// SPDX license identifier: MIT.
+// Copyright (C) 2023-present Liam Hauw.
+
+// clang-format off
+#include "platform/pch.h"
+// clang-format on
+
+#include "rendering/framework/resource_cache.h"
+
+#include <vulkan/vulkan_hash.hpp>
+
+#include "resource/config/generated/root_path.h"
+
+namespace luka::fw {
+
+ResourceCache::ResourceCache(std::shared_ptr<Gpu> gpu)
+    : gpu_{std::move(gpu)},
+      cache_path_{CreateCachePath()},
+      spirv_archive_{cache_path_ / "spirv.archive"} {}
+
+const SPIRV& ResourceCache::RequestSpirv(
+    const ast::Shader& shader, const std::vector<std::string>& processes,
+    vk::ShaderStageFlagBits shader_stage) {
+  u64 hash_value{shader.GetHashValue(processes)};
+
+  return spirv_shaders_.Request(hash_value, [&]() {
+    u64 source_hash_value{shader.GetSourceHashValue()};
+    bool strip_debug_info{shader.GetOptimization() !=
+                          ShaderOptimization::kNone};
+
+    // Archived variants are already stripped and reflected.
+    SpirvArchiveItem archived_spirv{
+        spirv_archive_.Find(hash_value, source_hash_value)};
+    if (!archived_spirv.spirv.empty()) {
+      return SPIRV{archived_spirv.spirv, archived_spirv.reflection,
+                   shader_stage, hash_value};
+    }
+
+    SPIRV spirv{shader.CompileToSpirv(processes), shader_stage, hash_value,
+                strip_debug_info};
+    spirv_archive_.Append(hash_value, source_hash_value, spirv.GetSpirv(),
+                          spirv.SerializeReflection());
+
+    return spirv;
+  });
+}
+
+const vk::raii::DescriptorSetLayout& ResourceCache::RequestDescriptorSetLayout(
+    const vk::DescriptorSetLayoutCreateInfo& descriptor_set_layout_ci,
+    const std::string& name, i32 index) {
+  u64 hash_value{};
+  HashCombine(hash_value, descriptor_set_layout_ci.flags);
+  for (u32 i{}; i < descriptor_set_layout_ci.bindingCount; ++i) {
+    HashCombine(hash_value, descriptor_set_layout_ci.pBindings[i]);
+  }
+
+  return descriptor_set_layouts_.Request(hash_value, [&]() {
+    return gpu_->CreateDescriptorSetLayout(descriptor_set_layout_ci, name,
+                                           index);
+  });
+}
+
+const vk::raii::DescriptorUpdateTemplate&
+ResourceCache::RequestDescriptorUpdateTemplate(
+    const vk::DescriptorUpdateTemplateCreateInfo& descriptor_update_template_ci,
+    const std::string& name, i32 index) {
+  u64 hash_value{};
+  HashCombine(hash_value, descriptor_update_template_ci.templateType);
+  HashCombine(hash_value, descriptor_update_template_ci.descriptorSetLayout);
+  for (u32 i{}; i < descriptor_update_template_ci.descriptorUpdateEntryCount;
+       ++i) {
+    HashCombine(hash_value,
+                descriptor_update_template_ci.pDescriptorUpdateEntries[i]);
+  }
+
+  return descriptor_update_templates_.Request(hash_value, [&]() {
+    return gpu_->CreateDescriptorUpdateTemplate(descriptor_update_template_ci,
+                                                name, index);
+  });
+}
+
+const vk::raii::PipelineLayout& ResourceCache::RequestPipelineLayout(
+    const vk::PipelineLayoutCreateInfo& pipeline_layout_ci,
+    const std::string& name, i32 index) {
+  u64 hash_value{};
+  HashCombine(hash_value, pipeline_layout_ci.flags);
+  for (u32 i{}; i < pipeline_layout_ci.setLayoutCount; ++i) {
+    HashCombine(hash_value, pipeline_layout_ci.pSetLayouts[i]);
+  }
+  for (u32 i{}; i < pipeline_layout_ci.pushConstantRangeCount; ++i) {
+    HashCombine(hash_value, pipeline_layout_ci.pPushConstantRanges[i]);
+  }
+
+  return pipeline_layouts_.Request(hash_value, [&]() {
+    return gpu_->CreatePipelineLayout(pipeline_layout_ci, name, index);
+  });
+}
+
+const vk::raii::ShaderModule& ResourceCache::RequestShaderModule(
+    const vk::ShaderModuleCreateInfo& shader_module_ci, u64 hash_value,
+    const std::string& name, i32 index) {
+  return shader_modules_.Request(hash_value, [&]() {
+    return gpu_->CreateShaderModule(shader_module_ci, name, index);
+  });
+}
+
+const vk::raii::Pipeline& ResourceCache::RequestPipeline(
+    const vk::GraphicsPipelineCreateInfo& graphics_pipeline_ci, u64 hash_value,
+    const vk::raii::PipelineCache& pipeline_cache, const std::string& name,
+    i32 index) {
+  return pipelines_.Request(hash_value, [&]() {
+    return gpu_->CreatePipeline(graphics_pipeline_ci, pipeline_cache, name,
+                                index);
+  });
+}
+
+const vk::raii::Pipeline& ResourceCache::RequestPipeline(
+    const vk::ComputePipelineCreateInfo& compute_pipeline_ci, u64 hash_value,
+    const std::string& name, i32 index) {
+  return pipelines_.Request(hash_value, [&]() {
+    return gpu_->CreatePipeline(compute_pipeline_ci, gpu_->GetPipelineCache(),
+                                name, index);
+  });
+}
+
+bool ResourceCache::HasSpirv(u64 hash_value) const {
+  return spirv_shaders_.Contains(hash_value);
+}
+
+bool ResourceCache::HasPipeline(u64 hash_value) const {
+  return pipelines_.Contains(hash_value);
+}
+
+const vk::raii::Pipeline& ResourceCache::GetPipeline(u64 hash_value) const {
+  return pipelines_.Get(hash_value);
+}
+
+vk::raii::Pipeline ResourceCache::TakePipeline(u64 hash_value) {
+  std::optional<vk::raii::Pipeline> pipeline{pipelines_.Take(hash_value)};
+  return pipeline ? std::move(*pipeline) : vk::raii::Pipeline{nullptr};
+}
+
+std::filesystem::path ResourceCache::CreateCachePath() {
+  std::filesystem::path cache_path{GetPath(LUKA_ROOT_PATH) / ".cache" /
+                                   "engine"};
+  if (!std::filesystem::exists(cache_path)) {
+    std::filesystem::create_directories(cache_path);
+  }
+  return cache_path;
+}
+
+ResourceCacheCounters ResourceCache::GetCounters() const {
+  return ResourceCacheCounters{
+      spirv_shaders_.GetCounter(), descriptor_set_layouts_.GetCounter(),
+      descriptor_update_templates_.GetCounter(), pipeline_layouts_.GetCounter(),
+      shader_modules_.GetCounter(), pipelines_.GetCounter()};
+}
+
+}  // namespace luka::fw
@@ -0,0 +1,185 @@
+// SPDX license identifier: MIT.
+// Copyright (C) 2023-present Liam Hauw.
+
+#pragma once
+
+// clang-format off
+#include "platform/pch.h"
+// clang-format on
+
+#include <atomic>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+
+#include "base/gpu/gpu.h"
+#include "core/log.h"
+#include "core/util.h"
+#include "rendering/framework/spirv.h"
+#include "rendering/framework/spirv_archive.h"
+#include "resource/asset/asset.h"
+
+namespace luka::fw {
+
+constexpr u32 kResourceCacheShardCount{16};
+
+struct ResourceCacheCounter {
+  u64 hit_count;
+  u64 miss_count;
+  u64 creation_time;  // In nanoseconds.
+};
+
+struct ResourceCacheCounters {
+  ResourceCacheCounter spirv;
+  ResourceCacheCounter descriptor_set_layout;
+  ResourceCacheCounter descriptor_update_template;
+  ResourceCacheCounter pipeline_layout;
+  ResourceCacheCounter shader_module;
+  ResourceCacheCounter pipeline;
+};
+
+/**
+ * Resources keyed by hash value and spread over shards, so threads requesting
+ * different resources rarely wait for each other. A missing resource is
+ * created outside the lock, if two threads race for it the first one stored
+ * is kept.
+ */
+template <typename T>
+class ShardedCache {
+ public:
+  template <typename F>
+  const T& Request(u64 hash_value, F&& create) {
+    Shard& shard{shards_[hash_value % kResourceCacheShardCount]};
+    {
+      std::shared_lock<std::shared_mutex> lock{shard.mutex};
+      auto it{shard.resources.find(hash_value)};
+      if (it != shard.resources.end()) {
+        hit_count_.fetch_add(1, std::memory_order_relaxed);
+        return it->second;
+      }
+    }
+
+    auto begin{std::chrono::steady_clock::now()};
+    T resource{create()};
+    auto duration{std::chrono::steady_clock::now() - begin};
+    miss_count_.fetch_add(1, std::memory_order_relaxed);
+    creation_time_.fetch_add(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count(),
+        std::memory_order_relaxed);
+
+    std::unique_lock<std::shared_mutex> lock{shard.mutex};
+    return shard.resources.emplace(hash_value, std::move(resource))
+        .first->second;
+  }
+
+  bool Contains(u64 hash_value) const {
+    const Shard& shard{shards_[hash_value % kResourceCacheShardCount]};
+    std::shared_lock<std::shared_mutex> lock{shard.mutex};
+    return shard.resources.contains(hash_value);
+  }
+
+  const T& Get(u64 hash_value) const {
+    const Shard& shard{shards_[hash_value % kResourceCacheShardCount]};
+    std::shared_lock<std::shared_mutex> lock{shard.mutex};
+    auto it{shard.resources.find(hash_value)};
+    if (it == shard.resources.end()) {
+      THROW("There is no resource {}", hash_value);
+    }
+    return it->second;
+  }
+
+  // Removes a resource, references to other resources stay valid.
+  std::optional<T> Take(u64 hash_value) {
+    Shard& shard{shards_[hash_value % kResourceCacheShardCount]};
+    std::unique_lock<std::shared_mutex> lock{shard.mutex};
+    auto it{shard.resources.find(hash_value)};
+    if (it == shard.resources.end()) {
+      return std::nullopt;
+    }
+    std::optional<T> resource{std::move(it->second)};
+    shard.resources.erase(it);
+    return resource;
+  }
+
+  ResourceCacheCounter GetCounter() const {
+    return ResourceCacheCounter{
+        hit_count_.load(std::memory_order_relaxed),
+        miss_count_.load(std::memory_order_relaxed),
+        creation_time_.load(std::memory_order_relaxed)};
+  }
+
+ private:
+  struct Shard {
+    mutable std::shared_mutex mutex;
+    std::unordered_map<u64, T> resources;
+  };
+
+  std::array<Shard, kResourceCacheShardCount> shards_;
+  std::atomic<u64> hit_count_{};
+  std::atomic<u64> miss_count_{};
+  std::atomic<u64> creation_time_{};
+};
+
+class ResourceCache {
+ public:
+  DELETE_SPECIAL_MEMBER_FUNCTIONS(ResourceCache)
+
+  explicit ResourceCache(std::shared_ptr<Gpu> gpu);
+
+  ~ResourceCache() = default;
+
+  const SPIRV& RequestSpirv(const ast::Shader& shader,
+                            const std::vector<std::string>& processes,
+                            vk::ShaderStageFlagBits shader_stage);
+
+  const vk::raii::DescriptorSetLayout& RequestDescriptorSetLayout(
+      const vk::DescriptorSetLayoutCreateInfo& descriptor_set_layout_ci,
+      const std::string& name = {}, i32 index = -1);
+
+  const vk::raii::DescriptorUpdateTemplate& RequestDescriptorUpdateTemplate(
+      const vk::DescriptorUpdateTemplateCreateInfo&
+          descriptor_update_template_ci,
+      const std::string& name = {}, i32 index = -1);
+
+  const vk::raii::PipelineLayout& RequestPipelineLayout(
+      const vk::PipelineLayoutCreateInfo& pipeline_layout_ci,
+      const std::string& name = {}, i32 index = -1);
+
+  const vk::raii::ShaderModule& RequestShaderModule(
+      const vk::ShaderModuleCreateInfo& shader_module_ci, u64 hash_value,
+      const std::string& name = {}, i32 index = -1);
+
+  const vk::raii::Pipeline& RequestPipeline(
+      const vk::GraphicsPipelineCreateInfo& graphics_pipeline_ci,
+      u64 hash_value, const vk::raii::PipelineCache& pipeline_cache,
+      const std::string& name = {}, i32 index = -1);
+
+  const vk::raii::Pipeline& RequestPipeline(
+      const vk::ComputePipelineCreateInfo& compute_pipeline_ci, u64 hash_value,
+      const std::string& name = {}, i32 index = -1);
+
+  bool HasSpirv(u64 hash_value) const;
+  bool HasPipeline(u64 hash_value) const;
+  const vk::raii::Pipeline& GetPipeline(u64 hash_value) const;
+  vk::raii::Pipeline TakePipeline(u64 hash_value);
+
+  ResourceCacheCounters GetCounters() const;
+
+ private:
+  static std::filesystem::path CreateCachePath();
+
+  std::shared_ptr<Gpu> gpu_;
+
+  std::filesystem::path cache_path_;
+  SpirvArchive spirv_archive_;
+
+  ShardedCache<SPIRV> spirv_shaders_;
+  ShardedCache<vk::raii::DescriptorSetLayout> descriptor_set_layouts_;
+  ShardedCache<vk::raii::DescriptorUpdateTemplate>
+      descriptor_update_templates_;
+  ShardedCache<vk::raii::PipelineLayout> pipeline_layouts_;
+  ShardedCache<vk::raii::ShaderModule> shader_modules_;
+  ShardedCache<vk::raii::Pipeline> pipelines_;
+};
+
+}  // namespace luka::fw
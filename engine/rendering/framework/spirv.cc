@@ -7,8 +7,101 @@
 
 #include "rendering/framework/spirv.h"
 
+#include "core/log.h"
+
 namespace luka::fw {
 
+namespace {
+
+class ReflectionWriter {
+ public:
+  void Write(u32 value) { words_.push_back(value); }
+
+  void Write(u64 value) {
+    Write(static_cast<u32>(value));
+    Write(static_cast<u32>(value >> 32));
+  }
+
+  void Write(const std::string& value) {
+    Write(static_cast<u32>(value.size()));
+    u64 offset{words_.size()};
+    words_.resize(offset + (value.size() + sizeof(u32) - 1) / sizeof(u32));
+    memcpy(words_.data() + offset, value.data(), value.size());
+  }
+
+  std::vector<u32> GetWords() { return std::move(words_); }
+
+ private:
+  std::vector<u32> words_;
+};
+
+class ReflectionReader {
+ public:
+  explicit ReflectionReader(std::span<const u32> words) : words_{words} {}
+
+  u32 ReadU32() {
+    Require(1);
+    return words_[offset_++];
+  }
+
+  u64 ReadU64() {
+    u64 low{ReadU32()};
+    u64 high{ReadU32()};
+    return low | (high << 32);
+  }
+
+  std::string ReadString() {
+    u32 size{ReadU32()};
+    u64 word_count{(size + sizeof(u32) - 1) / sizeof(u32)};
+    Require(word_count);
+    std::string value(size, '\0');
+    memcpy(value.data(), words_.data() + offset_, size);
+    offset_ += word_count;
+    return value;
+  }
+
+ private:
+  void Require(u64 word_count) const {
+    if (offset_ + word_count > words_.size()) {
+      THROW("Spirv reflection is truncated");
+    }
+  }
+
+  std::span<const u32> words_;
+  u64 offset_{};
+};
+
+}  // namespace
+
+u64 HashShaderInterface(
+    const std::unordered_map<std::string, ShaderResource>&
+        name_shader_resources) {
+  std::vector<const ShaderResource*> shader_resources;
+  shader_resources.reserve(name_shader_resources.size());
+  for (const auto& name_shader_resource : name_shader_resources) {
+    shader_resources.push_back(&name_shader_resource.second);
+  }
+  std::sort(shader_resources.begin(), shader_resources.end(),
+            [](const ShaderResource* lhs, const ShaderResource* rhs) {
+              return lhs->name < rhs->name;
+            });
+
+  u64 hash_value{};
+  for (const auto* shader_resource : shader_resources) {
+    HashCombine(hash_value, shader_resource->name);
+    HashCombine(hash_value, static_cast<u32>(shader_resource->type));
+    HashCombine(hash_value, static_cast<u32>(shader_resource->stage));
+    HashCombine(hash_value, shader_resource->input_attachment_index);
+    HashCombine(hash_value, shader_resource->set);
+    HashCombine(hash_value, shader_resource->binding);
+    HashCombine(hash_value, shader_resource->array_size);
+    HashCombine(hash_value, shader_resource->size);
+    HashCombine(hash_value, shader_resource->offset);
+    HashCombine(hash_value, shader_resource->location);
+  }
+  return hash_value;
+}
+
 SPIRV::SPIRV(const ast::Shader& shader,
              const std::vector<std::string>& processes,
              vk::ShaderStageFlagBits stage, u64 hash_value)
@@ -21,11 +114,25 @@ SPIRV::SPIRV(const ast::Shader& shader,
 }
 
 SPIRV::SPIRV(const std::vector<u32>& spirv, vk::ShaderStageFlagBits stage,
-             u64 hash_value)
+             u64 hash_value, bool strip_debug_info)
     : spirv_{spirv}, stage_{stage}, hash_value_{hash_value} {
-  spirv_cross::CompilerGLSL compiler{spirv_};
-  ParseShaderResource(compiler);
-  ParseSpecialization(compiler);
+  {
+    spirv_cross::CompilerGLSL compiler{spirv_};
+    ParseShaderResource(compiler);
+    ParseSpecialization(compiler);
+  }
+
+  if (strip_debug_info) {
+    StripDebugInfo(spirv_);
+  }
+}
+
+SPIRV::SPIRV(std::span<const u32> spirv, std::span<const u32> reflection,
+             vk::ShaderStageFlagBits stage, u64 hash_value)
+    : spirv_{spirv.begin(), spirv.end()},
+      stage_{stage},
+      hash_value_{hash_value} {
+  DeserializeReflection(reflection);
 }
 
 vk::ShaderStageFlagBits SPIRV::GetStage() const { return stage_; }
@@ -43,6 +150,32 @@ const std::vector<SpecializationConstant>& SPIRV::GetSpecializationConstants()
   return specialization_constants_;
 }
 
+std::vector<u32> SPIRV::SerializeReflection() const {
+  ReflectionWriter writer;
+
+  writer.Write(static_cast<u32>(shader_resources_.size()));
+  for (const auto& shader_resource : shader_resources_) {
+    writer.Write(shader_resource.name);
+    writer.Write(static_cast<u32>(shader_resource.type));
+    writer.Write(static_cast<u32>(shader_resource.stage));
+    writer.Write(shader_resource.input_attachment_index);
+    writer.Write(shader_resource.set);
+    writer.Write(shader_resource.binding);
+    writer.Write(shader_resource.array_size);
+    writer.Write(shader_resource.size);
+    writer.Write(shader_resource.offset);
+    writer.Write(shader_resource.location);
+  }
+
+  writer.Write(static_cast<u32>(specialization_constants_.size()));
+  for (const auto& specialization_constant : specialization_constants_) {
+    writer.Write(specialization_constant.name);
+    writer.Write(specialization_constant.constant_id);
+  }
+
+  return writer.GetWords();
+}
+
 void SPIRV::ParseShaderResource(const spirv_cross::CompilerGLSL& compiler) {
   spirv_cross::ShaderResources resources{compiler.get_shader_resources()};
   // Samplers.
@@ -117,6 +250,21 @@ void SPIRV::ParseShaderResource(const spirv_cross::CompilerGLSL& compiler) {
     shader_resources_.push_back(std::move(shader_resource));
   }
 
+  // Storage buffers.
+  const auto& storage_buffers{resources.storage_buffers};
+  for (const auto& storage_buffer : storage_buffers) {
+    ShaderResource shader_resource{};
+    shader_resource.name = storage_buffer.name;
+    shader_resource.type = ShaderResourceType::kStorageBuffer;
+    shader_resource.stage = stage_;
+    shader_resource.set = ParseSet(compiler, storage_buffer);
+    shader_resource.binding = ParseBinding(compiler, storage_buffer);
+    shader_resource.array_size = ParseArraySize(compiler, storage_buffer);
+    shader_resource.size = ParseSize(compiler, storage_buffer);
+
+    shader_resources_.push_back(std::move(shader_resource));
+  }
+
   // Input attachments.
   const auto& input_attachments{resources.subpass_inputs};
   for (const auto& input_attachment : input_attachments) {
@@ -170,6 +318,38 @@ void SPIRV::ParseSpecialization(const spirv_cross::CompilerGLSL& compiler) {
   }
 }
 
+void SPIRV::DeserializeReflection(std::span<const u32> reflection) {
+  ReflectionReader reader{reflection};
+
+  u32 shader_resource_count{reader.ReadU32()};
+  shader_resources_.reserve(shader_resource_count);
+  for (u32 i{}; i < shader_resource_count; ++i) {
+    ShaderResource shader_resource{};
+    shader_resource.name = reader.ReadString();
+    shader_resource.type = static_cast<ShaderResourceType>(reader.ReadU32());
+    shader_resource.stage = vk::ShaderStageFlags{reader.ReadU32()};
+    shader_resource.input_attachment_index = reader.ReadU32();
+    shader_resource.set = reader.ReadU32();
+    shader_resource.binding = reader.ReadU32();
+    shader_resource.array_size = reader.ReadU32();
+    shader_resource.size = reader.ReadU64();
+    shader_resource.offset = reader.ReadU32();
+    shader_resource.location = reader.ReadU32();
+
+    shader_resources_.push_back(std::move(shader_resource));
+  }
+
+  u32 specialization_constant_count{reader.ReadU32()};
+  specialization_constants_.reserve(specialization_constant_count);
+  for (u32 i{}; i < specialization_constant_count; ++i) {
+    SpecializationConstant sc{};
+    sc.name = reader.ReadString();
+    sc.constant_id = reader.ReadU32();
+
+    specialization_constants_.push_back(std::move(sc));
+  }
+}
+
 u32 SPIRV::ParseInputAttachmentIndex(const spirv_cross::CompilerGLSL& compiler,
                                      const spirv_cross::Resource& resource) {
   return compiler.get_decoration(resource.id,
@@ -216,4 +396,44 @@ u32 SPIRV::ParseLocation(const spirv_cross::CompilerGLSL& compiler,
   return compiler.get_decoration(resource.id, spv::DecorationLocation);
 }
 
+void SPIRV::StripDebugInfo(std::vector<u32>& spirv) {
+  constexpr u32 kHeaderWordCount{5};
+  if (spirv.size() <= kHeaderWordCount) {
+    return;
+  }
+
+  std::vector<u32> stripped_spirv(spirv.begin(),
+                                  spirv.begin() + kHeaderWordCount);
+  stripped_spirv.reserve(spirv.size());
+
+  u64 offset{kHeaderWordCount};
+  while (offset < spirv.size()) {
+    u32 word_count{spirv[offset] >> 16};
+    auto opcode{static_cast<spv::Op>(spirv[offset] & 0xFFFF)};
+    if (word_count == 0 || offset + word_count > spirv.size()) {
+      THROW("Invalid spirv instruction at word {}", offset);
+    }
+
+    switch (opcode) {
+      case spv::OpSourceContinued:
+      case spv::OpSource:
+      case spv::OpSourceExtension:
+      case spv::OpName:
+      case spv::OpMemberName:
+      case spv::OpString:
+      case spv::OpLine:
+      case spv::OpNoLine:
+      case spv::OpModuleProcessed:
+        break;
+      default:
+        stripped_spirv.insert(stripped_spirv.end(), spirv.begin() + offset,
+                              spirv.begin() + offset + word_count);
+        break;
+    }
+    offset += word_count;
+  }
+
+  spirv = std::move(stripped_spirv);
+}
+
 }  // namespace luka::fw
@@ -7,6 +7,7 @@
 #include "platform/pch.h"
 // clang-format on
 
+#include <span>
 #include <spirv_glsl.hpp>
 
 #include "resource/asset/asset.h"
@@ -44,12 +45,19 @@ struct SpecializationConstant {
   u32 constant_id;
 };
 
+// Resources a pipeline layout and its vertex input are built from, a shader
+// keeping them can be swapped without touching the layout.
+u64 HashShaderInterface(const std::unordered_map<std::string, ShaderResource>&
+                            name_shader_resources);
+
 class SPIRV {
  public:
   SPIRV(const ast::Shader& shader, const std::vector<std::string>& processes,
         vk::ShaderStageFlagBits stage, u64 hash_value);
   SPIRV(const std::vector<u32>& spirv, vk::ShaderStageFlagBits stage,
-        u64 hash_value);
+        u64 hash_value, bool strip_debug_info = false);
+  SPIRV(std::span<const u32> spirv, std::span<const u32> reflection,
+        vk::ShaderStageFlagBits stage, u64 hash_value);
 
   vk::ShaderStageFlagBits GetStage() const;
   u64 GetHashValue() const;
@@ -58,9 +66,14 @@ class SPIRV {
   const std::vector<ShaderResource>& GetShaderResources() const;
   const std::vector<SpecializationConstant>& GetSpecializationConstants() const;
 
+  std::vector<u32> SerializeReflection() const;
+
  private:
   void ParseShaderResource(const spirv_cross::CompilerGLSL& compiler);
   void ParseSpecialization(const spirv_cross::CompilerGLSL& compiler);
+  void DeserializeReflection(std::span<const u32> reflection);
+
+  static void StripDebugInfo(std::vector<u32>& spirv);
 
   static u32 ParseInputAttachmentIndex(
       const spirv_cross::CompilerGLSL& compiler,
@@ -0,0 +1,200 @@
+// SPDX license identifier: MIT.
+// Copyright (C) 2023-present Liam Hauw.
+
+// clang-format off
+#include "platform/pch.h"
+// clang-format on
+
+#include "rendering/framework/spirv_archive.h"
+
+#include "core/log.h"
+#include "resource/asset/shader.h"
+
+namespace luka::fw {
+
+SpirvArchive::SpirvArchive(std::filesystem::path archive_file)
+    : archive_file_{std::move(archive_file)},
+      compiler_version_{ast::Shader::GetCompilerVersion()} {
+  Load();
+
+  // Stale records taking more space than live ones are not worth mapping.
+  if (mapped_file_.GetSize() > sizeof(SpirvArchiveHeader) + 2 * live_size_) {
+    Compact();
+    Load();
+  }
+}
+
+SpirvArchive::~SpirvArchive() { Save(); }
+
+SpirvArchiveItem SpirvArchive::Find(u64 hash_value,
+                                    u64 source_hash_value) const {
+  auto it{entries_.find(hash_value)};
+  if (it == entries_.end() ||
+      it->second.source_hash_value != source_hash_value) {
+    return {};
+  }
+
+  const SpirvArchiveEntry& entry{it->second};
+  const u32* words{
+      reinterpret_cast<const u32*>(mapped_file_.GetData() + entry.offset)};
+  return {{words, entry.word_count},
+          {words + entry.word_count, entry.reflection_word_count}};
+}
+
+void SpirvArchive::Append(u64 hash_value, u64 source_hash_value,
+                          const std::vector<u32>& spirv,
+                          const std::vector<u32>& reflection) {
+  SpirvArchiveRecord record{hash_value,
+                            source_hash_value,
+                            compiler_version_,
+                            static_cast<u32>(spirv.size()),
+                            static_cast<u32>(reflection.size()),
+                            0};
+  std::vector<u32> words;
+  words.reserve(spirv.size() + reflection.size());
+  words.insert(words.end(), spirv.begin(), spirv.end());
+  words.insert(words.end(), reflection.begin(), reflection.end());
+
+  std::lock_guard<std::mutex> lock{mutex_};
+  pending_records_.emplace_back(record, std::move(words));
+}
+
+void SpirvArchive::Load() {
+  entries_.clear();
+  live_size_ = 0;
+  valid_size_ = 0;
+  mapped_file_.Map(archive_file_);
+
+  const u8* data{mapped_file_.GetData()};
+  u64 size{mapped_file_.GetSize()};
+  if (size < sizeof(SpirvArchiveHeader)) {
+    return;
+  }
+
+  SpirvArchiveHeader header{};
+  memcpy(&header, data, sizeof(SpirvArchiveHeader));
+  if (header.magic != kSpirvArchiveMagic ||
+      header.version != kSpirvArchiveVersion) {
+    LOGW("Discard spirv archive {}", archive_file_.string());
+    return;
+  }
+
+  // A record cut short by an interrupted save ends the archive.
+  u64 offset{sizeof(SpirvArchiveHeader)};
+  while (offset + sizeof(SpirvArchiveRecord) <= size) {
+    SpirvArchiveRecord record{};
+    memcpy(&record, data + offset, sizeof(SpirvArchiveRecord));
+    u64 record_size{sizeof(SpirvArchiveRecord) +
+                    (static_cast<u64>(record.word_count) +
+                     record.reflection_word_count) *
+                        sizeof(u32)};
+    if (offset + record_size > size) {
+      break;
+    }
+
+    if (record.compiler_version == compiler_version_) {
+      // Later records replace earlier ones with the same hash value.
+      SpirvArchiveEntry entry{offset + sizeof(SpirvArchiveRecord),
+                              record.word_count, record.reflection_word_count,
+                              record.compiler_version,
+                              record.source_hash_value};
+      auto it{entries_.find(record.hash_value)};
+      if (it != entries_.end()) {
+        live_size_ -= sizeof(SpirvArchiveRecord) +
+                      (static_cast<u64>(it->second.word_count) +
+                       it->second.reflection_word_count) *
+                          sizeof(u32);
+        it->second = entry;
+      } else {
+        entries_.emplace(record.hash_value, entry);
+      }
+      live_size_ += record_size;
+    }
+
+    offset += record_size;
+  }
+  valid_size_ = offset;
+}
+
+void SpirvArchive::Compact() {
+  std::vector<u8> archive_data(sizeof(SpirvArchiveHeader) + live_size_);
+  SpirvArchiveHeader header{kSpirvArchiveMagic, kSpirvArchiveVersion};
+  memcpy(archive_data.data(), &header, sizeof(SpirvArchiveHeader));
+
+  u64 offset{sizeof(SpirvArchiveHeader)};
+  for (const auto& [hash_value, entry] : entries_) {
+    SpirvArchiveRecord record{hash_value,
+                              entry.source_hash_value,
+                              entry.compiler_version,
+                              entry.word_count,
+                              entry.reflection_word_count,
+                              0};
+    memcpy(archive_data.data() + offset, &record, sizeof(SpirvArchiveRecord));
+    offset += sizeof(SpirvArchiveRecord);
+
+    u64 words_size{
+        (static_cast<u64>(entry.word_count) + entry.reflection_word_count) *
+        sizeof(u32)};
+    memcpy(archive_data.data() + offset, mapped_file_.GetData() + entry.offset,
+           words_size);
+    offset += words_size;
+  }
+
+  mapped_file_.Unmap();
+
+  std::filesystem::path temporary_file{archive_file_};
+  temporary_file += ".tmp";
+  SaveBinaryU8(archive_data, temporary_file);
+  std::filesystem::rename(temporary_file, archive_file_);
+}
+
+void SpirvArchive::Save() {
+  mapped_file_.Unmap();
+  if (pending_records_.empty()) {
+    return;
+  }
+
+  // Records appended after a truncated or corrupt tail could never be read,
+  // so the tail, or a discarded archive, is cut off first. Runs from the
+  // destructor, so failures are logged and never thrown.
+  std::error_code error_code;
+  u64 file_size{std::filesystem::file_size(archive_file_, error_code)};
+  if (!error_code && file_size != valid_size_) {
+    std::filesystem::resize_file(archive_file_, valid_size_, error_code);
+    if (error_code) {
+      LOGW("Fail to truncate {}", archive_file_.string());
+      return;
+    }
+  }
+
+  bool has_header{valid_size_ >= sizeof(SpirvArchiveHeader)};
+  std::ofstream archive_file{archive_file_.string(),
+                             std::ios::binary | std::ios::app};
+  if (!archive_file) {
+    LOGW("Fail to open {}", archive_file_.string());
+    return;
+  }
+
+  if (!has_header) {
+    SpirvArchiveHeader header{kSpirvArchiveMagic, kSpirvArchiveVersion};
+    archive_file.write(reinterpret_cast<const char*>(&header),
+                       sizeof(SpirvArchiveHeader));
+  }
+
+  for (const auto& [record, words] : pending_records_) {
+    archive_file.write(reinterpret_cast<const char*>(&record),
+                       sizeof(SpirvArchiveRecord));
+    archive_file.write(reinterpret_cast<const char*>(words.data()),
+                       static_cast<i64>(words.size() * sizeof(u32)));
+  }
+  pending_records_.clear();
+
+  // A failed append is cut off again, so the archive keeps its valid records.
+  archive_file.close();
+  if (!archive_file) {
+    LOGW("Fail to write {}", archive_file_.string());
+    std::filesystem::resize_file(archive_file_, valid_size_, error_code);
+  }
+}
+
+}  // namespace luka::fw
@@ -0,0 +1,88 @@
+// SPDX license identifier: MIT.
+// Copyright (C) 2023-present Liam Hauw.
+
+#pragma once
+
+// clang-format off
+#include "platform/pch.h"
+// clang-format on
+
+#include <mutex>
+#include <span>
+
+#include "core/mapped_file.h"
+#include "core/util.h"
+
+namespace luka::fw {
+
+constexpr u32 kSpirvArchiveMagic{0x41535053};  // "SPSA"
+constexpr u32 kSpirvArchiveVersion{2};
+
+struct SpirvArchiveHeader {
+  u32 magic;
+  u32 version;
+};
+
+// Every record is followed by its words and then its reflection words,
+// records stay 4 byte aligned.
+struct SpirvArchiveRecord {
+  u64 hash_value;
+  u64 source_hash_value;
+  u32 compiler_version;
+  u32 word_count;
+  u32 reflection_word_count;
+  u32 reserved;
+};
+
+struct SpirvArchiveEntry {
+  u64 offset;
+  u32 word_count;
+  u32 reflection_word_count;
+  u32 compiler_version;
+  u64 source_hash_value;
+};
+
+struct SpirvArchiveItem {
+  std::span<const u32> spirv;
+  std::span<const u32> reflection;
+};
+
+/**
+ * All SPIR-V variants and their reflection in one append-only file,
+ * memory-mapped once when opened. Variants compiled meanwhile are appended
+ * when the archive closes, records that were replaced or built by another
+ * compiler are compacted away the next time it is opened.
+ */
+class SpirvArchive {
+ public:
+  DELETE_SPECIAL_MEMBER_FUNCTIONS(SpirvArchive)
+
+  explicit SpirvArchive(std::filesystem::path archive_file);
+
+  ~SpirvArchive();
+
+  SpirvArchiveItem Find(u64 hash_value, u64 source_hash_value) const;
+  void Append(u64 hash_value, u64 source_hash_value,
+              const std::vector<u32>& spirv,
+              const std::vector<u32>& reflection);
+
+ private:
+  void Load();
+  void Compact();
+  void Save();
+
+  std::filesystem::path archive_file_;
+  u32 compiler_version_{};
+
+  MappedFile mapped_file_;
+  std::unordered_map<u64, SpirvArchiveEntry> entries_;
+  u64 live_size_{};
+  // End of the last readable record, anything after it is cut off on save.
+  u64 valid_size_{};
+
+  std::mutex mutex_;
+  std::vector<std::pair<SpirvArchiveRecord, std::vector<u32>>>
+      pending_records_;
+};
+
+}  // namespace luka::fw
@@ -16,12 +16,14 @@
 
 #include "core/log.h"
 #include "core/util.h"
-#include "resource/config/generated/root_path.h"
+#include "rendering/framework/descriptor_update.h"
 
 namespace luka::fw {
 
 Subpass::Subpass(
-    std::shared_ptr<Gpu> gpu, std::shared_ptr<Asset> asset,
+    std::shared_ptr<TaskScheduler> task_scheduler, std::shared_ptr<Gpu> gpu,
+    std::shared_ptr<ResourceCache> resource_cache,
+    std::shared_ptr<Config> config, std::shared_ptr<Asset> asset,
     std::shared_ptr<Camera> camera, u32 frame_count, vk::RenderPass render_pass,
     const std::vector<std::vector<vk::raii::ImageView>>& attachment_image_views,
     u32 color_attachment_count, const std::vector<ast::Subpass>& ast_subpasses,
@@ -29,7 +31,10 @@ Subpass::Subpass(
     std::vector<std::unordered_map<std::string, vk::Image>>& shared_images,
     std::vector<std::unordered_map<std::string, vk::ImageView>>&
         shared_image_views)
-    : gpu_{std::move(gpu)},
+    : task_scheduler_{std::move(task_scheduler)},
+      gpu_{std::move(gpu)},
+      resource_cache_{std::move(resource_cache)},
+      config_{std::move(config)},
       asset_{std::move(asset)},
       camera_{std::move(camera)},
       frame_count_{frame_count},
@@ -48,8 +53,22 @@ Subpass::Subpass(
       lights_{&(ast_subpass_->lights)},
       has_scene_{!scene_.empty()},
       has_light_{!lights_->empty()},
+      vertex_pulling_{has_scene_ && config_->GetVertexPulling() &&
+                      gpu_->HasBufferDeviceAddress() &&
+                      gpu_->HasMultiDrawIndirect()},
       subpass_uniforms_(frame_count_),
-      subpass_uniform_buffers_(frame_count_) {
+      subpass_uniform_buffers_(frame_count_),
+      descriptor_allocator_{gpu_->CreateDescriptorAllocator()} {
+  if (has_light_) {
+    auto ci{shaders_->find(vk::ShaderStageFlagBits::eCompute)};
+    if (ci == shaders_->end()) {
+      THROW("There is no light cluster shader");
+    }
+    light_cluster_ = std::make_unique<LightCluster>(
+        gpu_, resource_cache_, asset_, camera_, frame_count_, ci->second,
+        *lights_);
+  }
+
   CreateDrawElements();
 }
 
@@ -59,13 +78,10 @@ void Subpass::Resize(const std::vector<std::vector<vk::raii::ImageView>>&
     return;
   }
 
+  // Pipelines, buffers and descriptor sets do not depend on the size, only
+  // the descriptors of the recreated images are written again.
   attachment_image_views_ = &attachment_image_views;
-  punctual_lights_.clear();
-  subpass_desciptor_set_updated_ = false;
-  bindless_sampler_index_ = 0;
-  bindless_image_index_ = 0;
-
-  CreateDrawElements();
+  UpdateSizeDependentDescriptors();
 }
 
 void Subpass::Update(u32 frame_index) {
@@ -77,20 +93,30 @@ void Subpass::Update(u32 frame_index) {
     glm::mat4 pv{projection * view};
     glm::mat4 inverse_pv{glm::inverse(pv)};
 
-    subpass_uniforms_[frame_index] =
-        SubpassUniform{pv, inverse_pv, glm::vec4{camera_position, 1.0F}};
-
-    if (has_light_) {
-      memcpy(subpass_uniforms_[frame_index].punctual_lights,
-             punctual_lights_.data(),
-             sizeof(ast::PunctualLight) * punctual_lights_.size());
-    }
+    subpass_uniforms_[frame_index] = SubpassUniform{
+        pv,
+        inverse_pv,
+        view,
+        glm::vec4{camera_position, 1.0F},
+        camera_->GetNearPlane(),
+        camera_->GetFarPlane()};
 
     void* mapped{subpass_uniform_buffers_[frame_index].Map()};
     memcpy(mapped,
            reinterpret_cast<const void*>(&(subpass_uniforms_[frame_index])),
            sizeof(SubpassUniform));
   }
+
+  if (light_cluster_) {
+    light_cluster_->Update(frame_index);
+  }
+}
+
+void Subpass::CullLights(const vk::raii::CommandBuffer& command_buffer,
+                         u32 frame_index) const {
+  if (light_cluster_) {
+    light_cluster_->Cull(command_buffer, frame_index);
+  }
 }
 
 const std::string& Subpass::GetName() const { return name_; }
@@ -99,10 +125,39 @@ const std::vector<DrawElement>& Subpass::GetDrawElements() const {
   return draw_elements_;
 }
 
+u64 Subpass::GetDrawElementVersion() const { return draw_element_version_; }
+
+u64 Subpass::GetLightClusterPipelineHashValue() const {
+  return light_cluster_ ? light_cluster_->GetPipelineHashValue() : 0;
+}
+
+const std::unordered_set<std::string>& Subpass::GetSharedImageNames() const {
+  return shared_image_names_;
+}
+
 bool Subpass::HasPushConstant() const { return has_push_constant_; }
 
 void Subpass::PushConstants(const vk::raii::CommandBuffer& command_buffer,
-                            vk::PipelineLayout pipeline_layout) const {}
+                            vk::PipelineLayout pipeline_layout,
+                            u32 frame_index) const {
+  SubpassPushConstant subpass_push_constant{
+      frame_index, static_cast<u32>(draw_elements_.size())};
+  PushConstantBytes(command_buffer, pipeline_layout,
+                    offsetof(PushConstant, subpass),
+                    sizeof(SubpassPushConstant), &subpass_push_constant);
+}
+
+void Subpass::PushDrawElementConstants(
+    const vk::raii::CommandBuffer& command_buffer,
+    vk::PipelineLayout pipeline_layout, const DrawElement& draw_element) const {
+  DrawElementPushConstant draw_element_push_constant{
+      draw_element.draw_element_index, draw_element.material_index,
+      draw_element.lod};
+  PushConstantBytes(command_buffer, pipeline_layout,
+                    offsetof(PushConstant, draw_element),
+                    sizeof(DrawElementPushConstant),
+                    &draw_element_push_constant);
+}
 
 bool Subpass::HasSubpassDescriptorSet() const {
   return has_subpass_descriptor_set_;
@@ -112,8 +167,7 @@ u32 Subpass::GetSubpassDescriptorSetIndex() const {
   return subpass_descriptor_set_index_;
 }
 
-const vk::raii::DescriptorSet& Subpass::GetSubpassDescriptorSet(
-    u32 frame_index) const {
+vk::DescriptorSet Subpass::GetSubpassDescriptorSet(u32 frame_index) const {
   return subpass_descriptor_sets_[frame_index];
 }
 
@@ -126,18 +180,171 @@ u32 Subpass::GetBindlessDescriptorSetIndex() const {
 }
 
 const vk::raii::DescriptorSet& Subpass::GetBindlessDescriptorSet() const {
-  return bindless_descriptor_set_;
+  return gpu_->GetBindlessDescriptorSet();
 }
 
 u32 Subpass::GetDrawElementDescriptorSetIndex() const {
   return draw_element_descriptor_set_index_;
 }
 
+bool Subpass::IsVertexPulling() const { return vertex_pulling_; }
+
+vk::Buffer Subpass::GetIndexBuffer() const { return *index_buffer_; }
+
+vk::Buffer Subpass::GetIndirectBuffer(u32 frame_index) const {
+  return *(indirect_buffers_[frame_index]);
+}
+
+vk::DrawIndexedIndirectCommand* Subpass::GetIndirectCommands(
+    u32 frame_index) const {
+  return indirect_commands_[frame_index];
+}
+
+void Subpass::CompileSpirv(u32 index) {
+  const SpirvRequest& spirv_request{spirv_requests_[index]};
+  resource_cache_->RequestSpirv(*(spirv_request.shader),
+                                spirv_request.processes, spirv_request.stage);
+}
+
+void Subpass::CreatePipeline(u32 index, u32 thread_index) {
+  const PipelineRequest& pipeline_request{
+      pipeline_requests_[pending_pipeline_requests_[index]]};
+
+  std::vector<vk::SpecializationInfo> specialization_infos;
+  specialization_infos.reserve(pipeline_request.spirvs.size());
+  std::vector<vk::PipelineShaderStageCreateInfo> shader_stage_cis;
+  for (u32 i{}; i < pipeline_request.spirvs.size(); ++i) {
+    const vk::SpecializationInfo* specialization_info{};
+    if (!pipeline_request.specialization_data[i].empty()) {
+      const auto& specialization_map_entries{
+          pipeline_request.specialization_map_entries[i]};
+      const auto& specialization_data{pipeline_request.specialization_data[i]};
+      specialization_info = &specialization_infos.emplace_back(
+          static_cast<u32>(specialization_map_entries.size()),
+          specialization_map_entries.data(),
+          specialization_data.size() * sizeof(u32),
+          specialization_data.data());
+    }
+
+    vk::PipelineShaderStageCreateInfo shader_stage_ci{
+        {}, pipeline_request.spirvs[i]->GetStage(),
+        pipeline_request.shader_modules[i], "main", specialization_info};
+
+    shader_stage_cis.push_back(shader_stage_ci);
+  }
+
+  vk::PipelineVertexInputStateCreateInfo vertex_input_state_ci{
+      {}, pipeline_request.vertex_input_binding_descriptions,
+      pipeline_request.vertex_input_attribute_descriptions};
+
+  vk::PipelineInputAssemblyStateCreateInfo input_assembly_state_ci{
+      {}, vk::PrimitiveTopology::eTriangleList};
+
+  vk::PipelineViewportStateCreateInfo viewport_state_ci{
+      {}, 1, nullptr, 1, nullptr};
+
+  vk::PipelineRasterizationStateCreateInfo rasterization_state_ci{
+      GetRasterizationState(*(pipeline_request.primitive))};
+
+  vk::PipelineMultisampleStateCreateInfo multisample_state_ci{
+      {}, vk::SampleCountFlagBits::e1};
+
+  vk::PipelineDepthStencilStateCreateInfo depth_stencil_state_ci{
+      {}, VK_TRUE, VK_TRUE, vk::CompareOp::eLess, VK_FALSE, VK_FALSE,
+  };
+
+  u32 blend_enable{VK_FALSE};
+  if (scene_ == "transparency") {
+    blend_enable = VK_TRUE;
+  }
+
+  vk::ColorComponentFlags color_component_flags{
+      vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG |
+      vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA};
+  std::vector<vk::PipelineColorBlendAttachmentState>
+      color_blend_attachment_states(
+          color_attachment_count_,
+          vk::PipelineColorBlendAttachmentState{
+              blend_enable, vk::BlendFactor::eSrcAlpha,
+              vk::BlendFactor::eOneMinusSrcAlpha, vk::BlendOp::eAdd,
+              vk::BlendFactor::eOne, vk::BlendFactor::eZero, vk::BlendOp::eAdd,
+              color_component_flags});
+
+  vk::PipelineColorBlendStateCreateInfo color_blend_state_ci{
+      {},
+      VK_FALSE,
+      vk::LogicOp::eCopy,
+      color_blend_attachment_states,
+      {{0.0F, 0.0F, 0.0F, 0.0F}}};
+
+  std::array<vk::DynamicState, 2> dynamic_states{vk::DynamicState::eViewport,
+                                                 vk::DynamicState::eScissor};
+  vk::PipelineDynamicStateCreateInfo dynamic_state_ci{{}, dynamic_states};
+
+  vk::GraphicsPipelineCreateInfo graphics_pipeline_ci{
+      {},
+      shader_stage_cis,
+      &vertex_input_state_ci,
+      &input_assembly_state_ci,
+      nullptr,
+      &viewport_state_ci,
+      &rasterization_state_ci,
+      &multisample_state_ci,
+      &depth_stencil_state_ci,
+      &color_blend_state_ci,
+      &dynamic_state_ci,
+      pipeline_request.pipeline_layout,
+      render_pass_,
+      subpass_index_};
+
+  resource_cache_->RequestPipeline(
+      graphics_pipeline_ci, pipeline_request.hash_value,
+      thread_pipeline_caches_[thread_index], name_);
+}
+
+void Subpass::UpdateSizeDependentDescriptors() {
+  std::vector<vk::DescriptorImageInfo> descriptor_image_infos;
+  descriptor_image_infos.reserve(size_dependent_descriptors_.size());
+  std::vector<vk::WriteDescriptorSet> write_descriptor_sets;
+  write_descriptor_sets.reserve(size_dependent_descriptors_.size());
+
+  for (const auto& descriptor : size_dependent_descriptors_) {
+    u32 i{descriptor.frame_index};
+    if (descriptor.descriptor_type == vk::DescriptorType::eInputAttachment) {
+      descriptor_image_infos.emplace_back(
+          nullptr,
+          *(*attachment_image_views_)[i][descriptor.input_attachment_index],
+          vk::ImageLayout::eShaderReadOnlyOptimal);
+    } else {
+      auto it{(*shared_image_views_)[i].find(descriptor.name)};
+      if (it == (*shared_image_views_)[i].end()) {
+        THROW("Image view is nullptr");
+      }
+      descriptor_image_infos.emplace_back(
+          *(gpu_->GetSampler()), it->second,
+          vk::ImageLayout::eShaderReadOnlyOptimal);
+    }
+
+    write_descriptor_sets.emplace_back(
+        descriptor.descriptor_set, descriptor.binding, 0,
+        descriptor.descriptor_type, descriptor_image_infos.back());
+  }
+
+  if (!write_descriptor_sets.empty()) {
+    gpu_->UpdateDescriptorSets(write_descriptor_sets);
+  }
+}
+
 void Subpass::CreateDrawElements() {
   draw_elements_.clear();
+  draw_element_uniforms_.clear();
+  pipeline_requests_.clear();
+  reloaded_pipeline_hash_values_.clear();
+  ++draw_element_version_;
 
   if (!has_scene_) {
     draw_elements_.push_back(CreateDrawElement());
+    CreatePipelines();
   } else {
     const std::string& ast_subpass_scene{ast_subpass_->scene};
     bool is_transparent{false};
@@ -145,29 +352,189 @@ void Subpass::CreateDrawElements() {
       is_transparent = true;
     }
 
+    // Vertices are pulled for the whole subpass or not at all, draw elements
+    // batched into one indirect draw have to share their vertex layout.
+    if (vertex_pulling_) {
+      for (const auto& scene_primitive : *scene_primitives_) {
+        if (!CanPullVertices(*(scene_primitive.primitive))) {
+          vertex_pulling_ = false;
+          LOGW("Subpass {} falls back to vertex input", name_);
+          break;
+        }
+      }
+    }
+
+    // Scene primitives referencing the same primitive of the same scene share
+    // material and pipeline, so they are merged into one instanced draw
+    // element. Blended primitives are kept apart since every instance has to
+    // be ordered on its own.
+    std::vector<std::vector<const ScenePrimitive*>> instance_groups;
+    std::map<std::pair<u32, const ast::sc::Primitive*>, u32> group_indices;
     for (const auto& scene_primitive : *scene_primitives_) {
-      if ((!is_transparent &&
-           scene_primitive.primitive->material->GetAlphaMode() !=
-               ast::sc::AlphaMode::kBlend) ||
-          (is_transparent &&
-           scene_primitive.primitive->material->GetAlphaMode() ==
-               ast::sc::AlphaMode::kBlend)) {
-        draw_elements_.push_back(CreateDrawElement(scene_primitive));
+      bool is_blend{scene_primitive.primitive->material->GetAlphaMode() ==
+                    ast::sc::AlphaMode::kBlend};
+      if (is_blend != is_transparent) {
+        continue;
       }
+
+      if (is_transparent) {
+        instance_groups.push_back({&scene_primitive});
+        continue;
+      }
+
+      auto key{std::make_pair(scene_primitive.scence_index,
+                              scene_primitive.primitive)};
+      auto it{group_indices.find(key)};
+      if (it != group_indices.end()) {
+        instance_groups[it->second].push_back(&scene_primitive);
+      } else {
+        group_indices.emplace(key, static_cast<u32>(instance_groups.size()));
+        instance_groups.push_back({&scene_primitive});
+      }
+    }
+
+    instance_uniforms_.clear();
+    for (u32 i{}; i < instance_groups.size(); ++i) {
+      for (const auto* scene_primitive : instance_groups[i]) {
+        instance_uniforms_.push_back(InstanceUniform{
+            scene_primitive->model, scene_primitive->inverse_model, i});
+      }
+    }
+
+    // Shaders of all draw elements are known before any draw element is
+    // created, so unique shaders are compiled in parallel.
+    std::vector<const ast::sc::Primitive*> primitives;
+    primitives.reserve(instance_groups.size());
+    for (const auto& instance_group : instance_groups) {
+      primitives.push_back(instance_group.front()->primitive);
+    }
+    CompileSpirvs(primitives);
+
+    // Pipelines and materials get ids in order of first appearance, so the
+    // render queue orders draw elements the same way on every run.
+    std::unordered_map<const ast::sc::Material*, u32> material_ids;
+
+    u32 first_instance{};
+    for (const auto& instance_group : instance_groups) {
+      const ScenePrimitive& scene_primitive{*(instance_group.front())};
+
+      DrawElement draw_element{CreateDrawElement(scene_primitive)};
+      draw_element.draw_element_index =
+          static_cast<u32>(draw_elements_.size());
+      draw_element.first_instance = first_instance;
+      draw_element.instance_count = static_cast<u32>(instance_group.size());
+      first_instance += draw_element.instance_count;
+
+      draw_element.material_id =
+          material_ids
+              .emplace(scene_primitive.primitive->material,
+                       static_cast<u32>(material_ids.size()))
+              .first->second;
+
+      // Instances are ordered by the mean of their origins.
+      glm::vec3 center{};
+      for (const auto* instance : instance_group) {
+        center += glm::vec3{instance->model[3]};
+      }
+      draw_element.center =
+          center / static_cast<f32>(draw_element.instance_count);
+
+      draw_elements_.push_back(std::move(draw_element));
+    }
+
+    CreatePipelines();
+
+    // Pipelines only exist once all draw elements are created.
+    AssignPipelineIds();
+
+    CreateDrawElementBuffer();
+
+    if (vertex_pulling_) {
+      CreateVertexPullingResources();
     }
+  }
+}
 
-    std::sort(draw_elements_.begin(), draw_elements_.end(),
-              [](const auto& lhs, const auto& rhs) {
-                if (lhs.pipeline != rhs.pipeline) {
-                  return lhs.pipeline < rhs.pipeline;
-                }
+void Subpass::CreateDrawElementBuffer() {
+  // Per draw element data is indexed by the pushed draw element index, or
+  // through the instances when vertices are pulled, so no descriptor set is
+  // bound per draw. Draws pushing their material index do not read it.
+  if (draw_element_uniforms_.empty()) {
+    return;
+  }
 
-                if (lhs.pipeline_layout != rhs.pipeline_layout) {
-                  return lhs.pipeline_layout < rhs.pipeline_layout;
-                }
+  vk::BufferCreateInfo draw_element_buffer_ci{
+      {},
+      sizeof(DrawElementUniform) * draw_element_uniforms_.size(),
+      vk::BufferUsageFlagBits::eStorageBuffer};
+  draw_element_buffer_ = gpu_->CreateBuffer(draw_element_buffer_ci,
+                                            draw_element_uniforms_.data(),
+                                            false, name_ + "_draw_element");
+
+  if (draw_element_buffer_binding_ != UINT32_MAX) {
+    vk::DescriptorBufferInfo descriptor_buffer_info{
+        *draw_element_buffer_, 0, draw_element_buffer_ci.size};
+
+    DescriptorUpdate descriptor_update;
+    descriptor_update.AddBuffer(draw_element_buffer_binding_,
+                                vk::DescriptorType::eStorageBuffer,
+                                descriptor_buffer_info);
+    for (u32 i{}; i < frame_count_; ++i) {
+      descriptor_update.Update(*gpu_, *resource_cache_,
+                               subpass_descriptor_sets_[i],
+                               **subpass_descriptor_set_layout_, name_);
+    }
+  }
+}
 
-                return false;
-              });
+void Subpass::CreateVertexPullingResources() {
+  if (draw_elements_.empty()) {
+    return;
+  }
+
+  // Indices of all draw elements are merged, so a batch of draw elements only
+  // needs one index buffer binding.
+  std::vector<u32> indices;
+  for (auto& draw_element : draw_elements_) {
+    draw_element.first_index = static_cast<u32>(indices.size());
+    if (draw_element.has_index) {
+      const std::vector<u32>& primitive_indices{
+          draw_element.index_attribute->indices};
+      indices.insert(indices.end(), primitive_indices.begin(),
+                     primitive_indices.end());
+    } else {
+      for (u32 i{}; i < draw_element.vertex_count; ++i) {
+        indices.push_back(i);
+      }
+    }
+    draw_element.index_count =
+        static_cast<u32>(indices.size()) - draw_element.first_index;
+  }
+
+  vk::BufferCreateInfo index_buffer_ci{{},
+                                       sizeof(u32) * indices.size(),
+                                       vk::BufferUsageFlagBits::eIndexBuffer};
+  index_buffer_ = gpu_->CreateBuffer(index_buffer_ci, indices.data(), false,
+                                     name_ + "_index");
+
+  // Indirect commands are written while recording, every frame has its own
+  // buffer since recorded command buffers are reused per frame.
+  std::vector<vk::DrawIndexedIndirectCommand> indirect_commands(
+      draw_elements_.size());
+  vk::BufferCreateInfo indirect_buffer_ci{
+      {},
+      sizeof(vk::DrawIndexedIndirectCommand) * indirect_commands.size(),
+      vk::BufferUsageFlagBits::eIndirectBuffer};
+
+  indirect_buffers_.clear();
+  indirect_commands_.clear();
+  for (u32 i{}; i < frame_count_; ++i) {
+    gpu::Buffer indirect_buffer{
+        gpu_->CreateBuffer(indirect_buffer_ci, indirect_commands.data(), true,
+                           name_ + "_indirect", static_cast<i32>(i))};
+    indirect_commands_.push_back(
+        static_cast<vk::DrawIndexedIndirectCommand*>(indirect_buffer.Map()));
+    indirect_buffers_.push_back(std::move(indirect_buffer));
   }
 }
 
@@ -177,6 +544,12 @@ DrawElement Subpass::CreateDrawElement(const ScenePrimitive& scene_primitivce) {
   if (draw_element.has_scene) {
     draw_element.scene_index = scene_primitivce.scence_index;
   }
+  draw_element.instance_count = 1;
+  draw_element.primitive = scene_primitivce.primitive;
+  if (draw_element.has_scene) {
+    draw_element.material_index =
+        scene_primitivce.primitive->material->GetMaterialIndex();
+  }
 
   // Parse shader resources.
   std::vector<const SPIRV*> spirvs;
@@ -187,26 +560,104 @@ DrawElement Subpass::CreateDrawElement(const ScenePrimitive& scene_primitivce) {
   ParseShaderResources(*(scene_primitivce.primitive), spirvs,
                        name_shader_resources, set_shader_resources, sorted_sets,
                        push_constant_ranges);
+  draw_element.interface_hash_value =
+      HashShaderInterface(name_shader_resources);
 
   // Create pipeline resources.
-  CreatePipelineResources(
-      scene_primitivce.model, scene_primitivce.inverse_model,
-      *(scene_primitivce.primitive), name_shader_resources,
-      set_shader_resources, sorted_sets, push_constant_ranges, draw_element);
+  CreatePipelineResources(*(scene_primitivce.primitive), name_shader_resources,
+                          set_shader_resources, sorted_sets,
+                          push_constant_ranges, draw_element);
 
-  // Pipeline.
-  CreatePipeline(*(scene_primitivce.primitive), spirvs, name_shader_resources,
-                 draw_element);
+  // Pipeline, created together with the pipelines of the other draw elements.
+  PreparePipeline(*(scene_primitivce.primitive), spirvs, name_shader_resources,
+                  draw_element);
 
   return draw_element;
 }
 
-void Subpass::ParseShaderResources(
-    const ast::sc::Primitive& primitive, std::vector<const SPIRV*>& spirvs,
-    std::unordered_map<std::string, ShaderResource>& name_shader_resources,
-    std::unordered_map<u32, std::vector<ShaderResource>>& set_shader_resources,
-    std::vector<u32>& sorted_sets,
-    std::vector<vk::PushConstantRange>& push_constant_ranges) {
+bool Subpass::CanPullVertices(const ast::sc::Primitive& primitive) const {
+  // The vertex shader fetches tightly typed floats, other formats keep the
+  // fixed function vertex input.
+  for (const auto& name : pulled_vertex_attributes_) {
+    auto it{primitive.vertex_attributes.find(name)};
+    if (it == primitive.vertex_attributes.end()) {
+      continue;
+    }
+
+    const ast::sc::VertexAttribute& vertex_attribute{it->second};
+    if (vertex_attribute.format != vk::Format::eR32G32Sfloat &&
+        vertex_attribute.format != vk::Format::eR32G32B32Sfloat &&
+        vertex_attribute.format != vk::Format::eR32G32B32A32Sfloat) {
+      return false;
+    }
+    if (vertex_attribute.stride % sizeof(f32) != 0 ||
+        vertex_attribute.offset % sizeof(f32) != 0) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+void Subpass::CompileSpirvs(
+    const std::vector<const ast::sc::Primitive*>& primitives) {
+  auto vi{shaders_->find(vk::ShaderStageFlagBits::eVertex)};
+  if (vi == shaders_->end()) {
+    THROW("There is no vertex shader");
+  }
+  auto fi{shaders_->find(vk::ShaderStageFlagBits::eFragment)};
+  if (fi == shaders_->end()) {
+    THROW("There is no fragment shader");
+  }
+  const ast::Shader& vertex_shader{asset_->GetShader(vi->second)};
+  const ast::Shader& fragment_shader{asset_->GetShader(fi->second)};
+
+  spirv_requests_.clear();
+  std::unordered_set<u64> requested_hash_values;
+  auto add_spirv_request{[&](const ast::Shader& shader,
+                             std::vector<std::string> processes,
+                             vk::ShaderStageFlagBits shader_stage) {
+    u64 hash_value{shader.GetHashValue(processes)};
+    if (resource_cache_->HasSpirv(hash_value) ||
+        !requested_hash_values.insert(hash_value).second) {
+      return;
+    }
+    spirv_requests_.push_back(
+        SpirvRequest{&shader, std::move(processes), shader_stage, hash_value});
+  }};
+
+  for (const auto* primitive : primitives) {
+    std::vector<std::string> vertex_shader_processes;
+    std::vector<std::string> fragment_shader_processes;
+    GetShaderProcesses(*primitive, vertex_shader_processes,
+                       fragment_shader_processes);
+
+    add_spirv_request(vertex_shader, std::move(vertex_shader_processes),
+                      vk::ShaderStageFlagBits::eVertex);
+    add_spirv_request(fragment_shader, std::move(fragment_shader_processes),
+                      vk::ShaderStageFlagBits::eFragment);
+  }
+
+  if (spirv_requests_.empty()) {
+    return;
+  }
+
+  u32 spirv_count{static_cast<u32>(spirv_requests_.size())};
+  if (spirv_count == 1) {
+    CompileSpirv(0);
+  } else {
+    SpirvTaskSet spirv_task_set{this, spirv_count};
+    task_scheduler_->AddTaskSetToPipe(&spirv_task_set);
+    task_scheduler_->WaitforTask(&spirv_task_set);
+  }
+
+  spirv_requests_.clear();
+}
+
+void Subpass::GetShaderProcesses(
+    const ast::sc::Primitive& primitive,
+    std::vector<std::string>& vertex_shader_processes,
+    std::vector<std::string>& fragment_shader_processes) {
   std::vector<std::string> shader_processes;
 
   // Common.
@@ -227,41 +678,12 @@ void Subpass::ParseShaderResources(
   blend_alpha = "DBLEND_ALPHA " + blend_alpha;
   shader_processes.push_back(blend_alpha);
 
-  std::string punctual_light_max_count{
-      std::to_string(ast::kPunctualLightMaxCount)};
-  punctual_light_max_count =
-      "DPUNCTUAL_LIGHT_MAX_COUNT " + punctual_light_max_count;
-  shader_processes.push_back(punctual_light_max_count);
-
-  std::string directional_light{
-      std::to_string(static_cast<u32>(ast::PunctualLightType::kDirectional))};
-  directional_light = "DDIRECTIONAL_LIGHT " + directional_light;
-  shader_processes.push_back(directional_light);
-
-  std::string point_light{
-      std::to_string(static_cast<u32>(ast::PunctualLightType::kPoint))};
-  point_light = "DPOINT_LIGHT " + point_light;
-  shader_processes.push_back(point_light);
-
-  std::string spot_light{
-      std::to_string(static_cast<u32>(ast::PunctualLightType::kSpot))};
-  spot_light = "DSPOT_LIGHT " + spot_light;
-  shader_processes.push_back(spot_light);
+  std::vector<std::string> light_processes{GetLightClusterShaderProcesses()};
+  shader_processes.insert(shader_processes.end(), light_processes.begin(),
+                          light_processes.end());
 
   // Scene.
   if (has_scene_) {
-    const std::map<std::string, ast::sc::Texture*>& textures{
-        primitive.material->GetTextures()};
-    for (u32 i{}; i < wanted_textures_.size(); ++i) {
-      std::string wanted_texture{wanted_textures_[i]};
-      auto it{textures.find(wanted_texture)};
-      if (it != textures.end()) {
-        std::transform(wanted_texture.begin(), wanted_texture.end(),
-                       wanted_texture.begin(), ::toupper);
-        shader_processes.push_back("DHAS_" + wanted_texture);
-      }
-    }
-
     bool has_position_buffer{};
     bool has_normal_buffer{};
     for (const auto& vertex_buffer_attribute : primitive.vertex_attributes) {
@@ -281,30 +703,64 @@ void Subpass::ParseShaderResources(
       THROW("There is no position or/and normal buffer.");
     }
 
-    if (primitive.material->GetAlphaMode() == ast::sc::AlphaMode::kMask) {
-      shader_processes.emplace_back("DHAS_MASK_ALPHA");
+    if (vertex_pulling_) {
+      shader_processes.emplace_back("DVERTEX_PULLING");
     }
   }
 
-  // Light.
-  if (has_light_) {
-    if (!light_once_) {
-      light_once_ = true;
-      for (const auto& light : *lights_) {
-        const auto& pls{asset_->GetLight(light).GetPunctualLights()};
-        for (const auto& pl : pls) {
-          punctual_lights_.push_back(pl);
-        }
-        if (punctual_lights_.size() == ast::kPunctualLightMaxCount) {
-          break;
-        }
+  // A pulling vertex shader reads every attribute it may need, so it does not
+  // depend on the feature defines and is shared by all draw elements.
+  if (vertex_pulling_) {
+    for (const auto& shader_process : shader_processes) {
+      if (shader_process.rfind("DHAS_", 0) != 0) {
+        vertex_shader_processes.push_back(shader_process);
       }
     }
-    std::string punctual_light_count{std::to_string(punctual_lights_.size())};
-    punctual_light_count = "DPUNCTUAL_LIGHT_COUNT " + punctual_light_count;
-    shader_processes.push_back(punctual_light_count);
+  } else {
+    vertex_shader_processes = shader_processes;
+  }
+  fragment_shader_processes = std::move(shader_processes);
+}
+
+std::unordered_map<std::string, u32> Subpass::GetSpecializationValues(
+    const ast::sc::Primitive& primitive) const {
+  // Switches that only change values are specialization constants, so they
+  // do not multiply the compiled variants.
+  std::unordered_map<std::string, u32> specialization_values;
+
+  if (has_scene_) {
+    const std::map<std::string, ast::sc::Texture*>& textures{
+        primitive.material->GetTextures()};
+    for (const auto& wanted_texture : wanted_textures_) {
+      std::string name{wanted_texture};
+      std::transform(name.begin(), name.end(), name.begin(), ::toupper);
+      specialization_values.emplace("HAS_" + name,
+                                    textures.contains(wanted_texture)
+                                        ? VK_TRUE
+                                        : VK_FALSE);
+    }
+
+    specialization_values.emplace(
+        "HAS_MASK_ALPHA",
+        primitive.material->GetAlphaMode() == ast::sc::AlphaMode::kMask
+            ? VK_TRUE
+            : VK_FALSE);
   }
 
+  return specialization_values;
+}
+
+void Subpass::ParseShaderResources(
+    const ast::sc::Primitive& primitive, std::vector<const SPIRV*>& spirvs,
+    std::unordered_map<std::string, ShaderResource>& name_shader_resources,
+    std::unordered_map<u32, std::vector<ShaderResource>>& set_shader_resources,
+    std::vector<u32>& sorted_sets,
+    std::vector<vk::PushConstantRange>& push_constant_ranges) {
+  std::vector<std::string> vertex_shader_processes;
+  std::vector<std::string> fragment_shader_processes;
+  GetShaderProcesses(primitive, vertex_shader_processes,
+                     fragment_shader_processes);
+
   auto vi{shaders_->find(vk::ShaderStageFlagBits::eVertex)};
   if (vi == shaders_->end()) {
     THROW("There is no vertex shader");
@@ -313,12 +769,12 @@ void Subpass::ParseShaderResources(
   if (fi == shaders_->end()) {
     THROW("There is no fragment shader");
   }
-  const SPIRV& vert_spirv{RequestSpirv(asset_->GetShader(vi->second),
-                                       shader_processes,
-                                       vk::ShaderStageFlagBits::eVertex)};
-  const SPIRV& frag_spirv{RequestSpirv(asset_->GetShader(fi->second),
-                                       shader_processes,
-                                       vk::ShaderStageFlagBits::eFragment)};
+  const SPIRV& vert_spirv{resource_cache_->RequestSpirv(
+      asset_->GetShader(vi->second), vertex_shader_processes,
+      vk::ShaderStageFlagBits::eVertex)};
+  const SPIRV& frag_spirv{resource_cache_->RequestSpirv(
+      asset_->GetShader(fi->second), fragment_shader_processes,
+      vk::ShaderStageFlagBits::eFragment)};
 
   spirvs = {&vert_spirv, &frag_spirv};
 
@@ -343,6 +799,7 @@ void Subpass::ParseShaderResources(
         shader_resource.type == ShaderResourceType::kCombinedImageSampler ||
         shader_resource.type == ShaderResourceType::kSampledImage ||
         shader_resource.type == ShaderResourceType::kUniformBuffer ||
+        shader_resource.type == ShaderResourceType::kStorageBuffer ||
         shader_resource.type == ShaderResourceType::kInputAttachment) {
       auto it{set_shader_resources.find(shader_resource.set)};
       if (it != set_shader_resources.end()) {
@@ -366,7 +823,6 @@ void Subpass::ParseShaderResources(
 }
 
 void Subpass::CreatePipelineResources(
-    const glm::mat4& model_matrix, const glm::mat4& inverse_model_matrix,
     const ast::sc::Primitive& primitive,
     const std::unordered_map<std::string, ShaderResource>&
         name_shader_resources,
@@ -375,28 +831,27 @@ void Subpass::CreatePipelineResources(
     const std::vector<u32>& sorted_sets,
     const std::vector<vk::PushConstantRange>& push_constant_ranges,
     DrawElement& draw_element) {
-  std::vector<vk::WriteDescriptorSet> write_descriptor_sets;
-  std::vector<vk::DescriptorImageInfo> sampler_infos;
-  std::vector<vk::DescriptorImageInfo> image_infos;
-  std::vector<vk::DescriptorBufferInfo> buffer_infos;
-
-  /**
-   * Why we reserve these vectors:
-   *
-   * When we add an element to std::vector, if it exceeds the size of the
-   * current container, std::vector will automatically perform a memory
-   * reallocation, copying the element from the old location to the new one, but
-   * the pointer stored in write_descriptor_sets will not change, causing an
-   * error in the update to descriptors.
-   */
-  sampler_infos.reserve(kSamplerInfoMaxCount);
-  image_infos.reserve(kImageInfoMaxCount);
-  buffer_infos.reserve(kBufferInfoMaxCount);
-
-  glm::uvec4 sampler_indices_0{};
-  glm::uvec4 sampler_indices_1{};
-  glm::uvec4 image_indices_0{};
-  glm::uvec4 image_indices_1{};
+
+
+  std::array<glm::uvec2, 4> vertex_addresses{};
+  glm::uvec4 vertex_strides{};
+  if (vertex_pulling_) {
+    for (u32 i{}; i < pulled_vertex_attributes_.size(); ++i) {
+      auto it{primitive.vertex_attributes.find(pulled_vertex_attributes_[i])};
+      if (it == primitive.vertex_attributes.end()) {
+        continue;
+      }
+
+      const ast::sc::VertexAttribute& vertex_attribute{it->second};
+      vk::DeviceAddress address{
+          gpu_->GetBufferDeviceAddress(*(vertex_attribute.buffer)) +
+          vertex_attribute.offset};
+      vertex_addresses[i] = glm::uvec2{static_cast<u32>(address),
+                                       static_cast<u32>(address >> 32)};
+      vertex_strides[i] =
+          static_cast<u32>(vertex_attribute.stride / sizeof(f32));
+    }
+  }
 
   std::vector<vk::DescriptorSetLayout> set_layouts;
 
@@ -418,6 +873,9 @@ void Subpass::CreatePipelineResources(
 
           if (shader_resource.type == ShaderResourceType::kUniformBuffer) {
             descriptor_type = vk::DescriptorType::eUniformBuffer;
+          } else if (shader_resource.type ==
+                     ShaderResourceType::kStorageBuffer) {
+            descriptor_type = vk::DescriptorType::eStorageBuffer;
           } else if (shader_resource.type ==
                      ShaderResourceType::kInputAttachment) {
             descriptor_type = vk::DescriptorType::eInputAttachment;
@@ -439,20 +897,24 @@ void Subpass::CreatePipelineResources(
         vk::DescriptorSetLayoutCreateInfo subpass_descriptor_set_layout_ci{
             {}, bindings};
 
-        subpass_descriptor_set_layout_ = &(RequestDescriptorSetLayout(
-            subpass_descriptor_set_layout_ci, name_ + "_subpass"));
+        subpass_descriptor_set_layout_ =
+            &(resource_cache_->RequestDescriptorSetLayout(
+                subpass_descriptor_set_layout_ci, name_ + "_subpass"));
 
         std::vector<vk::DescriptorSetLayout> subpass_descriptor_set_layouts(
             frame_count_, **subpass_descriptor_set_layout_);
         vk::DescriptorSetAllocateInfo subpass_descriptor_set_ai{
             nullptr, subpass_descriptor_set_layouts};
-        subpass_descriptor_sets_ = gpu_->AllocateNormalDescriptorSets(
-            subpass_descriptor_set_ai, name_ + "_subpass");
+        subpass_descriptor_sets_ =
+            gpu_->AllocateDescriptorSets(descriptor_allocator_,
+                                         subpass_descriptor_set_ai,
+                                         name_ + "_subpass");
       }
 
       // Update descriptor sets.
       if (!subpass_desciptor_set_updated_) {
         subpass_desciptor_set_updated_ = true;
+        std::vector<DescriptorUpdate> descriptor_updates(frame_count_);
         for (const auto& shader_resource : shader_resources) {
           if (shader_resource.type == ShaderResourceType::kUniformBuffer) {
             if (shader_resource.name == "Subpass") {
@@ -470,20 +932,49 @@ void Subpass::CreatePipelineResources(
 
                 vk::DescriptorBufferInfo descriptor_buffer_info{
                     *subpass_uniform_buffer, 0, sizeof(SubpassUniform)};
-
-                buffer_infos.push_back(descriptor_buffer_info);
-                vk::WriteDescriptorSet write_descriptor_set{
-                    *subpass_descriptor_sets_[i],
-                    shader_resource.binding,
-                    0,
-                    vk::DescriptorType::eUniformBuffer,
-                    nullptr,
-                    buffer_infos.back()};
+                descriptor_updates[i].AddBuffer(
+                    shader_resource.binding, vk::DescriptorType::eUniformBuffer,
+                    descriptor_buffer_info);
 
                 subpass_uniforms_[i] = subpass_uniform;
                 subpass_uniform_buffers_[i] = std::move(subpass_uniform_buffer);
+              }
+            }
+
+          } else if (shader_resource.type ==
+                     ShaderResourceType::kStorageBuffer) {
+            if (shader_resource.name == "SubpassInstance") {
+              vk::BufferCreateInfo instance_buffer_ci{
+                  {},
+                  sizeof(InstanceUniform) * instance_uniforms_.size(),
+                  vk::BufferUsageFlagBits::eStorageBuffer};
 
-                write_descriptor_sets.push_back(write_descriptor_set);
+              instance_buffer_ = gpu_->CreateBuffer(
+                  instance_buffer_ci, instance_uniforms_.data(), false,
+                  "subpass_instance");
+
+              vk::DescriptorBufferInfo descriptor_buffer_info{
+                  *instance_buffer_, 0, instance_buffer_ci.size};
+
+              for (u32 i{}; i < frame_count_; ++i) {
+                descriptor_updates[i].AddBuffer(
+                    shader_resource.binding, vk::DescriptorType::eStorageBuffer,
+                    descriptor_buffer_info);
+              }
+            } else if (shader_resource.name == "SubpassDrawElement") {
+              // Written once all draw elements are created.
+              draw_element_buffer_binding_ = shader_resource.binding;
+            } else if (shader_resource.name == "SubpassLight" ||
+                       shader_resource.name == "SubpassLightCluster") {
+              if (!light_cluster_) {
+                THROW("Subpass {} reads lights but has none", name_);
+              }
+              for (u32 i{}; i < frame_count_; ++i) {
+                descriptor_updates[i].AddBuffer(
+                    shader_resource.binding, vk::DescriptorType::eStorageBuffer,
+                    shader_resource.name == "SubpassLight"
+                        ? light_cluster_->GetLightBufferInfo()
+                        : light_cluster_->GetClusterBufferInfo(i));
               }
             }
 
@@ -496,166 +987,43 @@ void Subpass::CreatePipelineResources(
                                                      .input_attachment_index]};
               vk::DescriptorImageInfo descriptor_image_info{
                   nullptr, image_view, vk::ImageLayout::eShaderReadOnlyOptimal};
-              image_infos.push_back(descriptor_image_info);
-
-              vk::WriteDescriptorSet write_descriptor_set{
-                  *subpass_descriptor_sets_[i], shader_resource.binding, 0,
-                  vk::DescriptorType::eInputAttachment, image_infos.back()};
-
-              write_descriptor_sets.push_back(write_descriptor_set);
+              descriptor_updates[i].AddImage(
+                  shader_resource.binding, vk::DescriptorType::eInputAttachment,
+                  descriptor_image_info);
+              size_dependent_descriptors_.push_back(
+                  {subpass_descriptor_sets_[i], i, shader_resource.binding,
+                   vk::DescriptorType::eInputAttachment,
+                   shader_resource.input_attachment_index});
             }
           }
         }
+
+        for (u32 i{}; i < frame_count_; ++i) {
+          descriptor_updates[i].Update(*gpu_, *resource_cache_,
+                                       subpass_descriptor_sets_[i],
+                                       **subpass_descriptor_set_layout_, name_);
+        }
       }
 
       descriptor_set_layout = subpass_descriptor_set_layout_;
 
     } else if (resource_name.find("bindless") != std::string::npos) {
-      if (!has_bindless_descriptor_set_) {
-        // Create descriptor set layout.
-        has_bindless_descriptor_set_ = true;
-        bindless_descriptor_set_index_ = set;
-
-        std::vector<vk::DescriptorSetLayoutBinding> bindings{
-            {0, vk::DescriptorType::eSampler, kBindlessSamplerMaxCount,
-             vk::ShaderStageFlagBits::eAll},
-            {1, vk::DescriptorType::eSampledImage, kBindlessImageMaxCount,
-             vk::ShaderStageFlagBits::eAll}};
-
-        std::vector<vk::DescriptorBindingFlags> binding_flags(
-            2, vk::DescriptorBindingFlagBits::ePartiallyBound);
-
-        vk::DescriptorSetLayoutBindingFlagsCreateInfo binding_flags_ci{
-            binding_flags};
-
-        vk::DescriptorSetLayoutCreateInfo bindless_descriptor_set_layout_ci{
-            vk::DescriptorSetLayoutCreateFlagBits::eUpdateAfterBindPool,
-            bindings, &binding_flags_ci};
-        bindless_descriptor_set_layout_ = &(RequestDescriptorSetLayout(
-            bindless_descriptor_set_layout_ci, name_ + "_bindless"));
-
-        // Allocate descriptor set.
-        vk::DescriptorSetAllocateInfo bindless_descriptor_set_ai{
-            nullptr, **bindless_descriptor_set_layout_};
-        bindless_descriptor_set_ = gpu_->AllocateBindlessDescriptorSet(
-            bindless_descriptor_set_ai, name_ + "_bindless");
-      }
-
-      // Update descriptor set.
-      if (has_scene_) {
-        const std::map<std::string, ast::sc::Texture*>& textures{
-            primitive.material->GetTextures()};
-
-        i32 idx{};
-        for (const auto& wanted_texture : wanted_textures_) {
-          auto bindless_samplers_it{
-              name_shader_resources.find("bindless_samplers")};
-          auto bindless_images_it{
-              name_shader_resources.find("bindless_images")};
-          auto wanted_texture_it{textures.find(wanted_texture)};
-
-          if (bindless_samplers_it != name_shader_resources.end() &&
-              bindless_images_it != name_shader_resources.end() &&
-              wanted_texture_it != textures.end()) {
-            const ShaderResource& bindless_samplers_shader_resource{
-                bindless_samplers_it->second};
-            const ShaderResource& bindless_images_shader_resource{
-                bindless_images_it->second};
-            ast::sc::Texture* tex{wanted_texture_it->second};
-
-            const ast::sc::Sampler* ast_sampler{tex->GetSampler()};
-            u64 sampler_hash_value{};
-            HashCombine(sampler_hash_value, ast_sampler);
-            auto it2{sampler_indices_.find(sampler_hash_value)};
-
-            u32 cur_sampler_index{};
-            if (it2 != sampler_indices_.end()) {
-              cur_sampler_index = it2->second;
-            } else {
-              const vk::raii::Sampler& sampler{ast_sampler->GetSampler()};
-
-              vk::DescriptorImageInfo descriptor_sampler_info{*sampler};
-              sampler_infos.push_back(descriptor_sampler_info);
-
-              cur_sampler_index = bindless_sampler_index_++;
-
-              if (cur_sampler_index >= kBindlessImageMaxCount) {
-                THROW(
-                    "cur_sampler_index ({}) exceeds kBindlessImageMaxCount "
-                    "({})",
-                    cur_sampler_index, kBindlessImageMaxCount);
-              }
-
-              vk::WriteDescriptorSet write_descriptor_set{
-                  *(bindless_descriptor_set_),
-                  bindless_samplers_shader_resource.binding, cur_sampler_index,
-                  vk::DescriptorType::eSampler, sampler_infos.back()};
-
-              write_descriptor_sets.push_back(write_descriptor_set);
-
-              sampler_indices_.emplace(sampler_hash_value, cur_sampler_index);
-            }
-
-            const ast::sc::Image* ast_image{tex->GetImage()};
-
-            u64 image_hash_value{};
-            HashCombine(image_hash_value, ast_image);
-            auto it3{image_indices_.find(image_hash_value)};
-
-            u32 cur_image_index{};
-            if (it3 != image_indices_.end()) {
-              cur_image_index = it3->second;
-            } else {
-              const vk::raii::ImageView& image_view{ast_image->GetImageView()};
-
-              vk::DescriptorImageInfo descriptor_image_info{
-                  nullptr, *image_view,
-                  vk::ImageLayout::eShaderReadOnlyOptimal};
-              image_infos.push_back(descriptor_image_info);
-
-              cur_image_index = bindless_image_index_++;
-
-              if (cur_image_index >= kBindlessImageMaxCount) {
-                THROW(
-                    "cur_image_index ({}) exceeds kBindlessImageMaxCount ({})",
-                    cur_image_index, kBindlessImageMaxCount);
-              }
-
-              vk::WriteDescriptorSet write_descriptor_set{
-                  *bindless_descriptor_set_,
-                  bindless_images_shader_resource.binding, cur_image_index,
-                  vk::DescriptorType::eSampledImage, image_infos.back()};
-
-              write_descriptor_sets.push_back(write_descriptor_set);
-
-              image_indices_.emplace(image_hash_value, cur_image_index);
-            }
-
-            if (idx < 4) {
-              sampler_indices_0[idx] = cur_sampler_index;
-              image_indices_0[idx] = cur_image_index;
-            } else {
-              sampler_indices_1[idx - 4] = cur_sampler_index;
-              image_indices_1[idx - 4] = cur_image_index;
-            }
-          }
-          ++idx;
-        }
-      }
-
-      descriptor_set_layout = bindless_descriptor_set_layout_;
+      // The device-wide table, textures and materials got their slots when
+      // they were created.
+      has_bindless_descriptor_set_ = true;
+      bindless_descriptor_set_index_ = set;
+      descriptor_set_layout = &(gpu_->GetBindlessDescriptorSetLayout());
     } else {
       // Create descriptor set layout.
       draw_element_descriptor_set_index_ =
           std::min(draw_element_descriptor_set_index_, set);
       std::vector<vk::DescriptorSetLayoutBinding> bindings;
+      // Per draw data lives in the subpass draw element buffer, these sets
+      // only hold shared images.
       for (const auto& shader_resource : shader_resources) {
         vk::DescriptorType descriptor_type{};
 
-        if (shader_resource.type == ShaderResourceType::kUniformBuffer) {
-          descriptor_type = vk::DescriptorType::eUniformBuffer;
-        } else if (shader_resource.type ==
-                   ShaderResourceType::kCombinedImageSampler) {
+        if (shader_resource.type == ShaderResourceType::kCombinedImageSampler) {
           descriptor_type = vk::DescriptorType::eCombinedImageSampler;
         } else {
           THROW("Unsupport descriptor type");
@@ -675,8 +1043,8 @@ void Subpass::CreatePipelineResources(
           {}, bindings};
 
       const vk::raii::DescriptorSetLayout* draw_element_descriptor_set_layout =
-          &(RequestDescriptorSetLayout(draw_element_descriptor_set_layout_ci,
-                                       name_ + "_draw_element"));
+          &(resource_cache_->RequestDescriptorSetLayout(
+              draw_element_descriptor_set_layout_ci, name_ + "_draw_element"));
 
       descriptor_set_layout = draw_element_descriptor_set_layout;
 
@@ -686,68 +1054,17 @@ void Subpass::CreatePipelineResources(
         vk::DescriptorSetAllocateInfo draw_element_descriptor_set_ai{
             nullptr, **draw_element_descriptor_set_layout};
 
-        vk::raii::DescriptorSets draw_element_descriptor_sets{
-            gpu_->AllocateNormalDescriptorSets(draw_element_descriptor_set_ai,
-                                               name_ + "_draw_element")};
-
-        draw_element.descriptor_sets.push_back(
-            std::move(draw_element_descriptor_sets));
+        draw_element.descriptor_sets.push_back(gpu_->AllocateDescriptorSets(
+            descriptor_allocator_, draw_element_descriptor_set_ai,
+            name_ + "_draw_element"));
       }
 
       // Update descriptor sets.
+      std::vector<DescriptorUpdate> descriptor_updates(frame_count_);
       for (const auto& shader_resource : shader_resources) {
-        if (shader_resource.type == ShaderResourceType::kUniformBuffer) {
-          if (shader_resource.name == "DrawElement") {
-            for (u32 i{}; i < frame_count_; ++i) {
-              DrawElementUniform draw_element_uniform{
-                  model_matrix,
-                  inverse_model_matrix,
-                  sampler_indices_0,
-                  sampler_indices_1,
-                  image_indices_0,
-                  image_indices_1,
-                  primitive.material->GetBaseColorFactor(),
-                  primitive.material->GetMetallicFactor(),
-                  primitive.material->GetRoughnessFactor(),
-                  primitive.material->GetNormalScale(),
-                  primitive.material->GetOcclusionStrength(),
-                  glm::vec4{primitive.material->GetEmissiveFactor(), 1.0F},
-                  primitive.material->GetAlphaCutoff()};
-
-              vk::BufferCreateInfo uniform_buffer_ci{
-                  {},
-                  sizeof(DrawElementUniform),
-                  vk::BufferUsageFlagBits::eUniformBuffer};
-
-              gpu::Buffer draw_element_uniform_buffer{
-                  gpu_->CreateBuffer(uniform_buffer_ci, &draw_element_uniform,
-                                     false, "draw_element_uniform")};
-
-              vk::DescriptorBufferInfo descriptor_buffer_info{
-                  *draw_element_uniform_buffer, 0, sizeof(DrawElementUniform)};
-              buffer_infos.push_back(descriptor_buffer_info);
-
-              vk::WriteDescriptorSet write_descriptor_set{
-                  *(draw_element
-                        .descriptor_sets[i]
-                                        [shader_resource.set -
-                                         draw_element_descriptor_set_index_]),
-                  shader_resource.binding,
-                  0,
-                  vk::DescriptorType::eUniformBuffer,
-                  nullptr,
-                  buffer_infos.back()};
-
-              draw_element.uniforms.push_back(draw_element_uniform);
-              draw_element.uniform_buffers.push_back(
-                  std::move(draw_element_uniform_buffer));
-
-              write_descriptor_sets.push_back(write_descriptor_set);
-            }
-          }
-        } else if (shader_resource.type ==
-                   ShaderResourceType::kCombinedImageSampler) {
+        if (shader_resource.type == ShaderResourceType::kCombinedImageSampler) {
           need_resize_ = true;
+          shared_image_names_.insert(shader_resource.name);
           for (u32 i{}; i < frame_count_; ++i) {
             vk::ImageView image_view{nullptr};
 
@@ -761,39 +1078,37 @@ void Subpass::CreatePipelineResources(
             vk::DescriptorImageInfo descriptor_image_info{
                 *(gpu_->GetSampler()), image_view,
                 vk::ImageLayout::eShaderReadOnlyOptimal};
-            image_infos.push_back(descriptor_image_info);
-
-            vk::WriteDescriptorSet write_descriptor_set{
-                *(draw_element
-                      .descriptor_sets[i][shader_resource.set -
-                                          draw_element_descriptor_set_index_]),
-                shader_resource.binding, 0,
-                vk::DescriptorType::eCombinedImageSampler, image_infos.back()};
-
-            write_descriptor_sets.push_back(write_descriptor_set);
+            descriptor_updates[i].AddImage(
+                shader_resource.binding,
+                vk::DescriptorType::eCombinedImageSampler,
+                descriptor_image_info);
+            size_dependent_descriptors_.push_back(
+                {draw_element.descriptor_sets[i].front(), i,
+                 shader_resource.binding,
+                 vk::DescriptorType::eCombinedImageSampler, 0,
+                 shader_resource.name});
           }
         }
       }
+
+      // Each draw element owns a single set.
+      for (u32 i{}; i < frame_count_; ++i) {
+        descriptor_updates[i].Update(
+            *gpu_, *resource_cache_, draw_element.descriptor_sets[i].front(),
+            **draw_element_descriptor_set_layout, name_ + "_draw_element");
+      }
     }
 
     set_layouts.push_back(**descriptor_set_layout);
   }
 
-  if (sampler_infos.size() >= kSamplerInfoMaxCount) {
-    THROW("The size of sampler_infos ({}) exceeds kSamplerInfoMaxCount ({})",
-          sampler_infos.size(), kSamplerInfoMaxCount);
-  }
-  if (image_infos.size() >= kImageInfoMaxCount) {
-    THROW("The size of image_infos ({}) exceeds kImageInfoMaxCount ({})",
-          image_infos.size(), kImageInfoMaxCount);
-  }
-  if (buffer_infos.size() >= kBufferInfoMaxCount) {
-    THROW("The size of buffer_infos ({}) exceeds kBufferInfoMaxCount ({})",
-          buffer_infos.size(), kBufferInfoMaxCount);
+  if (has_scene_) {
+    draw_element_uniforms_.push_back(DrawElementUniform{
+        glm::uvec4{vertex_addresses[0], vertex_addresses[1]},
+        glm::uvec4{vertex_addresses[2], vertex_addresses[3]}, vertex_strides,
+        primitive.material->GetMaterialIndex()});
   }
 
-  gpu_->UpdateDescriptorSets(write_descriptor_sets);
-
   // Pipeline layouts.
   vk::PipelineLayoutCreateInfo pipeline_layout_ci;
 
@@ -803,46 +1118,40 @@ void Subpass::CreatePipelineResources(
 
   if (!push_constant_ranges.empty()) {
     has_push_constant_ = true;
+    push_constant_ranges_ = push_constant_ranges;
     pipeline_layout_ci.setPushConstantRanges(push_constant_ranges);
   }
 
   const vk::raii::PipelineLayout& pipeline_layout{
-      RequestPipelineLayout(pipeline_layout_ci, name_)};
+      resource_cache_->RequestPipelineLayout(pipeline_layout_ci, name_)};
 
   draw_element.pipeline_layout = &pipeline_layout;
 }
 
-void Subpass::CreatePipeline(
+void Subpass::PreparePipeline(
     const ast::sc::Primitive& primitive,
     const std::vector<const SPIRV*>& spirvs,
     const std::unordered_map<std::string, ShaderResource>&
         name_shader_resources,
     DrawElement& draw_element) {
-  std::vector<vk::PipelineShaderStageCreateInfo> shader_stage_cis;
-  u64 pipeline_hash_value{};
-  for (const auto* spirv_shader : spirvs) {
-    u64 shader_module_hash_value{spirv_shader->GetHashValue()};
-    HashCombine(pipeline_hash_value, shader_module_hash_value);
-
-    const std::vector<u32>& spirv{spirv_shader->GetSpirv()};
-
-    vk::ShaderModuleCreateInfo shader_module_ci{
-        {}, spirv.size() * 4, spirv.data()};
-    const vk::raii::ShaderModule& shader_module{
-        RequestShaderModule(shader_module_ci, shader_module_hash_value, name_)};
-
-    vk::PipelineShaderStageCreateInfo shader_stage_ci{
-        {}, spirv_shader->GetStage(), *shader_module, "main", nullptr};
-
-    shader_stage_cis.push_back(shader_stage_ci);
-  }
-
-  vk::PipelineVertexInputStateCreateInfo vertex_input_state_ci;
-  std::vector<vk::VertexInputBindingDescription>
-      vertex_input_binding_descriptions;
-  std::vector<vk::VertexInputAttributeDescription>
-      vertex_input_attribute_descriptions;
-  if (has_scene_) {
+  PipelineRequest pipeline_request{};
+  pipeline_request.primitive = &primitive;
+  pipeline_request.spirvs = spirvs;
+  pipeline_request.pipeline_layout = **(draw_element.pipeline_layout);
+
+  std::vector<vk::VertexInputBindingDescription>&
+      vertex_input_binding_descriptions{
+          pipeline_request.vertex_input_binding_descriptions};
+  std::vector<vk::VertexInputAttributeDescription>&
+      vertex_input_attribute_descriptions{
+          pipeline_request.vertex_input_attribute_descriptions};
+
+  if (vertex_pulling_) {
+    // Attributes are fetched through buffer device addresses in the vertex
+    // shader, the vertex input state stays empty.
+    draw_element.vertex_count =
+        primitive.vertex_attributes.at("POSITION").count;
+  } else if (has_scene_) {
     std::map<u32, const ast::sc::VertexAttribute*> vertex_location_attributes;
     for (const auto& vertex_buffer_attribute : primitive.vertex_attributes) {
       std::string name{vertex_buffer_attribute.first};
@@ -894,249 +1203,303 @@ void Subpass::CreatePipeline(
       draw_element.vertex_infos.push_back(
           DrawElmentVertexInfo{splited.front(), buffers, offsets});
     }
-
-    if (primitive.has_index) {
-      draw_element.has_index = true;
-      draw_element.index_attribute = &(primitive.index_attribute);
-    }
-    vertex_input_state_ci.setVertexBindingDescriptions(
-        vertex_input_binding_descriptions);
-    vertex_input_state_ci.setVertexAttributeDescriptions(
-        vertex_input_attribute_descriptions);
   }
 
-  vk::PipelineInputAssemblyStateCreateInfo input_assembly_state_ci{
-      {}, vk::PrimitiveTopology::eTriangleList};
+  if (has_scene_ && primitive.has_index) {
+    draw_element.has_index = true;
+    draw_element.index_attribute = &(primitive.index_attribute);
+  }
 
-  vk::PipelineViewportStateCreateInfo viewport_state_ci{
-      {}, 1, nullptr, 1, nullptr};
+  std::unordered_map<std::string, u32> specialization_values{
+      GetSpecializationValues(primitive)};
+  for (const auto* spirv_shader : spirvs) {
+    std::vector<vk::SpecializationMapEntry> specialization_map_entries;
+    std::vector<u32> specialization_data;
+    for (const auto& specialization_constant :
+         spirv_shader->GetSpecializationConstants()) {
+      auto it{specialization_values.find(specialization_constant.name)};
+      if (it == specialization_values.end()) {
+        continue;
+      }
+      specialization_map_entries.emplace_back(
+          specialization_constant.constant_id,
+          static_cast<u32>(specialization_data.size() * sizeof(u32)),
+          sizeof(u32));
+      specialization_data.push_back(it->second);
+
+      HashCombine(pipeline_request.hash_value,
+                  specialization_constant.constant_id);
+      HashCombine(pipeline_request.hash_value, it->second);
+    }
+    pipeline_request.specialization_map_entries.push_back(
+        std::move(specialization_map_entries));
+    pipeline_request.specialization_data.push_back(
+        std::move(specialization_data));
 
-  vk::PipelineRasterizationStateCreateInfo rasterization_state_ci{
-      {},
-      VK_FALSE,
-      VK_FALSE,
-      vk::PolygonMode::eFill,
-      vk::CullModeFlagBits::eBack,
-      vk::FrontFace::eCounterClockwise,
-      VK_FALSE,
-      0.0F,
-      0.0F,
-      0.0F,
-      1.0F};
+    HashCombine(pipeline_request.hash_value, spirv_shader->GetHashValue());
+  }
+  HashCombine(pipeline_request.hash_value, GetRasterizationState(primitive));
 
-  if (!has_scene_ || primitive.material->GetDoubleSided()) {
-    rasterization_state_ci.cullMode = vk::CullModeFlagBits::eNone;
+  // Pipelines are shared by all subpasses, so the hash also covers every other
+  // state the pipeline is created with.
+  for (const auto& vertex_input_binding_description :
+       vertex_input_binding_descriptions) {
+    HashCombine(pipeline_request.hash_value, vertex_input_binding_description);
+  }
+  for (const auto& vertex_input_attribute_description :
+       vertex_input_attribute_descriptions) {
+    HashCombine(pipeline_request.hash_value,
+                vertex_input_attribute_description);
   }
+  HashCombine(pipeline_request.hash_value, pipeline_request.pipeline_layout);
+  HashCombine(pipeline_request.hash_value, render_pass_);
+  HashCombine(pipeline_request.hash_value, subpass_index_);
+  HashCombine(pipeline_request.hash_value, color_attachment_count_);
+  HashCombine(pipeline_request.hash_value, scene_ == "transparency");
 
-  vk::PipelineMultisampleStateCreateInfo multisample_state_ci{
-      {}, vk::SampleCountFlagBits::e1};
+  pipeline_requests_.push_back(std::move(pipeline_request));
+}
 
-  vk::PipelineDepthStencilStateCreateInfo depth_stencil_state_ci{
-      {}, VK_TRUE, VK_TRUE, vk::CompareOp::eLess, VK_FALSE, VK_FALSE,
-  };
+void Subpass::CreatePipelines() {
+  RequestPipelines(true);
 
-  u32 blend_enable{VK_FALSE};
-  if (scene_ == "transparency") {
-    blend_enable = VK_TRUE;
+  for (u32 i{}; i < draw_elements_.size(); ++i) {
+    draw_elements_[i].pipeline_hash_value = pipeline_requests_[i].hash_value;
+    draw_elements_[i].pipeline =
+        &resource_cache_->GetPipeline(pipeline_requests_[i].hash_value);
   }
 
-  vk::ColorComponentFlags color_component_flags{
-      vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG |
-      vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA};
-  std::vector<vk::PipelineColorBlendAttachmentState>
-      color_blend_attachment_states(
-          color_attachment_count_,
-          vk::PipelineColorBlendAttachmentState{
-              blend_enable, vk::BlendFactor::eSrcAlpha,
-              vk::BlendFactor::eOneMinusSrcAlpha, vk::BlendOp::eAdd,
-              vk::BlendFactor::eOne, vk::BlendFactor::eZero, vk::BlendOp::eAdd,
-              color_component_flags});
+  pipeline_requests_.clear();
+}
 
-  vk::PipelineColorBlendStateCreateInfo color_blend_state_ci{
-      {},
-      VK_FALSE,
-      vk::LogicOp::eCopy,
-      color_blend_attachment_states,
-      {{0.0F, 0.0F, 0.0F, 0.0F}}};
+void Subpass::RequestPipelines(bool in_parallel) {
+  // Every pipeline not created yet is requested once, the first draw element
+  // using it provides the create info.
+  pending_pipeline_requests_.clear();
+  std::unordered_set<u64> requested_hash_values;
+  for (u32 i{}; i < pipeline_requests_.size(); ++i) {
+    PipelineRequest& pipeline_request{pipeline_requests_[i]};
+    if (resource_cache_->HasPipeline(pipeline_request.hash_value) ||
+        !requested_hash_values.insert(pipeline_request.hash_value).second) {
+      continue;
+    }
 
-  std::array<vk::DynamicState, 2> dynamic_states{vk::DynamicState::eViewport,
-                                                 vk::DynamicState::eScissor};
-  vk::PipelineDynamicStateCreateInfo dynamic_state_ci{{}, dynamic_states};
+    for (const auto* spirv_shader : pipeline_request.spirvs) {
+      const std::vector<u32>& spirv{spirv_shader->GetSpirv()};
 
-  vk::GraphicsPipelineCreateInfo graphics_pipeline_ci{
-      {},
-      shader_stage_cis,
-      &vertex_input_state_ci,
-      &input_assembly_state_ci,
-      nullptr,
-      &viewport_state_ci,
-      &rasterization_state_ci,
-      &multisample_state_ci,
-      &depth_stencil_state_ci,
-      &color_blend_state_ci,
-      &dynamic_state_ci,
-      **(draw_element.pipeline_layout),
-      render_pass_,
-      subpass_index_};
-
-  const vk::raii::Pipeline& pipeline{
-      RequestPipeline(graphics_pipeline_ci, pipeline_hash_value, name_)};
-  draw_element.pipeline = &pipeline;
-}
+      vk::ShaderModuleCreateInfo shader_module_ci{
+          {}, spirv.size() * 4, spirv.data()};
+      const vk::raii::ShaderModule& shader_module{
+          resource_cache_->RequestShaderModule(
+              shader_module_ci, spirv_shader->GetHashValue(), name_)};
 
-const SPIRV& Subpass::RequestSpirv(const ast::Shader& shader,
-                                   const std::vector<std::string>& processes,
-                                   vk::ShaderStageFlagBits shader_stage) {
-  u64 hash_value{shader.GetHashValue(processes)};
+      pipeline_request.shader_modules.push_back(*shader_module);
+    }
 
-  auto it{spirv_shaders_.find(hash_value)};
-  if (it != spirv_shaders_.end()) {
-    return it->second;
+    pending_pipeline_requests_.push_back(i);
   }
 
-  std::filesystem::path root_path{GetPath(LUKA_ROOT_PATH)};
-  std::filesystem::path cache_path{root_path / ".cache" / "engine"};
-  std::filesystem::path spirv_cache_file{
-      cache_path / ("spirv_" + std::to_string(hash_value) + ".cache")};
-
-  std::vector<u32> spirv_cache_data;
-  if (std::filesystem::exists(spirv_cache_file)) {
-    spirv_cache_data = LoadBinaryU32(spirv_cache_file);
-  } else {
-    spirv_cache_data = shader.CompileToSpirv(processes);
-    if (!std::filesystem::exists(cache_path)) {
-      std::filesystem::create_directories(cache_path);
+  if (!pending_pipeline_requests_.empty()) {
+    // Every thread creates pipelines through a cache of its own, seeded with
+    // the device cache and merged back into it once all are created.
+    std::vector<u8> pipeline_cache_data{gpu_->GetPipelineCacheData()};
+    vk::PipelineCacheCreateInfo pipeline_cache_ci{
+        {}, pipeline_cache_data.size(), pipeline_cache_data.data()};
+
+    u32 pipeline_count{static_cast<u32>(pending_pipeline_requests_.size())};
+    bool parallel{in_parallel && pipeline_count > 1};
+    u32 thread_count{parallel ? task_scheduler_->GetThreadCount() : 1};
+    for (u32 i{}; i < thread_count; ++i) {
+      thread_pipeline_caches_.push_back(gpu_->CreatePipelineCache(
+          pipeline_cache_ci, name_, static_cast<i32>(i)));
     }
-    SaveBinaryU32(spirv_cache_data, spirv_cache_file);
-  }
 
-  SPIRV spirv{spirv_cache_data, shader_stage, hash_value};
+    if (parallel) {
+      PipelineTaskSet pipeline_task_set{this, pipeline_count};
+      task_scheduler_->AddTaskSetToPipe(&pipeline_task_set);
+      task_scheduler_->WaitforTask(&pipeline_task_set);
+    } else {
+      for (u32 i{}; i < pipeline_count; ++i) {
+        CreatePipeline(i, 0);
+      }
+    }
 
-  auto it1{spirv_shaders_.emplace(hash_value, std::move(spirv))};
+    gpu_->MergePipelineCaches(thread_pipeline_caches_);
+    thread_pipeline_caches_.clear();
+  }
 
-  return it1.first->second;
+  pending_pipeline_requests_.clear();
 }
 
-const vk::raii::DescriptorSetLayout& Subpass::RequestDescriptorSetLayout(
-    const vk::DescriptorSetLayoutCreateInfo& descriptor_set_layout_ci,
-    const std::string& name, i32 index) {
-  u64 hash_value{};
-  HashCombine(hash_value, descriptor_set_layout_ci.flags);
-  for (u32 i{}; i < descriptor_set_layout_ci.bindingCount; ++i) {
-    HashCombine(hash_value, descriptor_set_layout_ci.pBindings[i]);
+void Subpass::AssignPipelineIds() {
+  std::unordered_map<const vk::raii::Pipeline*, u32> pipeline_ids;
+  for (auto& draw_element : draw_elements_) {
+    draw_element.pipeline_id =
+        pipeline_ids
+            .emplace(draw_element.pipeline,
+                     static_cast<u32>(pipeline_ids.size()))
+            .first->second;
   }
+}
 
-  auto it{descriptor_set_layouts_.find(hash_value)};
-  if (it != descriptor_set_layouts_.end()) {
-    return it->second;
+bool Subpass::UsesShader(const std::vector<u32>& shader_indices) const {
+  for (const auto& stage_shader : *shaders_) {
+    if (std::find(shader_indices.begin(), shader_indices.end(),
+                  stage_shader.second) != shader_indices.end()) {
+      return true;
+    }
   }
+  return false;
+}
 
-  vk::raii::DescriptorSetLayout descriptor_set_layout{
-      gpu_->CreateDescriptorSetLayout(descriptor_set_layout_ci, name, index)};
+void Subpass::ReloadPipelines() {
+  // Runs inside a single background task, pipelines are created one after
+  // another so the render loop never waits for them.
+  reloaded_pipeline_hash_values_.clear();
+  pipeline_requests_.clear();
 
-  auto it1{descriptor_set_layouts_.emplace(hash_value,
-                                           std::move(descriptor_set_layout))};
+  if (light_cluster_) {
+    light_cluster_->ReloadPipeline();
+  }
 
-  return it1.first->second;
-}
+  try {
+    for (const auto& draw_element : draw_elements_) {
+      std::vector<const SPIRV*> spirvs;
+      std::unordered_map<std::string, ShaderResource> name_shader_resources;
+      std::unordered_map<u32, std::vector<ShaderResource>>
+          set_shader_resources;
+      std::vector<u32> sorted_sets;
+      std::vector<vk::PushConstantRange> push_constant_ranges;
+      ParseShaderResources(*(draw_element.primitive), spirvs,
+                           name_shader_resources, set_shader_resources,
+                           sorted_sets, push_constant_ranges);
+
+      // Descriptor sets and vertex buffers are bound as before, a shader
+      // changing them needs the draw elements to be created again.
+      if (HashShaderInterface(name_shader_resources) !=
+          draw_element.interface_hash_value) {
+        LOGW("Shader interface of subpass {} changes, restart to apply it",
+             name_);
+        pipeline_requests_.clear();
+        return;
+      }
 
-const vk::raii::PipelineLayout& Subpass::RequestPipelineLayout(
-    const vk::PipelineLayoutCreateInfo& pipeline_layout_ci,
-    const std::string& name, i32 index) {
-  u64 hash_value{};
-  HashCombine(hash_value, pipeline_layout_ci.flags);
-  for (u32 i{}; i < pipeline_layout_ci.setLayoutCount; ++i) {
-    HashCombine(hash_value, pipeline_layout_ci.pSetLayouts[i]);
+      DrawElement reloaded_draw_element{};
+      reloaded_draw_element.pipeline_layout = draw_element.pipeline_layout;
+      PreparePipeline(*(draw_element.primitive), spirvs,
+                      name_shader_resources, reloaded_draw_element);
+    }
+
+    RequestPipelines(false);
+  } catch (const Exception&) {
+    LOGW("Fail to reload pipelines of subpass {}", name_);
+    pending_pipeline_requests_.clear();
+    thread_pipeline_caches_.clear();
+    pipeline_requests_.clear();
+    return;
   }
-  for (u32 i{}; i < pipeline_layout_ci.pushConstantRangeCount; ++i) {
-    HashCombine(hash_value, pipeline_layout_ci.pPushConstantRanges[i]);
+
+  for (const auto& pipeline_request : pipeline_requests_) {
+    reloaded_pipeline_hash_values_.push_back(pipeline_request.hash_value);
   }
+  pipeline_requests_.clear();
+}
 
-  auto it{pipeline_layouts_.find(hash_value)};
-  if (it != pipeline_layouts_.end()) {
-    return it->second;
+void Subpass::SwapPipelines(std::unordered_set<u64>& replaced_hash_values) {
+  if (light_cluster_) {
+    light_cluster_->SwapPipeline(replaced_hash_values);
   }
 
-  vk::raii::PipelineLayout pipeline_layout{
-      gpu_->CreatePipelineLayout(pipeline_layout_ci, name, index)};
+  if (reloaded_pipeline_hash_values_.size() != draw_elements_.size()) {
+    reloaded_pipeline_hash_values_.clear();
+    return;
+  }
 
-  auto it1{pipeline_layouts_.emplace(hash_value, std::move(pipeline_layout))};
+  bool swapped{false};
+  for (u32 i{}; i < draw_elements_.size(); ++i) {
+    DrawElement& draw_element{draw_elements_[i]};
+    u64 hash_value{reloaded_pipeline_hash_values_[i]};
+    if (draw_element.pipeline_hash_value == hash_value) {
+      continue;
+    }
 
-  return it1.first->second;
-}
+    replaced_hash_values.insert(draw_element.pipeline_hash_value);
+    draw_element.pipeline_hash_value = hash_value;
+    draw_element.pipeline = &resource_cache_->GetPipeline(hash_value);
+    swapped = true;
+  }
+  reloaded_pipeline_hash_values_.clear();
 
-const vk::raii::ShaderModule& Subpass::RequestShaderModule(
-    const vk::ShaderModuleCreateInfo& shader_module_ci, u64 hash_value,
-    const std::string& name, i32 index) {
-  auto it{shader_modules_.find(hash_value)};
-  if (it != shader_modules_.end()) {
-    return it->second;
+  if (swapped) {
+    AssignPipelineIds();
+    // Recorded command buffers still reference the old pipelines.
+    ++draw_element_version_;
   }
+}
 
-  vk::raii::ShaderModule shader_module{
-      gpu_->CreateShaderModule(shader_module_ci, name, index)};
+vk::PipelineRasterizationStateCreateInfo Subpass::GetRasterizationState(
+    const ast::sc::Primitive& primitive) const {
+  vk::PipelineRasterizationStateCreateInfo rasterization_state_ci{
+      {},
+      VK_FALSE,
+      VK_FALSE,
+      vk::PolygonMode::eFill,
+      vk::CullModeFlagBits::eBack,
+      vk::FrontFace::eCounterClockwise,
+      VK_FALSE,
+      0.0F,
+      0.0F,
+      0.0F,
+      1.0F};
 
-  auto it1{shader_modules_.emplace(hash_value, std::move(shader_module))};
+  if (!has_scene_ || primitive.material->GetDoubleSided()) {
+    rasterization_state_ci.cullMode = vk::CullModeFlagBits::eNone;
+  }
 
-  return it1.first->second;
+  return rasterization_state_ci;
 }
 
-const vk::raii::Pipeline& Subpass::RequestPipeline(
-    const vk::GraphicsPipelineCreateInfo& graphics_pipeline_ci, u64 hash_value,
-    const std::string& name, i32 index) {
-  HashCombine(hash_value, *(graphics_pipeline_ci.pRasterizationState));
-  auto it{pipelines_.find(hash_value)};
-  if (it != pipelines_.end()) {
-    return it->second;
-  }
-
-  vk::PipelineCacheCreateInfo pipeline_cache_ci;
-
-  std::filesystem::path root_path{GetPath(LUKA_ROOT_PATH)};
-  std::filesystem::path cache_path{root_path / ".cache" / "engine"};
-  std::filesystem::path pipeline_cache_file{
-      cache_path / ("pipeline_" + std::to_string(hash_value) + ".cache")};
-  std::vector<u8> pipeline_cache_data;
-
-  bool has_cache{};
-  if (std::filesystem::exists(pipeline_cache_file)) {
-    pipeline_cache_data = LoadBinaryU8(pipeline_cache_file);
-
-    vk::PipelineCacheHeaderVersionOne* header_version_one{
-        reinterpret_cast<vk::PipelineCacheHeaderVersionOne*>(
-            pipeline_cache_data.data())};
-    vk::PhysicalDeviceProperties physical_device_properties{
-        gpu_->GetPhysicalDeviceProperties()};
-
-    if (header_version_one->headerSize > 0 &&
-        header_version_one->headerVersion ==
-            vk::PipelineCacheHeaderVersion::eOne &&
-        header_version_one->vendorID == physical_device_properties.vendorID &&
-        header_version_one->deviceID == physical_device_properties.deviceID) {
-      has_cache = true;
-
-      pipeline_cache_ci.initialDataSize = pipeline_cache_data.size();
-      pipeline_cache_ci.pInitialData = pipeline_cache_data.data();
+void Subpass::PushConstantBytes(const vk::raii::CommandBuffer& command_buffer,
+                                vk::PipelineLayout pipeline_layout, u32 offset,
+                                u32 size, const void* data) const {
+  // Ranges come from reflection, only bytes a shader declares are pushed and
+  // each with the stages of the range it falls in.
+  const u8* bytes{static_cast<const u8*>(data)};
+  for (const auto& push_constant_range : push_constant_ranges_) {
+    u32 begin{std::max(offset, push_constant_range.offset)};
+    u32 end{std::min(offset + size,
+                     push_constant_range.offset + push_constant_range.size)};
+    if (begin >= end) {
+      continue;
     }
+    command_buffer.pushConstants<u8>(
+        pipeline_layout, push_constant_range.stageFlags, begin,
+        vk::ArrayProxy<const u8>{end - begin, bytes + (begin - offset)});
   }
+}
 
-  vk::raii::PipelineCache pipeline_cache{
-      gpu_->CreatePipelineCache(pipeline_cache_ci, name, index)};
-
-  vk::raii::Pipeline pipeline{
-      gpu_->CreatePipeline(graphics_pipeline_ci, pipeline_cache, name, index)};
+SpirvTaskSet::SpirvTaskSet(Subpass* subpass, u32 spirv_count)
+    : subpass_{subpass} {
+  m_SetSize = spirv_count;
+}
 
-  if (!has_cache) {
-    std::vector<u8> pipeline_cache_data{pipeline_cache.getData()};
-    if (!std::filesystem::exists(cache_path)) {
-      std::filesystem::create_directories(cache_path);
-    }
-    SaveBinaryU8(pipeline_cache_data, pipeline_cache_file);
+void SpirvTaskSet::ExecuteRange(enki::TaskSetPartition range,
+                                uint32_t thread_num) {
+  for (u32 i{range.start}; i < range.end; ++i) {
+    subpass_->CompileSpirv(i);
   }
+}
 
-  auto it1{pipelines_.emplace(hash_value, std::move(pipeline))};
+PipelineTaskSet::PipelineTaskSet(Subpass* subpass, u32 pipeline_count)
+    : subpass_{subpass} {
+  m_SetSize = pipeline_count;
+}
 
-  return it1.first->second;
+void PipelineTaskSet::ExecuteRange(enki::TaskSetPartition range,
+                                   uint32_t thread_num) {
+  for (u32 i{range.start}; i < range.end; ++i) {
+    subpass_->CreatePipeline(i, thread_num);
+  }
 }
 
 }  // namespace luka::fw
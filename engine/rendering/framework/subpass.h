@@ -8,39 +8,59 @@
 // clang-format on
 
 #include "base/gpu/gpu.h"
+#include "base/task_scheduler/task_scheduler.h"
 #include "function/camera/camera.h"
+#include "rendering/framework/light_cluster.h"
+#include "rendering/framework/resource_cache.h"
 #include "rendering/framework/spirv.h"
 #include "resource/asset/asset.h"
+#include "resource/config/config.h"
 
 namespace luka::fw {
 
-constexpr u32 kSamplerInfoMaxCount{10};
-constexpr u32 kImageInfoMaxCount{20};
-constexpr u32 kBufferInfoMaxCount{10};
-constexpr u32 kBindlessSamplerMaxCount{8};
-constexpr u32 kBindlessImageMaxCount{128};
-
-struct SubpassUniform {
+// Lights are read from the light cluster buffers, the view and depth range
+// locate the cluster of a fragment.
+struct alignas(16) SubpassUniform {
   glm::mat4 pv;
   glm::mat4 inverse_pv;
+  glm::mat4 view;
   glm::vec4 camera_position;
-  ast::PunctualLight punctual_lights[ast::kPunctualLightMaxCount];
+  f32 z_near;
+  f32 z_far;
 };
 
-struct DrawElementUniform {
+// Both are also laid out as std430 arrays, alignas keeps the array stride.
+struct alignas(16) InstanceUniform {
   glm::mat4 m;
   glm::mat4 inverse_m;
-  glm::uvec4 sampler_indices_0;
-  glm::uvec4 sampler_indices_1;
-  glm::uvec4 image_indices_0;
-  glm::uvec4 image_indices_1;
-  glm::vec4 base_color_factor;
-  f32 metallic_factor;
-  f32 roughness_factor;
-  f32 normal_scale;
-  f32 occlusion_strength;
-  glm::vec4 emissive_factor;
-  f32 alpha_cutoff;
+  u32 draw_element_index;
+};
+
+// Material data lives in the device-wide material table, draw elements only
+// keep the index of their record.
+struct alignas(16) DrawElementUniform {
+  glm::uvec4 position_normal_addresses;
+  glm::uvec4 tangent_texcoord_0_addresses;
+  glm::uvec4 vertex_strides;
+  u32 material_index;
+};
+
+// Mirrors the push constant block of the shaders, subpass values are pushed
+// once per pipeline layout and draw element values before every draw.
+struct SubpassPushConstant {
+  u32 frame_index;
+  u32 draw_element_count;
+};
+
+struct DrawElementPushConstant {
+  u32 draw_element_index;
+  u32 material_index;
+  u32 lod;
+};
+
+struct PushConstant {
+  SubpassPushConstant subpass;
+  DrawElementPushConstant draw_element;
 };
 
 struct DrawElmentVertexInfo {
@@ -54,14 +74,36 @@ struct DrawElement {
   u32 scene_index;
   bool has_descriptor_set;
   const vk::raii::PipelineLayout* pipeline_layout;
-  std::vector<vk::raii::DescriptorSets> descriptor_sets;
-  std::vector<DrawElementUniform> uniforms;
-  std::vector<gpu::Buffer> uniform_buffers;
+  std::vector<std::vector<vk::DescriptorSet>> descriptor_sets;
   u64 vertex_count;
   std::vector<DrawElmentVertexInfo> vertex_infos;
   bool has_index;
   const ast::sc::IndexAttribute* index_attribute;
+  u32 first_index;
+  u32 index_count;
+  u32 first_instance;
+  u32 instance_count;
   const vk::raii::Pipeline* pipeline;
+  u32 pipeline_id;
+  u32 material_id;
+  u32 material_index;  // Record in the device-wide material table.
+  u32 draw_element_index;
+  u32 lod;  // Primitives have a single level of detail so far.
+  glm::vec3 center;
+  const ast::sc::Primitive* primitive;
+  u64 interface_hash_value;
+  u64 pipeline_hash_value;
+};
+
+// Descriptors of attachments and shared images, the only ones written again
+// when the swapchain is resized.
+struct SizeDependentDescriptor {
+  vk::DescriptorSet descriptor_set;
+  u32 frame_index;
+  u32 binding;
+  vk::DescriptorType descriptor_type;
+  u32 input_attachment_index;
+  std::string name;
 };
 
 struct ScenePrimitive {
@@ -71,10 +113,36 @@ struct ScenePrimitive {
   const ast::sc::Primitive* primitive;
 };
 
+// Shaders and pipelines of all draw elements are gathered first and then
+// created in parallel through the resource cache.
+struct SpirvRequest {
+  const ast::Shader* shader;
+  std::vector<std::string> processes;
+  vk::ShaderStageFlagBits stage;
+  u64 hash_value;
+};
+
+struct PipelineRequest {
+  const ast::sc::Primitive* primitive;
+  std::vector<const SPIRV*> spirvs;
+  std::vector<vk::ShaderModule> shader_modules;
+  std::vector<vk::VertexInputBindingDescription>
+      vertex_input_binding_descriptions;
+  std::vector<vk::VertexInputAttributeDescription>
+      vertex_input_attribute_descriptions;
+  std::vector<std::vector<vk::SpecializationMapEntry>>
+      specialization_map_entries;
+  std::vector<std::vector<u32>> specialization_data;
+  vk::PipelineLayout pipeline_layout;
+  u64 hash_value;
+};
+
 class Subpass {
  public:
   Subpass(
-      std::shared_ptr<Gpu> gpu, std::shared_ptr<Asset> asset,
+      std::shared_ptr<TaskScheduler> task_scheduler, std::shared_ptr<Gpu> gpu,
+      std::shared_ptr<ResourceCache> resource_cache,
+      std::shared_ptr<Config> config, std::shared_ptr<Asset> asset,
       std::shared_ptr<Camera> camera, u32 frame_count,
       vk::RenderPass render_pass,
       const std::vector<std::vector<vk::raii::ImageView>>&
@@ -91,17 +159,28 @@ class Subpass {
 
   void Update(u32 frame_index);
 
+  // Recorded outside the render pass, before the subpass reads the lists.
+  void CullLights(const vk::raii::CommandBuffer& command_buffer,
+                  u32 frame_index) const;
+
   const std::string& GetName() const;
 
   const std::vector<DrawElement>& GetDrawElements() const;
+  u64 GetDrawElementVersion() const;
+  u64 GetLightClusterPipelineHashValue() const;
+  const std::unordered_set<std::string>& GetSharedImageNames() const;
 
   bool HasPushConstant() const;
   void PushConstants(const vk::raii::CommandBuffer& command_buffer,
-                     vk::PipelineLayout pipeline_layout) const;
+                     vk::PipelineLayout pipeline_layout,
+                     u32 frame_index) const;
+  void PushDrawElementConstants(const vk::raii::CommandBuffer& command_buffer,
+                                vk::PipelineLayout pipeline_layout,
+                                const DrawElement& draw_element) const;
 
   bool HasSubpassDescriptorSet() const;
   u32 GetSubpassDescriptorSetIndex() const;
-  const vk::raii::DescriptorSet& GetSubpassDescriptorSet(u32 frame_index) const;
+  vk::DescriptorSet GetSubpassDescriptorSet(u32 frame_index) const;
 
   bool HasBindlessDescriptorSet() const;
   u32 GetBindlessDescriptorSetIndex() const;
@@ -109,11 +188,40 @@ class Subpass {
 
   u32 GetDrawElementDescriptorSetIndex() const;
 
+  bool IsVertexPulling() const;
+  vk::Buffer GetIndexBuffer() const;
+  vk::Buffer GetIndirectBuffer(u32 frame_index) const;
+  vk::DrawIndexedIndirectCommand* GetIndirectCommands(u32 frame_index) const;
+
+  void CompileSpirv(u32 index);
+  void CreatePipeline(u32 index, u32 thread_index);
+
+  // Hot reload, pipelines are rebuilt off the render loop and swapped in
+  // between frames.
+  bool UsesShader(const std::vector<u32>& shader_indices) const;
+  void ReloadPipelines();
+  void SwapPipelines(std::unordered_set<u64>& replaced_hash_values);
+
  protected:
   void CreateDrawElements();
+  void UpdateSizeDependentDescriptors();
+
+  void CreateDrawElementBuffer();
+  void CreateVertexPullingResources();
 
   DrawElement CreateDrawElement(const ScenePrimitive& scene_primitivce = {});
 
+  bool CanPullVertices(const ast::sc::Primitive& primitive) const;
+
+  void CompileSpirvs(const std::vector<const ast::sc::Primitive*>& primitives);
+
+  void GetShaderProcesses(const ast::sc::Primitive& primitive,
+                          std::vector<std::string>& vertex_shader_processes,
+                          std::vector<std::string>& fragment_shader_processes);
+
+  std::unordered_map<std::string, u32> GetSpecializationValues(
+      const ast::sc::Primitive& primitive) const;
+
   void ParseShaderResources(
       const ast::sc::Primitive& primitive, std::vector<const SPIRV*>& spirvs,
       std::unordered_map<std::string, ShaderResource>& name_shader_resources,
@@ -123,7 +231,6 @@ class Subpass {
       std::vector<vk::PushConstantRange>& push_constant_ranges);
 
   void CreatePipelineResources(
-      const glm::mat4& model_matrix, const glm::mat4& inverse_model_matrix,
       const ast::sc::Primitive& primitive,
       const std::unordered_map<std::string, ShaderResource>&
           name_shader_resources,
@@ -133,33 +240,27 @@ class Subpass {
       const std::vector<vk::PushConstantRange>& push_constant_ranges,
       DrawElement& draw_element);
 
-  void CreatePipeline(const ast::sc::Primitive& primitive,
-                      const std::vector<const SPIRV*>& spirvs,
-                      const std::unordered_map<std::string, ShaderResource>&
-                          name_shader_resources,
-                      DrawElement& draw_element);
-
-  const SPIRV& RequestSpirv(const ast::Shader& shader,
-                            const std::vector<std::string>& processes,
-                            vk::ShaderStageFlagBits shader_stage);
-
-  const vk::raii::DescriptorSetLayout& RequestDescriptorSetLayout(
-      const vk::DescriptorSetLayoutCreateInfo& descriptor_set_layout_ci,
-      const std::string& name = {}, i32 index = -1);
+  void PreparePipeline(const ast::sc::Primitive& primitive,
+                       const std::vector<const SPIRV*>& spirvs,
+                       const std::unordered_map<std::string, ShaderResource>&
+                           name_shader_resources,
+                       DrawElement& draw_element);
 
-  const vk::raii::PipelineLayout& RequestPipelineLayout(
-      const vk::PipelineLayoutCreateInfo& pipeline_layout_ci,
-      const std::string& name = {}, i32 index = -1);
+  void CreatePipelines();
+  void RequestPipelines(bool in_parallel);
+  void AssignPipelineIds();
 
-  const vk::raii::ShaderModule& RequestShaderModule(
-      const vk::ShaderModuleCreateInfo& shader_module_ci, u64 hash_value,
-      const std::string& name = {}, i32 index = -1);
+  vk::PipelineRasterizationStateCreateInfo GetRasterizationState(
+      const ast::sc::Primitive& primitive) const;
 
-  const vk::raii::Pipeline& RequestPipeline(
-      const vk::GraphicsPipelineCreateInfo& graphics_pipeline_ci,
-      u64 hash_value, const std::string& name = {}, i32 index = -1);
+  void PushConstantBytes(const vk::raii::CommandBuffer& command_buffer,
+                         vk::PipelineLayout pipeline_layout, u32 offset,
+                         u32 size, const void* data) const;
 
+  std::shared_ptr<TaskScheduler> task_scheduler_;
   std::shared_ptr<Gpu> gpu_;
+  std::shared_ptr<ResourceCache> resource_cache_;
+  std::shared_ptr<Config> config_;
   std::shared_ptr<Asset> asset_;
   std::shared_ptr<Camera> camera_;
 
@@ -182,44 +283,74 @@ class Subpass {
   const std::vector<u32>* lights_{};
   bool has_scene_{};
   bool has_light_{};
+  bool vertex_pulling_{};
   std::vector<SubpassUniform> subpass_uniforms_;
   std::vector<gpu::Buffer> subpass_uniform_buffers_;
+  std::vector<InstanceUniform> instance_uniforms_;
+  gpu::Buffer instance_buffer_;
+  std::vector<DrawElementUniform> draw_element_uniforms_;
+  gpu::Buffer draw_element_buffer_;
+  u32 draw_element_buffer_binding_{UINT32_MAX};
+  gpu::Buffer index_buffer_;
+  std::vector<gpu::Buffer> indirect_buffers_;
+  std::vector<vk::DrawIndexedIndirectCommand*> indirect_commands_;
 
   bool need_resize_{};
+  std::unordered_set<std::string> shared_image_names_;
+  std::vector<SizeDependentDescriptor> size_dependent_descriptors_;
 
-  bool light_once_{};
-  std::vector<ast::PunctualLight> punctual_lights_;
+  std::unique_ptr<LightCluster> light_cluster_;
+
+  gpu::DescriptorAllocator descriptor_allocator_;
 
   bool has_subpass_descriptor_set_{};
   u32 subpass_descriptor_set_index_{UINT32_MAX};
   const vk::raii::DescriptorSetLayout* subpass_descriptor_set_layout_{};
-  vk::raii::DescriptorSets subpass_descriptor_sets_{nullptr};
+  std::vector<vk::DescriptorSet> subpass_descriptor_sets_;
   bool subpass_desciptor_set_updated_{};
 
   bool has_bindless_descriptor_set_{};
   u32 bindless_descriptor_set_index_{UINT32_MAX};
-  const vk::raii::DescriptorSetLayout* bindless_descriptor_set_layout_{};
-  vk::raii::DescriptorSet bindless_descriptor_set_{nullptr};
   std::vector<std::string> wanted_textures_{
       "base_color_texture", "metallic_roughness_texture", "normal_texture",
       "occlusion_texture", "emissive_texture"};
-  u32 bindless_sampler_index_{};
-  u32 bindless_image_index_{};
+  std::vector<std::string> pulled_vertex_attributes_{"POSITION", "NORMAL",
+                                                     "TANGENT", "TEXCOORD_0"};
 
   u32 draw_element_descriptor_set_index_{UINT32_MAX};
 
   bool has_push_constant_{};
+  std::vector<vk::PushConstantRange> push_constant_ranges_;
+
 
-  std::unordered_map<u64, SPIRV> spirv_shaders_;
-  std::unordered_map<u64, vk::raii::DescriptorSetLayout>
-      descriptor_set_layouts_;
-  std::unordered_map<u64, vk::raii::PipelineLayout> pipeline_layouts_;
-  std::unordered_map<u64, vk::raii::ShaderModule> shader_modules_;
-  std::unordered_map<u64, vk::raii::Pipeline> pipelines_;
-  std::unordered_map<u64, u32> sampler_indices_;
-  std::unordered_map<u64, u32> image_indices_;
+  std::vector<SpirvRequest> spirv_requests_;
+  std::vector<PipelineRequest> pipeline_requests_;
+  std::vector<u32> pending_pipeline_requests_;
+  std::vector<vk::raii::PipelineCache> thread_pipeline_caches_;
+  std::vector<u64> reloaded_pipeline_hash_values_;
 
   std::vector<DrawElement> draw_elements_;
+  u64 draw_element_version_{};
+};
+
+class SpirvTaskSet : public enki::ITaskSet {
+ public:
+  SpirvTaskSet(Subpass* subpass, u32 spirv_count);
+
+  void ExecuteRange(enki::TaskSetPartition range, uint32_t thread_num) override;
+
+ private:
+  Subpass* subpass_{};
+};
+
+class PipelineTaskSet : public enki::ITaskSet {
+ public:
+  PipelineTaskSet(Subpass* subpass, u32 pipeline_count);
+
+  void ExecuteRange(enki::TaskSetPartition range, uint32_t thread_num) override;
+
+ private:
+  Subpass* subpass_{};
 };
 
 }  // namespace luka::fw
@@ -29,6 +29,7 @@ AssetAsync::AssetAsync(std::shared_ptr<Gpu> gpu, std::shared_ptr<Config> config,
       scenes_(scene_count_),
       lights_(light_count_),
       shaders_(shader_count_),
+      shader_include_cache_{std::make_shared<ast::ShaderIncludeCache>()},
       frame_graphs_(frame_graph_count_),
       staging_buffers_(thread_count_) {
   vk::CommandPoolCreateInfo command_pool_ci{
@@ -97,9 +98,9 @@ void AssetAsync::Submit() {
 u32 AssetAsync::GetAssetCount() const { return asset_count_; }
 
 void AssetAsync::LoadScene(u32 index, u32 thread_num) {
-  scenes_[index] = std::move(ast::Scene{gpu_, (*cfg_scene_paths_)[index],
-                                        transfer_command_buffers_[thread_num],
-                                        staging_buffers_[thread_num]});
+  scenes_[index] = std::move(ast::Scene{
+      gpu_, (*cfg_scene_paths_)[index], transfer_command_buffers_[thread_num],
+      staging_buffers_[thread_num], config_->GetVertexPulling()});
 }
 
 void AssetAsync::LoadLight(u32 index) {
@@ -107,7 +108,9 @@ void AssetAsync::LoadLight(u32 index) {
 }
 
 void AssetAsync::LoadShader(u32 index) {
-  shaders_[index] = std::move(ast::Shader{(*cfg_shader_paths_)[index]});
+  shaders_[index] = std::move(
+      ast::Shader{(*cfg_shader_paths_)[index], shader_include_cache_,
+                  config_->GetShaderOptimization()});
 }
 
 void AssetAsync::LoadFrameGraph(u32 index) {
@@ -143,6 +146,39 @@ const ast::FrameGraph& AssetAsync::GetFrameGraph(u32 index) {
   return frame_graphs_[index];
 }
 
+std::vector<u32> AssetAsync::ReloadShaders(
+    const std::vector<std::filesystem::path>& changed_paths) {
+  std::unordered_set<std::string> changed_path_strings;
+  for (const auto& changed_path : changed_paths) {
+    shader_include_cache_->Invalidate(changed_path);
+    changed_path_strings.insert(changed_path.lexically_normal().string());
+  }
+
+  std::vector<u32> reloaded_shaders;
+  for (u32 i{}; i < shader_count_; ++i) {
+    const std::filesystem::path& shader_path{(*cfg_shader_paths_)[i]};
+    bool changed{
+        changed_path_strings.contains(shader_path.lexically_normal().string())};
+    for (const auto& include_path : shaders_[i].GetIncludePaths()) {
+      changed = changed || changed_path_strings.contains(include_path);
+    }
+    if (!changed) {
+      continue;
+    }
+
+    // A shader failing to load keeps its previous version.
+    try {
+      LoadShader(i);
+    } catch (const Exception&) {
+      LOGW("Fail to reload shader {}", shader_path.string());
+      continue;
+    }
+    LOGI("Reload shader {}", shader_path.string());
+    reloaded_shaders.push_back(i);
+  }
+  return reloaded_shaders;
+}
+
 AssetAsyncLoadTaskSet::AssetAsyncLoadTaskSet(AssetAsync* asset_async)
     : asset_async_{asset_async} {
   m_SetSize = asset_async_->GetAssetCount();
@@ -185,11 +221,43 @@ const ast::FrameGraph& Asset::GetFrameGraph(u32 index) {
   return asset_async_.GetFrameGraph(index);
 }
 
+std::vector<u32> Asset::ReloadChangedShaders() {
+  if (!config_->GetShaderHotReload()) {
+    return {};
+  }
+  WaitAssetAsyncLoad();
+
+  std::vector<std::filesystem::path> changed_paths{shader_watcher_.Poll()};
+  if (changed_paths.empty()) {
+    return {};
+  }
+
+  std::vector<u32> reloaded_shaders{asset_async_.ReloadShaders(changed_paths)};
+  WatchShaders();
+  return reloaded_shaders;
+}
+
 void Asset::WaitAssetAsyncLoad() {
   if (!loaded_) {
     task_scheduler_->WaitforTask(&asset_async_load_task_set_);
     asset_async_.Submit();
     loaded_ = true;
+
+    if (config_->GetShaderHotReload()) {
+      WatchShaders();
+    }
+  }
+}
+
+void Asset::WatchShaders() {
+  const std::vector<std::filesystem::path>& shader_paths{
+      config_->GetShaderPaths()};
+  for (u32 i{}; i < shader_paths.size(); ++i) {
+    shader_watcher_.Watch(shader_paths[i]);
+    for (const auto& include_path :
+         asset_async_.GetShader(i).GetIncludePaths()) {
+      shader_watcher_.Watch(include_path);
+    }
   }
 }
 
@@ -9,6 +9,7 @@
 
 #include "base/gpu/gpu.h"
 #include "base/task_scheduler/task_scheduler.h"
+#include "core/file_watcher.h"
 #include "resource/asset/frame_graph.h"
 #include "resource/asset/light.h"
 #include "resource/asset/scene.h"
@@ -33,6 +34,9 @@ class AssetAsync {
   const ast::Shader& GetShader(u32 index);
   const ast::FrameGraph& GetFrameGraph(u32 index);
 
+  std::vector<u32> ReloadShaders(
+      const std::vector<std::filesystem::path>& changed_paths);
+
  private:
   void LoadScene(u32 index, u32 thread_num);
   void LoadLight(u32 index);
@@ -56,6 +60,7 @@ class AssetAsync {
   std::vector<ast::Scene> scenes_;
   std::vector<ast::Light> lights_;
   std::vector<ast::Shader> shaders_;
+  std::shared_ptr<ast::ShaderIncludeCache> shader_include_cache_;
   std::vector<ast::FrameGraph> frame_graphs_;
   std::vector<std::vector<gpu::Buffer>> staging_buffers_;
 
@@ -87,8 +92,13 @@ class Asset {
   const ast::Shader& GetShader(u32 index);
   const ast::FrameGraph& GetFrameGraph(u32 index);
 
+  // Shaders whose source or includes were written since the last call are
+  // loaded again, returns their indices.
+  std::vector<u32> ReloadChangedShaders();
+
  private:
   void WaitAssetAsyncLoad();
+  void WatchShaders();
 
   std::shared_ptr<TaskScheduler> task_scheduler_;
   std::shared_ptr<Gpu> gpu_;
@@ -97,6 +107,8 @@ class Asset {
   AssetAsync asset_async_;
   AssetAsyncLoadTaskSet asset_async_load_task_set_;
   bool loaded_{};
+
+  FileWatcher shader_watcher_;
 };
 
 }  // namespace luka
\ No newline at end of file
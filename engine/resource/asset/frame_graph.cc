@@ -183,6 +183,12 @@ FrameGraph::FrameGraph(const std::filesystem::path& frame_graph_path) {
               subpass.shaders.emplace(vk::ShaderStageFlagBits::eFragment,
                                       index);
             }
+
+            // Assigns the lights of the subpass to clusters.
+            if (shaders_json.contains("compute")) {
+              u32 index{shaders_json["compute"].template get<u32>()};
+              subpass.shaders.emplace(vk::ShaderStageFlagBits::eCompute, index);
+            }
           }
 
           if (subpass_json.contains("scene")) {
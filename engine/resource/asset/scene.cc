@@ -21,7 +21,7 @@ Scene::Scene(Scene&& rhs) noexcept
 Scene::Scene(std::shared_ptr<Gpu> gpu,
              const std::filesystem::path& cfg_scene_path,
              const vk::raii::CommandBuffer& command_buffer,
-             std::vector<gpu::Buffer>& staging_buffers)
+             std::vector<gpu::Buffer>& staging_buffers, bool host_indices)
     : gpu_{std::move(gpu)} {
   tinygltf::Model tinygltf;
   std::string extension{cfg_scene_path.extension().string()};
@@ -53,7 +53,8 @@ Scene::Scene(std::shared_ptr<Gpu> gpu,
   ParseBufferComponents(tinygltf.buffers);
   ParseBufferViewComponents(tinygltf.bufferViews);
   ParseAccessorComponents(tinygltf.accessors);
-  ParseMeshComponents(tinygltf.meshes, command_buffer, staging_buffers);
+  ParseMeshComponents(tinygltf.meshes, command_buffer, staging_buffers,
+                      host_indices);
   ParseNodeComponents(tinygltf.nodes);
   ParseSceneComponents(tinygltf.scenes);
   ParseDefaultScene(tinygltf.defaultScene);
@@ -258,15 +259,15 @@ void Scene::ParseMaterialComponents(
   auto texture_components{GetComponents<sc::Texture>()};
 
   for (const auto& tinygltf_material : tinygltf_materials) {
-    auto material_component{
-        std::make_unique<sc::Material>(texture_components, tinygltf_material)};
+    auto material_component{std::make_unique<sc::Material>(
+        gpu_, texture_components, tinygltf_material)};
     AddComponent(std::move(material_component));
   }
 
   tinygltf::Material default_tinygltf_material;
   default_tinygltf_material.name = "default";
   auto default_material_component{std::make_unique<sc::Material>(
-      texture_components, default_tinygltf_material)};
+      gpu_, texture_components, default_tinygltf_material)};
   AddComponent(std::move(default_material_component));
 }
 
@@ -306,14 +307,14 @@ void Scene::ParseAccessorComponents(
 void Scene::ParseMeshComponents(
     const std::vector<tinygltf::Mesh>& tinygltf_meshs,
     const vk::raii::CommandBuffer& command_buffer,
-    std::vector<gpu::Buffer>& staging_buffers) {
+    std::vector<gpu::Buffer>& staging_buffers, bool host_indices) {
   auto material_components{GetComponents<sc::Material>()};
   auto accessor_components{GetComponents<sc::Accessor>()};
 
   for (const auto& tinygltf_mesh : tinygltf_meshs) {
     std::unique_ptr<sc::Mesh> mesh_component{std::make_unique<sc::Mesh>(
         gpu_, material_components, accessor_components, tinygltf_mesh,
-        command_buffer, staging_buffers)};
+        command_buffer, staging_buffers, host_indices)};
     AddComponent(std::move(mesh_component));
   }
 }
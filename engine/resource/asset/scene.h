@@ -33,7 +33,7 @@ class Scene {
   Scene(Scene&& rhs) noexcept;
   Scene(std::shared_ptr<Gpu> gpu, const std::filesystem::path& cfg_scene_path,
         const vk::raii::CommandBuffer& command_buffer,
-        std::vector<gpu::Buffer>& staging_buffers);
+        std::vector<gpu::Buffer>& staging_buffers, bool host_indices);
 
   ~Scene() = default;
 
@@ -113,7 +113,8 @@ class Scene {
 
   void ParseMeshComponents(const std::vector<tinygltf::Mesh>& tinygltf_meshs,
                            const vk::raii::CommandBuffer& command_buffer,
-                           std::vector<gpu::Buffer>& staging_buffers);
+                           std::vector<gpu::Buffer>& staging_buffers,
+                           bool host_indices);
 
   void ParseNodeComponents(const std::vector<tinygltf::Node>& tinygltf_nodes);
   void InitNodeChildren() const;
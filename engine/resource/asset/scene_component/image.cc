@@ -21,7 +21,7 @@ Image::Image(const std::shared_ptr<Gpu>& gpu,
              const tinygltf::Image& tinygltf_image,
              const vk::raii::CommandBuffer& command_buffer,
              std::vector<gpu::Buffer>& staging_buffers)
-    : Component{tinygltf_image.uri} {
+    : Component{tinygltf_image.uri}, gpu_{gpu} {
   // Staging buffer.
   const auto& data{tinygltf_image.image};
   u64 data_size{data.size()};
@@ -113,6 +113,13 @@ Image::Image(const std::shared_ptr<Gpu>& gpu,
        VK_REMAINING_ARRAY_LAYERS}};
 
   image_view_ = gpu->CreateImageView(image_view_ci, GetName());
+  bindless_index_ = gpu->AddBindlessImage(image_view_);
+}
+
+Image::~Image() {
+  if (gpu_ && bindless_index_ != UINT32_MAX) {
+    gpu_->RemoveBindlessImage(bindless_index_);
+  }
 }
 
 std::type_index Image::GetType() { return typeid(Image); }
@@ -121,4 +128,6 @@ const gpu::Image& Image::GetImage() const { return image_; }
 
 const vk::raii::ImageView& Image::GetImageView() const { return image_view_; }
 
+u32 Image::GetBindlessIndex() const { return bindless_index_; }
+
 }  // namespace luka::ast::sc
@@ -25,16 +25,19 @@ class Image : public Component {
         const vk::raii::CommandBuffer& command_buffer,
         std::vector<gpu::Buffer>& staging_buffers);
 
-  ~Image() override = default;
+  ~Image() override;
 
   std::type_index GetType() override;
 
   const gpu::Image& GetImage() const;
   const vk::raii::ImageView& GetImageView() const;
+  u32 GetBindlessIndex() const;
 
  private:
+  std::shared_ptr<Gpu> gpu_;
   gpu::Image image_{nullptr};
   vk::raii::ImageView image_view_{nullptr};
+  u32 bindless_index_{UINT32_MAX};
 };
 
 }  // namespace luka::ast::sc
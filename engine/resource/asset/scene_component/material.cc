@@ -12,12 +12,23 @@
 
 namespace luka::ast::sc {
 
-Material::Material(std::map<std::string, Texture*>&& textures,
+namespace {
+
+// Texture slots of a material record, in the order the shaders read them.
+constexpr std::array<const char*, 5> kMaterialTextureNames{
+    "base_color_texture", "metallic_roughness_texture", "normal_texture",
+    "occlusion_texture", "emissive_texture"};
+
+}  // namespace
+
+Material::Material(const std::shared_ptr<Gpu>& gpu,
+                   std::map<std::string, Texture*>&& textures,
                    glm::vec4&& base_color_factor, f32 metallic_factor,
                    f32 roughness_factor, f32 scale, f32 strength,
                    glm::vec3&& emissive_factor, AlphaMode alpha_mode,
                    f32 alpha_cutoff, bool double_sided, const std::string& name)
     : Component{name},
+      gpu_{gpu},
       textures_{std::move(textures)},
       base_color_factor_{base_color_factor},
       metallic_factor_{metallic_factor},
@@ -27,11 +38,16 @@ Material::Material(std::map<std::string, Texture*>&& textures,
       emissive_factor_{emissive_factor},
       alpha_mode_{alpha_mode},
       alpha_cutoff_{alpha_cutoff},
-      double_sided_{double_sided} {}
+      double_sided_{double_sided} {
+  MaterialUniform material_uniform{CreateMaterialUniform()};
+  material_index_ =
+      gpu_->AddBindlessMaterial(&material_uniform, sizeof(MaterialUniform));
+}
 
-Material::Material(const std::vector<Texture*>& texture_components,
+Material::Material(const std::shared_ptr<Gpu>& gpu,
+                   const std::vector<Texture*>& texture_components,
                    const tinygltf::Material& tinygltf_material)
-    : Component{tinygltf_material.name} {
+    : Component{tinygltf_material.name}, gpu_{gpu} {
   // Pbr.
   const tinygltf::PbrMetallicRoughness& metallic_roughness{
       tinygltf_material.pbrMetallicRoughness};
@@ -108,6 +124,17 @@ Material::Material(const std::vector<Texture*>& texture_components,
   alpha_cutoff_ = static_cast<f32>(tinygltf_material.alphaCutoff);
 
   double_sided_ = tinygltf_material.doubleSided;
+
+  // Uploaded once, draws only carry the index of the record.
+  MaterialUniform material_uniform{CreateMaterialUniform()};
+  material_index_ =
+      gpu_->AddBindlessMaterial(&material_uniform, sizeof(MaterialUniform));
+}
+
+Material::~Material() {
+  if (gpu_) {
+    gpu_->RemoveBindlessMaterial(material_index_);
+  }
 }
 
 std::type_index Material::GetType() { return typeid(Material); }
@@ -138,4 +165,38 @@ f32 Material::GetAlphaCutoff() const { return alpha_cutoff_; }
 
 bool Material::GetDoubleSided() const { return double_sided_; }
 
+u32 Material::GetMaterialIndex() const { return material_index_; }
+
+MaterialUniform Material::CreateMaterialUniform() const {
+  MaterialUniform material_uniform{};
+
+  for (u32 i{}; i < kMaterialTextureNames.size(); ++i) {
+    auto it{textures_.find(kMaterialTextureNames[i])};
+    if (it == textures_.end()) {
+      continue;
+    }
+
+    const Texture* texture{it->second};
+    u32 sampler_index{texture->GetSampler()->GetBindlessIndex()};
+    u32 image_index{texture->GetImage()->GetBindlessIndex()};
+    if (i < 4) {
+      material_uniform.sampler_indices_0[i] = sampler_index;
+      material_uniform.image_indices_0[i] = image_index;
+    } else {
+      material_uniform.sampler_indices_1[i - 4] = sampler_index;
+      material_uniform.image_indices_1[i - 4] = image_index;
+    }
+  }
+
+  material_uniform.base_color_factor = base_color_factor_;
+  material_uniform.metallic_factor = metallic_factor_;
+  material_uniform.roughness_factor = roughness_factor_;
+  material_uniform.normal_scale = normal_scale_;
+  material_uniform.occlusion_strength = occlusion_strength_;
+  material_uniform.emissive_factor = glm::vec4{emissive_factor_, 1.0F};
+  material_uniform.alpha_cutoff = alpha_cutoff_;
+
+  return material_uniform;
+}
+
 }  // namespace luka::ast::sc
@@ -9,6 +9,7 @@
 
 #include <tiny_gltf.h>
 
+#include "base/gpu/gpu.h"
 #include "core/math.h"
 #include "resource/asset/scene_component/component.h"
 #include "resource/asset/scene_component/texture.h"
@@ -17,19 +18,39 @@ namespace luka::ast::sc {
 
 enum class AlphaMode { kNone, kOpaque, kMask, kBlend };
 
+// One record of the device-wide material table, laid out as the std430
+// MaterialUniform of the shaders.
+struct alignas(16) MaterialUniform {
+  glm::uvec4 sampler_indices_0;
+  glm::uvec4 sampler_indices_1;
+  glm::uvec4 image_indices_0;
+  glm::uvec4 image_indices_1;
+  glm::vec4 base_color_factor;
+  f32 metallic_factor;
+  f32 roughness_factor;
+  f32 normal_scale;
+  f32 occlusion_strength;
+  glm::vec4 emissive_factor;
+  f32 alpha_cutoff;
+};
+
+static_assert(sizeof(MaterialUniform) <= gpu::kBindlessMaterialStride);
+
 class Material : public Component {
  public:
   DELETE_SPECIAL_MEMBER_FUNCTIONS(Material)
 
-  Material(std::map<std::string, Texture*>&& textures,
+  Material(const std::shared_ptr<Gpu>& gpu,
+           std::map<std::string, Texture*>&& textures,
            glm::vec4&& base_color_factor, f32 metallic_factor,
            f32 roughness_factor, f32 scale, f32 strength,
            glm::vec3&& emissive_factor, AlphaMode alpha_mode, f32 alpha_cutoff,
            bool double_sided, const std::string& name = {});
-  Material(const std::vector<Texture*>& texture_components,
+  Material(const std::shared_ptr<Gpu>& gpu,
+           const std::vector<Texture*>& texture_components,
            const tinygltf::Material& tinygltf_material);
 
-  ~Material() override = default;
+  ~Material() override;
 
   std::type_index GetType() override;
 
@@ -43,8 +64,12 @@ class Material : public Component {
   AlphaMode GetAlphaMode() const;
   f32 GetAlphaCutoff() const;
   bool GetDoubleSided() const;
+  u32 GetMaterialIndex() const;
 
  private:
+  MaterialUniform CreateMaterialUniform() const;
+
+  std::shared_ptr<Gpu> gpu_;
   std::map<std::string, Texture*> textures_;
 
   glm::vec4 base_color_factor_{};
@@ -56,6 +81,8 @@ class Material : public Component {
   AlphaMode alpha_mode_{AlphaMode::kNone};
   f32 alpha_cutoff_{};
   bool double_sided_{};
+
+  u32 material_index_{};
 };
 
 }  // namespace luka::ast::sc
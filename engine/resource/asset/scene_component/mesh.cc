@@ -20,7 +20,7 @@ Mesh::Mesh(const std::shared_ptr<Gpu>& gpu,
            const std::vector<Accessor*>& accessor_components,
            const tinygltf::Mesh& tinygltf_mesh,
            const vk::raii::CommandBuffer& command_buffer,
-           std::vector<gpu::Buffer>& staging_buffers)
+           std::vector<gpu::Buffer>& staging_buffers, bool host_indices)
     : Component{tinygltf_mesh.name} {
   const std::vector<tinygltf::Primitive>& tinygltf_primitives{
       tinygltf_mesh.primitives};
@@ -46,6 +46,9 @@ Mesh::Mesh(const std::shared_ptr<Gpu>& gpu,
                                      buffer_size,
                                      vk::BufferUsageFlagBits::eVertexBuffer |
                                          vk::BufferUsageFlagBits::eTransferDst};
+      if (gpu->HasBufferDeviceAddress()) {
+        buffer_ci.usage |= vk::BufferUsageFlagBits::eShaderDeviceAddress;
+      }
 
       gpu::Buffer staging_buffer{
           gpu->CreateBuffer(staging_buffer_ci, buffer_data)};
@@ -127,8 +130,28 @@ Mesh::Mesh(const std::shared_ptr<Gpu>& gpu,
 
       u64 index_count{accessor->GetCount()};
 
-      primitive.index_attribute =
-          IndexAttribute{std::move(buffer), index_type, 0, index_count};
+      // Subpasses pulling vertices draw from one merged index buffer, which is
+      // built from host indices. They are only kept when vertex pulling is on.
+      std::vector<u32> indices;
+      if (host_indices && gpu->HasBufferDeviceAddress()) {
+        u32 stride{accessor->GetStride()};
+        indices.resize(index_count);
+        for (u64 j{}; j < index_count; ++j) {
+          const u8* index_data{buffer_data + j * stride};
+          if (index_type == vk::IndexType::eUint8EXT) {
+            indices[j] = *index_data;
+          } else if (index_type == vk::IndexType::eUint16) {
+            u16 index{};
+            memcpy(&index, index_data, sizeof(u16));
+            indices[j] = index;
+          } else {
+            memcpy(&indices[j], index_data, sizeof(u32));
+          }
+        }
+      }
+
+      primitive.index_attribute = IndexAttribute{
+          std::move(buffer), index_type, 0, index_count, std::move(indices)};
     }
 
     // Material.
@@ -32,6 +32,7 @@ struct IndexAttribute {
   vk::IndexType index_type;
   u64 offset;
   u64 count;
+  std::vector<u32> indices;
 };
 
 class Primitive {
@@ -63,7 +64,7 @@ class Mesh : public Component {
        const std::vector<Accessor*>& accessor_components,
        const tinygltf::Mesh& tinygltf_mesh,
        const vk::raii::CommandBuffer& command_buffer,
-       std::vector<gpu::Buffer>& staging_buffers);
+       std::vector<gpu::Buffer>& staging_buffers, bool host_indices);
 
   ~Mesh() override = default;
 
@@ -14,7 +14,7 @@ Sampler::Sampler(vk::raii::Sampler&& sampler, const std::string& name)
 
 Sampler::Sampler(const std::shared_ptr<Gpu>& gpu,
                  const tinygltf::Sampler& tinygltf_sampler)
-    : Component{tinygltf_sampler.name} {
+    : Component{tinygltf_sampler.name}, gpu_{gpu} {
   vk::Filter mag_filter{};
   switch (tinygltf_sampler.minFilter) {
     case TINYGLTF_TEXTURE_FILTER_NEAREST:
@@ -91,10 +91,19 @@ Sampler::Sampler(const std::shared_ptr<Gpu>& gpu,
                                    mipmap_mode, address_mode_u, address_mode_v};
 
   sampler_ = gpu->CreateSampler(sampler_ci, tinygltf_sampler.name);
+  bindless_index_ = gpu->AddBindlessSampler(sampler_);
+}
+
+Sampler::~Sampler() {
+  if (gpu_ && bindless_index_ != UINT32_MAX) {
+    gpu_->RemoveBindlessSampler(bindless_index_);
+  }
 }
 
 std::type_index Sampler::GetType() { return typeid(Sampler); }
 
 const vk::raii::Sampler& Sampler::GetSampler() const { return sampler_; }
 
+u32 Sampler::GetBindlessIndex() const { return bindless_index_; }
+
 }  // namespace luka::ast::sc
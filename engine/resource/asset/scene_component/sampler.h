@@ -23,14 +23,17 @@ class Sampler : public Component {
   Sampler(const std::shared_ptr<Gpu>& gpu,
           const tinygltf::Sampler& tinygltf_sampler);
 
-  ~Sampler() override = default;
+  ~Sampler() override;
 
   std::type_index GetType() override;
 
   const vk::raii::Sampler& GetSampler() const;
+  u32 GetBindlessIndex() const;
 
  private:
+  std::shared_ptr<Gpu> gpu_;
   vk::raii::Sampler sampler_{nullptr};
+  u32 bindless_index_{UINT32_MAX};
 };
 
 }  // namespace luka::ast::sc
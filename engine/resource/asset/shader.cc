@@ -11,16 +11,109 @@
 #include <SPIRV/Logger.h>
 #include <glslang/Public/ResourceLimits.h>
 
-#include <regex>
+#include <sstream>
 
 #include "core/log.h"
 #include "core/util.h"
-#include "resource/config/generated/root_path.h"
 
 namespace luka::ast {
 
-Shader::Shader(const std::filesystem::path& cfg_shader_path)
-    : path_{cfg_shader_path.string()}, source_text_{LoadText(path_)} {
+namespace {
+
+std::filesystem::path ResolveIncludePath(const char* header_name,
+                                         const char* includer_name) {
+  std::filesystem::path includer_path{includer_name};
+  return (includer_path.parent_path() / header_name).lexically_normal();
+}
+
+// Returns the file name of an #include directive, or an empty string if the
+// line is not one.
+std::string GetIncludeName(const std::string& line) {
+  size_t pos{line.find_first_not_of(" \t")};
+  if (pos == std::string::npos || line[pos] != '#') {
+    return {};
+  }
+  pos = line.find_first_not_of(" \t", pos + 1);
+  if (pos == std::string::npos || line.compare(pos, 7, "include") != 0) {
+    return {};
+  }
+  pos = line.find_first_of("\"<", pos + 7);
+  if (pos == std::string::npos) {
+    return {};
+  }
+  char delimiter{line[pos] == '<' ? '>' : '"'};
+  size_t end{line.find(delimiter, pos + 1)};
+  if (end == std::string::npos) {
+    return {};
+  }
+  return line.substr(pos + 1, end - pos - 1);
+}
+
+}  // namespace
+
+std::shared_ptr<const std::string> ShaderIncludeCache::Request(
+    const std::filesystem::path& include_path) {
+  std::string key{include_path.string()};
+  {
+    std::lock_guard<std::mutex> lock{mutex_};
+    auto it{texts_.find(key)};
+    if (it != texts_.end()) {
+      return it->second;
+    }
+  }
+
+  auto text{std::make_shared<const std::string>(LoadText(include_path))};
+
+  std::lock_guard<std::mutex> lock{mutex_};
+  return texts_.emplace(key, std::move(text)).first->second;
+}
+
+void ShaderIncludeCache::Invalidate(
+    const std::filesystem::path& include_path) {
+  std::lock_guard<std::mutex> lock{mutex_};
+  texts_.erase(include_path.lexically_normal().string());
+}
+
+ShaderIncluder::ShaderIncluder(ShaderIncludeCache* include_cache)
+    : include_cache_{include_cache} {}
+
+glslang::TShader::Includer::IncludeResult* ShaderIncluder::includeSystem(
+    const char* header_name, const char* includer_name,
+    size_t inclusion_depth) {
+  return includeLocal(header_name, includer_name, inclusion_depth);
+}
+
+glslang::TShader::Includer::IncludeResult* ShaderIncluder::includeLocal(
+    const char* header_name, const char* includer_name,
+    size_t /*inclusion_depth*/) {
+  std::filesystem::path include_path{
+      ResolveIncludePath(header_name, includer_name)};
+  if (!std::filesystem::exists(include_path)) {
+    return nullptr;
+  }
+
+  // The user data keeps the cached text alive until glslang releases it.
+  auto* text{new std::shared_ptr<const std::string>{
+      include_cache_->Request(include_path)}};
+  return new IncludeResult{include_path.string(), (*text)->data(),
+                           (*text)->size(), text};
+}
+
+void ShaderIncluder::releaseInclude(IncludeResult* include_result) {
+  if (include_result) {
+    delete static_cast<std::shared_ptr<const std::string>*>(
+        include_result->userData);
+    delete include_result;
+  }
+}
+
+Shader::Shader(const std::filesystem::path& cfg_shader_path,
+               std::shared_ptr<ShaderIncludeCache> include_cache,
+               ShaderOptimization optimization)
+    : path_{cfg_shader_path.lexically_normal().string()},
+      source_text_{LoadText(path_)},
+      optimization_{optimization},
+      include_cache_{std::move(include_cache)} {
   std::string extension{cfg_shader_path.extension().string()};
   if (extension == ".vert") {
     language_ = EShLangVertex;
@@ -32,29 +125,8 @@ Shader::Shader(const std::filesystem::path& cfg_shader_path)
     THROW("Unsupport shader extension");
   }
 
-  std::regex pattern{"#include\\s*\"([^\"]+)\""};
-  std::smatch match;
-  std::filesystem::path parent_path{cfg_shader_path.parent_path()};
-  while (std::regex_search(source_text_, match, pattern)) {
-    std::string filename{match[1]};
-    std::filesystem::path path{parent_path / filename};
-    std::string text{LoadText(path)};
-    source_text_ = std::regex_replace(
-        source_text_, std::regex("#include\\s*\"" + filename + "\""), text);
-  }
-
-#ifndef NDEBUG
-  std::filesystem::path cache_path{GetPath(LUKA_ROOT_PATH) / ".cache" /
-                                   "shader"};
-  if (!std::filesystem::exists(cache_path)) {
-    std::filesystem::create_directories(cache_path);
-  }
-  cache_path = cache_path / cfg_shader_path.filename();
-
-  SaveText(cache_path, source_text_);
-
-  path_ = cache_path.string();
-#endif
+  std::set<std::string> visited_paths{path_};
+  ParseIncludes(path_, source_text_, visited_paths);
 }
 
 u64 Shader::GetHashValue(const std::vector<std::string>& processes) const {
@@ -66,9 +138,29 @@ u64 Shader::GetHashValue(const std::vector<std::string>& processes) const {
   for (const std::string& str : svec) {
     HashCombine(hash_value, str);
   }
+  HashCombine(hash_value, include_hash_value_);
+  HashCombine(hash_value, static_cast<u32>(optimization_));
+  return hash_value;
+}
+
+u64 Shader::GetSourceHashValue() const {
+  u64 hash_value{};
+  HashCombine(hash_value, source_text_);
+  HashCombine(hash_value, include_hash_value_);
+  HashCombine(hash_value, static_cast<u32>(optimization_));
   return hash_value;
 }
 
+const std::vector<std::string>& Shader::GetIncludePaths() const {
+  return include_paths_;
+}
+
+ShaderOptimization Shader::GetOptimization() const { return optimization_; }
+
+u32 Shader::GetCompilerVersion() {
+  return static_cast<u32>(glslang::GetSpirvGeneratorVersion());
+}
+
 std::vector<u32> Shader::CompileToSpirv(
     const std::vector<std::string>& processes) const {
   std::string info_log;
@@ -76,13 +168,16 @@ std::vector<u32> Shader::CompileToSpirv(
   glslang::InitializeProcess();
 
   const char* source_string{source_text_.c_str()};
+  const i32 source_length{static_cast<i32>(source_text_.size())};
+  const char* source_name{path_.c_str()};
   EShMessages messages{static_cast<EShMessages>(
       EShMsgDefault | EShMsgVulkanRules | EShMsgSpvRules)};
 
   glslang::TShader shader{language_};
-  shader.setStrings(&source_string, 1);
+  shader.setStringsWithLengthsAndNames(&source_string, &source_length,
+                                       &source_name, 1);
 
-  std::string preamble;
+  std::string preamble{"#extension GL_GOOGLE_include_directive : enable\n"};
   for (const std::string& process : processes) {
     std::string line{"#define " + process.substr(1) + "\n"};
     preamble += line;
@@ -92,7 +187,8 @@ std::vector<u32> Shader::CompileToSpirv(
   shader.setEntryPoint("main");
   shader.setSourceEntryPoint("main");
   shader.addProcesses(processes);
-  if (!shader.parse(GetDefaultResources(), 100, false, messages)) {
+  ShaderIncluder includer{include_cache_.get()};
+  if (!shader.parse(GetDefaultResources(), 100, false, messages, includer)) {
     info_log = std::string{shader.getInfoLog()} + "\n" +
                std::string{shader.getInfoDebugLog()};
     THROW("{}\n{}", path_, info_log);
@@ -108,9 +204,14 @@ std::vector<u32> Shader::CompileToSpirv(
 
   glslang::TIntermediate* intermediate{program.getIntermediate(language_)};
 
+  // Names are kept for reflection, debug info is stripped once reflected.
+  glslang::SpvOptions spv_options;
+  spv_options.disableOptimizer = optimization_ == ShaderOptimization::kNone;
+  spv_options.optimizeSize = optimization_ == ShaderOptimization::kSize;
+
   std::vector<std::uint32_t> spirv;
   spv::SpvBuildLogger logger;
-  glslang::GlslangToSpv(*intermediate, spirv, &logger);
+  glslang::GlslangToSpv(*intermediate, spirv, &logger, &spv_options);
 
   info_log = logger.getAllMessages();
   if (!info_log.empty()) {
@@ -122,4 +223,35 @@ std::vector<u32> Shader::CompileToSpirv(
   return spirv;
 }
 
+void Shader::ParseIncludes(const std::filesystem::path& path,
+                           const std::string& text,
+                           std::set<std::string>& visited_paths) {
+  std::istringstream stream{text};
+  std::string line;
+  while (std::getline(stream, line)) {
+    std::string header_name{GetIncludeName(line)};
+    if (header_name.empty()) {
+      continue;
+    }
+
+    std::filesystem::path include_path{
+        ResolveIncludePath(header_name.c_str(), path.string().c_str())};
+    std::string include_path_string{include_path.string()};
+    if (!visited_paths.insert(include_path_string).second) {
+      continue;
+    }
+    if (!std::filesystem::exists(include_path)) {
+      THROW("{} includes missing file {}", path.string(), include_path_string);
+    }
+
+    std::shared_ptr<const std::string> include_text{
+        include_cache_->Request(include_path)};
+    include_paths_.push_back(include_path_string);
+    HashCombine(include_hash_value_, include_path_string);
+    HashCombine(include_hash_value_, *include_text);
+
+    ParseIncludes(include_path, *include_text, visited_paths);
+  }
+}
+
 }  // namespace luka::ast
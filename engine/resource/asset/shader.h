@@ -9,22 +9,72 @@
 
 #include <glslang/Public/ShaderLang.h>
 
+#include <mutex>
+
+#include "resource/config/config.h"
+
 namespace luka::ast {
 
+/**
+ * Texts of included files shared by all shaders, so a header included by many
+ * shaders is read from disk once.
+ */
+class ShaderIncludeCache {
+ public:
+  std::shared_ptr<const std::string> Request(
+      const std::filesystem::path& include_path);
+  void Invalidate(const std::filesystem::path& include_path);
+
+ private:
+  std::mutex mutex_;
+  std::unordered_map<std::string, std::shared_ptr<const std::string>> texts_;
+};
+
+class ShaderIncluder : public glslang::TShader::Includer {
+ public:
+  explicit ShaderIncluder(ShaderIncludeCache* include_cache);
+
+  IncludeResult* includeSystem(const char* header_name,
+                               const char* includer_name,
+                               size_t inclusion_depth) override;
+  IncludeResult* includeLocal(const char* header_name,
+                              const char* includer_name,
+                              size_t inclusion_depth) override;
+  void releaseInclude(IncludeResult* include_result) override;
+
+ private:
+  ShaderIncludeCache* include_cache_{};
+};
+
 class Shader {
  public:
   Shader() = default;
-  explicit Shader(const std::filesystem::path& cfg_shader_path);
+  Shader(const std::filesystem::path& cfg_shader_path,
+         std::shared_ptr<ShaderIncludeCache> include_cache,
+         ShaderOptimization optimization = ShaderOptimization::kNone);
 
   u64 GetHashValue(const std::vector<std::string>& processes) const;
+  u64 GetSourceHashValue() const;
+  const std::vector<std::string>& GetIncludePaths() const;
+  ShaderOptimization GetOptimization() const;
+
+  static u32 GetCompilerVersion();
 
   std::vector<u32> CompileToSpirv(
       const std::vector<std::string>& processes) const;
 
  private:
+  void ParseIncludes(const std::filesystem::path& path, const std::string& text,
+                     std::set<std::string>& visited_paths);
+
   std::string path_;
   std::string source_text_;
   EShLanguage language_{};
+  ShaderOptimization optimization_{};
+
+  std::shared_ptr<ShaderIncludeCache> include_cache_;
+  std::vector<std::string> include_paths_;
+  u64 include_hash_value_{};
 };
 
 }  // namespace luka::ast
@@ -54,6 +54,58 @@ Config::Config() {
   if (config_json_.contains("frame_graph")) {
     frame_graph_index_ = config_json_["frame_graph"].template get<u32>();
   }
+
+  if (config_json_.contains("vertex_pulling")) {
+    vertex_pulling_ = config_json_["vertex_pulling"].template get<bool>();
+  }
+
+  if (config_json_.contains("frames_in_flight")) {
+    frames_in_flight_ =
+        std::max(config_json_["frames_in_flight"].template get<u32>(), 1U);
+  }
+
+  if (config_json_.contains("shader_optimization")) {
+    std::string shader_optimization{
+        config_json_["shader_optimization"].template get<std::string>()};
+    if (shader_optimization == "none") {
+      shader_optimization_ = ShaderOptimization::kNone;
+    } else if (shader_optimization == "performance") {
+      shader_optimization_ = ShaderOptimization::kPerformance;
+    } else if (shader_optimization == "size") {
+      shader_optimization_ = ShaderOptimization::kSize;
+    } else {
+      THROW("Unsupport shader optimization {}", shader_optimization);
+    }
+  }
+
+  if (config_json_.contains("shader_hot_reload")) {
+    shader_hot_reload_ = config_json_["shader_hot_reload"].template get<bool>();
+  }
+
+  // Renders offscreen for a fixed number of frames, without a window.
+  if (config_json_.contains("headless")) {
+    const json& headless_json{config_json_["headless"]};
+    if (headless_json.contains("enabled")) {
+      headless_ = headless_json["enabled"].template get<bool>();
+    }
+    if (headless_json.contains("width")) {
+      headless_width_ =
+          std::max(headless_json["width"].template get<u32>(), 1U);
+    }
+    if (headless_json.contains("height")) {
+      headless_height_ =
+          std::max(headless_json["height"].template get<u32>(), 1U);
+    }
+    if (headless_json.contains("frame_count")) {
+      headless_frame_count_ = headless_json["frame_count"].template get<u32>();
+    }
+  }
+
+#ifndef LUKA_SHADER_OPTIMIZATION
+  if (shader_optimization_ != ShaderOptimization::kNone) {
+    LOGW("SPIR-V optimizer is not built, shaders are only stripped");
+  }
+#endif
 }
 
 void Config::Tick() {}
@@ -82,4 +134,22 @@ const std::vector<std::filesystem::path>& Config::GetFrameGraphPaths() const {
 
 u32 Config::GetFrameGraphIndex() const { return frame_graph_index_; }
 
+bool Config::GetVertexPulling() const { return vertex_pulling_; }
+
+u32 Config::GetFramesInFlight() const { return frames_in_flight_; }
+
+ShaderOptimization Config::GetShaderOptimization() const {
+  return shader_optimization_;
+}
+
+bool Config::GetShaderHotReload() const { return shader_hot_reload_; }
+
+bool Config::GetHeadless() const { return headless_; }
+
+u32 Config::GetHeadlessWidth() const { return headless_width_; }
+
+u32 Config::GetHeadlessHeight() const { return headless_height_; }
+
+u32 Config::GetHeadlessFrameCount() const { return headless_frame_count_; }
+
 }  // namespace luka
\ No newline at end of file
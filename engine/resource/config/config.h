@@ -13,6 +13,8 @@
 
 namespace luka {
 
+enum class ShaderOptimization { kNone, kPerformance, kSize };
+
 struct GlobalContext {
   bool editor_mode{true};
   std::unordered_map<u32, bool> show_scenes;
@@ -31,6 +33,14 @@ class Config {
   const std::vector<std::filesystem::path>& GetShaderPaths() const;
   const std::vector<std::filesystem::path>& GetFrameGraphPaths() const;
   u32 GetFrameGraphIndex() const;
+  bool GetVertexPulling() const;
+  u32 GetFramesInFlight() const;
+  ShaderOptimization GetShaderOptimization() const;
+  bool GetShaderHotReload() const;
+  bool GetHeadless() const;
+  u32 GetHeadlessWidth() const;
+  u32 GetHeadlessHeight() const;
+  u32 GetHeadlessFrameCount() const;
 
   const std::vector<std::string>& GetSceneNames() const;
 
@@ -51,6 +61,23 @@ class Config {
   std::vector<std::filesystem::path> shader_paths_;
   std::vector<std::filesystem::path> frame_graph_paths_;
   u32 frame_graph_index_{};
+  bool vertex_pulling_{};
+  u32 frames_in_flight_{2};
+  // Release builds only optimize by default when the optimizer is built.
+#if defined(NDEBUG) && defined(LUKA_SHADER_OPTIMIZATION)
+  ShaderOptimization shader_optimization_{ShaderOptimization::kPerformance};
+#else
+  ShaderOptimization shader_optimization_{ShaderOptimization::kNone};
+#endif
+#ifdef NDEBUG
+  bool shader_hot_reload_{false};
+#else
+  bool shader_hot_reload_{true};
+#endif
+  bool headless_{};
+  u32 headless_width_{1280};
+  u32 headless_height_{720};
+  u32 headless_frame_count_{1000};
 
   std::vector<std::string> scene_names_;
 };
@@ -3,16 +3,52 @@
 
 #version 450
 
+#if defined(VERTEX_PULLING)
+#extension GL_EXT_buffer_reference : require
+#extension GL_EXT_buffer_reference_uvec2 : require
+#endif
+
 #include "../include/defination.glsl"
 
 layout(set = 0, binding = 0) uniform Subpass {
   SubpassUniform subpass_uniform;
 };
 
-layout(set = 2, binding = 0) uniform DrawElement {
-  DrawElementUniform draw_element_uniform;
+layout(set = 0, binding = 1) readonly buffer SubpassInstance {
+  InstanceUniform instance_uniforms[];
+};
+
+#if defined(VERTEX_PULLING)
+layout(set = 0, binding = 2) readonly buffer SubpassDrawElement {
+  DrawElementUniform draw_element_uniforms[];
+};
+
+layout(buffer_reference, std430,
+       buffer_reference_align = 4) readonly buffer VertexBuffer {
+  float values[];
 };
 
+layout(location = 0) out vec3 o_position;
+layout(location = 1) out vec3 o_normal;
+layout(location = 2) out vec3 o_tangent;
+layout(location = 3) out vec2 o_texcoord_0;
+layout(location = 4) flat out uint o_draw_element_index;
+
+bool HasVertexBuffer(uvec2 address) { return address != uvec2(0); }
+
+vec2 PullVec2(uvec2 address, uint stride) {
+  VertexBuffer vertex_buffer = VertexBuffer(address);
+  uint index = uint(gl_VertexIndex) * stride;
+  return vec2(vertex_buffer.values[index], vertex_buffer.values[index + 1]);
+}
+
+vec3 PullVec3(uvec2 address, uint stride) {
+  VertexBuffer vertex_buffer = VertexBuffer(address);
+  uint index = uint(gl_VertexIndex) * stride;
+  return vec3(vertex_buffer.values[index], vertex_buffer.values[index + 1],
+              vertex_buffer.values[index + 2]);
+}
+#else
 layout(location = 0) in vec3 position;
 layout(location = 0) out vec3 o_position;
 
@@ -28,15 +64,42 @@ layout(location = 2) out vec3 o_tangent;
 layout(location = 3) in vec2 texcoord_0;
 layout(location = 3) out vec2 o_texcoord_0;
 #endif
+#endif
 
 void main(void) {
-  vec4 world_position = draw_element_uniform.m * vec4(position, 1.0);
+  InstanceUniform instance_uniform = instance_uniforms[gl_InstanceIndex];
+
+#if defined(VERTEX_PULLING)
+  o_draw_element_index = instance_uniform.draw_element_index;
+  DrawElementUniform draw_element_uniform =
+      draw_element_uniforms[o_draw_element_index];
+
+  uvec4 addresses_0 = draw_element_uniform.position_normal_addresses;
+  uvec4 addresses_1 = draw_element_uniform.tangent_texcoord_0_addresses;
+  uvec4 strides = draw_element_uniform.vertex_strides;
+
+  vec3 position = PullVec3(addresses_0.xy, strides.x);
+  vec3 normal = PullVec3(addresses_0.zw, strides.y);
+#endif
+
+  vec4 world_position = instance_uniform.m * vec4(position, 1.0);
   o_position = world_position.xyz / world_position.w;
   gl_Position = subpass_uniform.pv * world_position;
 
-  mat3 ti_m = transpose(mat3(draw_element_uniform.inverse_m));
+  mat3 ti_m = transpose(mat3(instance_uniform.inverse_m));
   o_normal = ti_m * normal;
 
+#if defined(VERTEX_PULLING)
+  o_tangent = vec3(0.0);
+  if (HasVertexBuffer(addresses_1.xy)) {
+    o_tangent = ti_m * PullVec3(addresses_1.xy, strides.z);
+  }
+
+  o_texcoord_0 = vec2(0.0);
+  if (HasVertexBuffer(addresses_1.zw)) {
+    o_texcoord_0 = PullVec2(addresses_1.zw, strides.w);
+  }
+#else
 #if defined(HAS_TANGENT_BUFFER)
   o_tangent = ti_m * tangent;
 #endif
@@ -44,4 +107,5 @@ void main(void) {
 #if defined(HAS_TEXCOORD_0_BUFFER)
   o_texcoord_0 = texcoord_0;
 #endif
+#endif
 }
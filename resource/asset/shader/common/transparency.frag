@@ -10,10 +10,23 @@
 layout(set = 1, binding = 0) uniform sampler bindless_samplers[];
 layout(set = 1, binding = 1) uniform texture2D bindless_images[];
 
-layout(set = 2, binding = 0) uniform DrawElement {
-  DrawElementUniform draw_element_uniform;
+layout(set = 1, binding = 2) readonly buffer BindlessMaterial {
+  MaterialUniform material_uniforms[];
 };
 
+#if defined(VERTEX_PULLING)
+layout(set = 0, binding = 2) readonly buffer SubpassDrawElement {
+  DrawElementUniform draw_element_uniforms[];
+};
+
+layout(location = 4) flat in uint i_draw_element_index;
+
+#define material_uniform \
+  material_uniforms[draw_element_uniforms[i_draw_element_index].material_index]
+#else
+#define material_uniform material_uniforms[push_constant.material_index]
+#endif
+
 layout(location = 0) in vec3 i_position;
 
 layout(location = 1) in vec3 i_normal;
@@ -30,14 +43,16 @@ layout(location = 0) out vec4 o_color;
 
 void main(void) {
   // Base color.
-  vec4 base_color = draw_element_uniform.base_color_factor;
-#if defined(HAS_BASE_COLOR_TEXTURE)
-  vec4 base_color_texel =
-      texture(nonuniformEXT(sampler2D(
-                  bindless_images[draw_element_uniform.image_indices_0.x],
-                  bindless_samplers[draw_element_uniform.sampler_indices_0.x])),
-              i_texcoord_0);
-  base_color = vec4(pow(base_color_texel.rgb, vec3(2.2)), base_color_texel.a);
+  vec4 base_color = material_uniform.base_color_factor;
+#if defined(HAS_TEXCOORD_0_BUFFER)
+  if (HAS_BASE_COLOR_TEXTURE) {
+    vec4 base_color_texel = texture(
+        nonuniformEXT(sampler2D(
+            bindless_images[material_uniform.image_indices_0.x],
+            bindless_samplers[material_uniform.sampler_indices_0.x])),
+        i_texcoord_0);
+    base_color = vec4(pow(base_color_texel.rgb, vec3(2.2)), base_color_texel.a);
+  }
 #endif
 
   o_color = base_color;
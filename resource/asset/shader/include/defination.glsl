@@ -1,25 +1,40 @@
-struct PunctualLight {
-  vec3 position;
-  uint type;
-  vec3 direction;
-  float intensity;
-  vec3 color;
-  float range;
-  float inner_cone_cos;
-  float outer_cone_cos;
-  vec2 padding;
-};
+// Value-only switches, filled in at pipeline creation.
+layout(constant_id = 0) const bool HAS_BASE_COLOR_TEXTURE = false;
+layout(constant_id = 1) const bool HAS_METALLIC_ROUGHNESS_TEXTURE = false;
+layout(constant_id = 2) const bool HAS_NORMAL_TEXTURE = false;
+layout(constant_id = 3) const bool HAS_OCCLUSION_TEXTURE = false;
+layout(constant_id = 4) const bool HAS_EMISSIVE_TEXTURE = false;
+layout(constant_id = 5) const bool HAS_MASK_ALPHA = false;
+
+// Subpass values are pushed once per pipeline layout, draw values before every
+// draw not batched into an indirect draw.
+layout(push_constant) uniform PushConstant {
+  uint frame_index;
+  uint draw_element_count;
+  uint draw_element_index;
+  uint material_index;
+  uint lod;
+}
+push_constant;
+
+#include "light.glsl"
 
 struct SubpassUniform {
   mat4 pv;
   mat4 inverse_pv;
+  mat4 view;
   vec4 camera_position;
-  PunctualLight punctual_lights[PUNCTUAL_LIGHT_MAX_COUNT];
+  float z_near;
+  float z_far;
 };
 
-struct DrawElementUniform {
+struct InstanceUniform {
   mat4 m;
   mat4 inverse_m;
+  uint draw_element_index;
+};
+
+struct MaterialUniform {
   uvec4 sampler_indices_0;
   uvec4 sampler_indices_1;
   uvec4 image_indices_0;
@@ -33,6 +48,13 @@ struct DrawElementUniform {
   float alpha_cutoff;
 };
 
+struct DrawElementUniform {
+  uvec4 position_normal_addresses;
+  uvec4 tangent_texcoord_0_addresses;
+  uvec4 vertex_strides;
+  uint material_index;
+};
+
 float RangeAttenuation(float range, float dist) {
   if (range <= 0.0) {
     return 1.0 / pow(dist, 2.0);
@@ -1,92 +1,98 @@
   // Base color.
-  vec4 base_color = draw_element_uniform.base_color_factor;
-#if defined(HAS_BASE_COLOR_TEXTURE)
-  vec4 base_color_texel =
-      texture(nonuniformEXT(sampler2D(
-                  bindless_images[draw_element_uniform.image_indices_0.x],
-                  bindless_samplers[draw_element_uniform.sampler_indices_0.x])),
-              i_texcoord_0);
-  base_color = vec4(pow(base_color_texel.rgb, vec3(2.2)), base_color_texel.a);
+  vec4 base_color = material_uniform.base_color_factor;
+#if defined(HAS_TEXCOORD_0_BUFFER)
+  if (HAS_BASE_COLOR_TEXTURE) {
+    vec4 base_color_texel = texture(
+        nonuniformEXT(sampler2D(
+            bindless_images[material_uniform.image_indices_0.x],
+            bindless_samplers[material_uniform.sampler_indices_0.x])),
+        i_texcoord_0);
+    base_color = vec4(pow(base_color_texel.rgb, vec3(2.2)), base_color_texel.a);
+  }
 #endif
 
-#if defined(HAS_MASK_ALPHA) 
-  if (base_color.a < draw_element_uniform.alpha_cutoff) {
-    discard;
+  if (HAS_MASK_ALPHA) {
+    if (base_color.a < material_uniform.alpha_cutoff) {
+      discard;
+    }
   }
-#endif
 
   // Metallic and roughness.
-  float metallic = draw_element_uniform.metallic_factor;
-  float roughness = draw_element_uniform.roughness_factor;
-#if defined(HAS_METALLIC_ROUGHNESS_TEXTURE)
-  vec4 metallic_roughness_texel =
-      texture(nonuniformEXT(sampler2D(
-                  bindless_images[draw_element_uniform.image_indices_0.y],
-                  bindless_samplers[draw_element_uniform.sampler_indices_0.y])),
-              i_texcoord_0);
-  metallic = metallic_roughness_texel.b;
-  roughness = metallic_roughness_texel.g;
+  float metallic = material_uniform.metallic_factor;
+  float roughness = material_uniform.roughness_factor;
+#if defined(HAS_TEXCOORD_0_BUFFER)
+  if (HAS_METALLIC_ROUGHNESS_TEXTURE) {
+    vec4 metallic_roughness_texel = texture(
+        nonuniformEXT(sampler2D(
+            bindless_images[material_uniform.image_indices_0.y],
+            bindless_samplers[material_uniform.sampler_indices_0.y])),
+        i_texcoord_0);
+    metallic = metallic_roughness_texel.b;
+    roughness = metallic_roughness_texel.g;
+  }
 #endif
 
   // Normal
   vec3 normal = normalize(i_normal) * 0.5 + 0.5;
 
-#if defined(HAS_NORMAL_TEXTURE)
-  vec3 normal_texel =
-      texture(nonuniformEXT(sampler2D(
-                  bindless_images[draw_element_uniform.image_indices_0.z],
-                  bindless_samplers[draw_element_uniform.sampler_indices_0.z])),
-              i_texcoord_0)
-          .xyz;
+#if defined(HAS_TEXCOORD_0_BUFFER)
+  if (HAS_NORMAL_TEXTURE) {
+    vec3 normal_texel =
+        texture(nonuniformEXT(sampler2D(
+                    bindless_images[material_uniform.image_indices_0.z],
+                    bindless_samplers[material_uniform.sampler_indices_0.z])),
+                i_texcoord_0)
+            .xyz;
 
 #if defined(HAS_TANGENT_BUFFER)
-  vec3 T = normalize(i_tangent);
-  vec3 B = normalize(cross(normal, T));
-  mat3 TNB = mat3(T, B, normal);
-  normal = normalize(TNB * (normal_texel * 2.0 - 1.0));
-#elif defined(HAS_TEXCOORD_0_BUFFER)
-  vec2 uv_dx = dFdx(i_texcoord_0);
-  vec2 uv_dy = dFdy(i_texcoord_0);
-  if (length(uv_dx) <= 1e-2) {
-    uv_dx = vec2(1.0, 0.0);
-  }
-  if (length(uv_dy) <= 1e-2) {
-    uv_dy = vec2(0.0, 1.0);
-  }
+    vec3 T = normalize(i_tangent);
+#else
+    vec2 uv_dx = dFdx(i_texcoord_0);
+    vec2 uv_dy = dFdy(i_texcoord_0);
+    if (length(uv_dx) <= 1e-2) {
+      uv_dx = vec2(1.0, 0.0);
+    }
+    if (length(uv_dy) <= 1e-2) {
+      uv_dy = vec2(0.0, 1.0);
+    }
 
-  vec3 T0 = (uv_dy.t * dFdx(i_position) - uv_dx.t * dFdy(i_position)) /
-            (uv_dx.s * uv_dy.t - uv_dy.s * uv_dx.t);
-  vec3 T = normalize(T0 - normal * dot(normal, T0));
-  vec3 B = normalize(cross(normal, T));
-  mat3 TNB = mat3(T, B, normal);
-  normal = normalize(TNB * (normal_texel * 2.0 - 1.0));
+    vec3 T0 = (uv_dy.t * dFdx(i_position) - uv_dx.t * dFdy(i_position)) /
+              (uv_dx.s * uv_dy.t - uv_dy.s * uv_dx.t);
+    vec3 T = normalize(T0 - normal * dot(normal, T0));
 #endif
-
+    vec3 B = normalize(cross(normal, T));
+    mat3 TNB = mat3(T, B, normal);
+    normal = normalize(TNB * (normal_texel * 2.0 - 1.0));
+  }
 #endif
-  if (draw_element_uniform.normal_scale != 1.0) {
-    normal.xy *= draw_element_uniform.normal_scale;
+  if (material_uniform.normal_scale != 1.0) {
+    normal.xy *= material_uniform.normal_scale;
   }
 
   // Occlusion
-  float occlusion = draw_element_uniform.occlusion_strength;
-#if defined(HAS_OCCLUSION_TEXTURE)
-  float occlusion_texel =
-      texture(nonuniformEXT(sampler2D(
-                  bindless_images[draw_element_uniform.image_indices_0.w],
-                  bindless_samplers[draw_element_uniform.sampler_indices_0.w])),
-              i_texcoord_0)
-          .x;
-  occlusion = 1.0 + occlusion * (occlusion_texel - 1.0);
+  float occlusion = material_uniform.occlusion_strength;
+#if defined(HAS_TEXCOORD_0_BUFFER)
+  if (HAS_OCCLUSION_TEXTURE) {
+    float occlusion_texel =
+        texture(nonuniformEXT(sampler2D(
+                    bindless_images[material_uniform.image_indices_0.w],
+                    bindless_samplers[material_uniform.sampler_indices_0.w])),
+                i_texcoord_0)
+            .x;
+    occlusion = 1.0 + occlusion * (occlusion_texel - 1.0);
+  }
 #endif
 
   // Emissive
-  vec4 emissive = draw_element_uniform.emissive_factor;
-#if defined(HAS_EMISSIVE_TEXTURE)
-  vec4 emissive_texel =
-      texture(nonuniformEXT(sampler2D(
-                  bindless_images[draw_element_uniform.image_indices_1.x],
-                  bindless_samplers[draw_element_uniform.sampler_indices_1.x])),
-              i_texcoord_0);
-  emissive_texel = vec4(pow(emissive_texel.rgb, vec3(2.2)), emissive_texel.a);
-  emissive *= emissive_texel;
+  vec4 emissive = material_uniform.emissive_factor;
+#if defined(HAS_TEXCOORD_0_BUFFER)
+  if (HAS_EMISSIVE_TEXTURE) {
+    vec4 emissive_texel = texture(
+        nonuniformEXT(sampler2D(
+            bindless_images[material_uniform.image_indices_1.x],
+            bindless_samplers[material_uniform.sampler_indices_1.x])),
+        i_texcoord_0);
+    emissive_texel = vec4(pow(emissive_texel.rgb, vec3(2.2)), emissive_texel.a);
+    emissive *= emissive_texel;
+  }
 #endif
\ No newline at end of file
@@ -0,0 +1,31 @@
+struct PunctualLight {
+  vec3 position;
+  uint type;
+  vec3 direction;
+  float intensity;
+  vec3 color;
+  float range;
+  float inner_cone_cos;
+  float outer_cone_cos;
+  vec2 padding;
+};
+
+// Tiles are uniform in normalized device coordinates, slices exponential in
+// view depth.
+#define LIGHT_CLUSTER_COUNT \
+  (LIGHT_CLUSTER_X * LIGHT_CLUSTER_Y * LIGHT_CLUSTER_Z)
+
+float LightClusterSliceDepth(uint slice, float z_near, float z_far) {
+  return z_near * pow(z_far / z_near, float(slice) / float(LIGHT_CLUSTER_Z));
+}
+
+uint LightClusterIndex(vec2 ndc, float view_depth, float z_near,
+                       float z_far) {
+  uvec2 tile = uvec2(
+      clamp((ndc * 0.5 + 0.5) * vec2(LIGHT_CLUSTER_X, LIGHT_CLUSTER_Y),
+            vec2(0.0), vec2(LIGHT_CLUSTER_X - 1, LIGHT_CLUSTER_Y - 1)));
+  float slice = log(max(view_depth, z_near) / z_near) / log(z_far / z_near) *
+                float(LIGHT_CLUSTER_Z);
+  uint z = uint(clamp(slice, 0.0, float(LIGHT_CLUSTER_Z - 1)));
+  return (z * LIGHT_CLUSTER_Y + tile.y) * LIGHT_CLUSTER_X + tile.x;
+}
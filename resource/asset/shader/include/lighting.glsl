@@ -5,9 +5,17 @@
   float ndotv = max(dot(normal, v), 0.0);
   vec3 F0 = mix(vec3(0.04), base_color.xyz, metallic);
 
-  // Punctual.
-  for (int i = 0; i < PUNCTUAL_LIGHT_COUNT; ++i) {
-    PunctualLight light = subpass_uniform.punctual_lights[i];
+  // Punctual, only the lights assigned to the cluster of the fragment.
+  vec4 light_clip = subpass_uniform.pv * vec4(position, 1.0);
+  float light_view_depth = -(subpass_uniform.view * vec4(position, 1.0)).z;
+  uint light_cluster_index = LightClusterIndex(
+      light_clip.xy / light_clip.w, light_view_depth, subpass_uniform.z_near,
+      subpass_uniform.z_far);
+  uint light_offset = light_cluster_index * LIGHT_CLUSTER_LIGHT_MAX_COUNT;
+  uint light_count = light_cluster_counts[light_cluster_index];
+  for (uint i = 0; i < light_count; ++i) {
+    PunctualLight light =
+        punctual_lights[light_cluster_indices[light_offset + i]];
     vec3 point_to_light;
     if (light.type != DIRECTIONAL_LIGHT) {
       point_to_light = light.position - position;
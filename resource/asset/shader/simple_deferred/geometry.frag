@@ -10,10 +10,23 @@
 layout(set = 1, binding = 0) uniform sampler bindless_samplers[];
 layout(set = 1, binding = 1) uniform texture2D bindless_images[];
 
-layout(set = 2, binding = 0) uniform DrawElement {
-  DrawElementUniform draw_element_uniform;
+layout(set = 1, binding = 2) readonly buffer BindlessMaterial {
+  MaterialUniform material_uniforms[];
 };
 
+#if defined(VERTEX_PULLING)
+layout(set = 0, binding = 2) readonly buffer SubpassDrawElement {
+  DrawElementUniform draw_element_uniforms[];
+};
+
+layout(location = 4) flat in uint i_draw_element_index;
+
+#define material_uniform \
+  material_uniforms[draw_element_uniforms[i_draw_element_index].material_index]
+#else
+#define material_uniform material_uniforms[push_constant.material_index]
+#endif
+
 layout(location = 0) in vec3 i_position;
 
 layout(location = 1) in vec3 i_normal;
@@ -22,6 +22,14 @@ layout(input_attachment_index = 4, set = 0,
 layout(input_attachment_index = 5, set = 0,
        binding = 6) uniform subpassInput subpass_i_depth;
 
+layout(set = 0, binding = 7) readonly buffer SubpassLight {
+  PunctualLight punctual_lights[];
+};
+layout(set = 0, binding = 8) readonly buffer SubpassLightCluster {
+  uint light_cluster_counts[LIGHT_CLUSTER_COUNT];
+  uint light_cluster_indices[];
+};
+
 layout(location = 0) in vec2 i_texcoord_0;
 layout(location = 0) out vec4 o_color;
 